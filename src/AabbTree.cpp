@@ -0,0 +1,170 @@
+#include "AabbTree.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        namespace
+        {
+            const unsigned int kMaxLeafItems = 4;
+            // keeps the query stack bounded
+            const unsigned int kMaxDepth = 30;
+
+            AabbTree::Aabb emptyBounds()
+            {
+                const dReal max = std::numeric_limits<dReal>::max();
+                return AabbTree::Aabb{max, -max, max, -max, max, -max};
+            }
+
+            void merge(AabbTree::Aabb &a, const AabbTree::Aabb &b)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    a[k*2] = std::min(a[k*2], b[k*2]);
+                    a[k*2+1] = std::max(a[k*2+1], b[k*2+1]);
+                }
+            }
+        }
+
+        void AabbTree::build(const std::vector<Aabb> &bounds)
+        {
+            clear();
+            if(bounds.empty())
+            {
+                return;
+            }
+            itemBounds = bounds;
+            items.resize(bounds.size());
+            for(unsigned int i=0; i<items.size(); i++)
+            {
+                items[i] = i;
+            }
+            nodes.reserve(bounds.size()*2/kMaxLeafItems + 1);
+            nodes.emplace_back();
+            buildNode(0, 0, items.size(), 0);
+        }
+
+        void AabbTree::buildNode(unsigned int index, unsigned int begin, unsigned int end, unsigned int depth)
+        {
+            Aabb bounds = emptyBounds();
+            Aabb centers = emptyBounds();
+            for(unsigned int i=begin; i<end; i++)
+            {
+                const Aabb &b = itemBounds[items[i]];
+                merge(bounds, b);
+                for(int k=0; k<3; k++)
+                {
+                    const dReal c = (b[k*2] + b[k*2+1])*0.5;
+                    centers[k*2] = std::min(centers[k*2], c);
+                    centers[k*2+1] = std::max(centers[k*2+1], c);
+                }
+            }
+            nodes[index].bounds = bounds;
+            if(end-begin <= kMaxLeafItems || depth >= kMaxDepth)
+            {
+                nodes[index].first = begin;
+                nodes[index].count = end-begin;
+                return;
+            }
+
+            // median split along the longest axis of the item centers
+            int axis = 0;
+            for(int k=1; k<3; k++)
+            {
+                if(centers[k*2+1]-centers[k*2] > centers[axis*2+1]-centers[axis*2])
+                {
+                    axis = k;
+                }
+            }
+            const unsigned int mid = begin + (end-begin)/2;
+            std::nth_element(items.begin()+begin, items.begin()+mid, items.begin()+end,
+                             [&](unsigned int a, unsigned int b)
+                             {
+                                 return itemBounds[a][axis*2] + itemBounds[a][axis*2+1] <
+                                     itemBounds[b][axis*2] + itemBounds[b][axis*2+1];
+                             });
+
+            // both children are allocated together
+            const unsigned int first = nodes.size();
+            nodes.resize(first+2);
+            nodes[index].first = first;
+            nodes[index].count = 0;
+            buildNode(first, begin, mid, depth+1);
+            buildNode(first+1, mid, end, depth+1);
+        }
+
+        void AabbTree::refit(const std::vector<Aabb> &bounds)
+        {
+            if(bounds.size() != itemBounds.size())
+            {
+                build(bounds);
+                return;
+            }
+            itemBounds = bounds;
+            if(!nodes.empty())
+            {
+                refitNode(0);
+            }
+        }
+
+        void AabbTree::refitNode(unsigned int index)
+        {
+            Node &node = nodes[index];
+            node.bounds = emptyBounds();
+            if(node.count)
+            {
+                for(unsigned int i=node.first; i<node.first+node.count; i++)
+                {
+                    merge(node.bounds, itemBounds[items[i]]);
+                }
+                return;
+            }
+            refitNode(node.first);
+            refitNode(node.first+1);
+            merge(nodes[index].bounds, nodes[node.first].bounds);
+            merge(nodes[index].bounds, nodes[node.first+1].bounds);
+        }
+
+        void AabbTree::transform(const dReal *in, const utils::Vector &pos,
+                                 const utils::Matrix &rotation, dReal *out)
+        {
+            // infinite boxes (e.g. of planes) would give nan centers, the
+            // result is unbounded and overlaps every box
+            for(int k=0; k<6; k++)
+            {
+                if(!std::isfinite(in[k]))
+                {
+                    const dReal infinity = std::numeric_limits<dReal>::infinity();
+                    for(int i=0; i<3; i++)
+                    {
+                        out[i*2] = -infinity;
+                        out[i*2+1] = infinity;
+                    }
+                    return;
+                }
+            }
+            const utils::Vector center((in[0]+in[1])*0.5, (in[2]+in[3])*0.5, (in[4]+in[5])*0.5);
+            const utils::Vector half((in[1]-in[0])*0.5, (in[3]-in[2])*0.5, (in[5]-in[4])*0.5);
+            const utils::Vector c = rotation*center + pos;
+            const utils::Vector h = rotation.cwiseAbs()*half;
+            for(int k=0; k<3; k++)
+            {
+                out[k*2] = c[k] - h[k];
+                out[k*2+1] = c[k] + h[k];
+            }
+        }
+
+        void AabbTree::clear()
+        {
+            nodes.clear();
+            items.clear();
+            itemBounds.clear();
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
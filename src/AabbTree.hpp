@@ -0,0 +1,112 @@
+ /**
+ * \file AabbTree.hpp
+ * \brief "AabbTree" is a small bounding volume hierarchy over axis aligned
+ *        boxes used by objects that hold many shapes behind a single geom.
+ *
+ */
+
+#pragma once
+
+#include <mars_utils/Vector.h>
+#include <ode/ode.h>
+
+#include <array>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * All boxes use the ode layout (min x, max x, min y, max y, min z, max z).
+         * The tree is built top down by median splits along the longest axis.
+         * If the item boxes move without changing the topology, refit updates
+         * the node boxes bottom up.
+         */
+        class AabbTree
+        {
+        public:
+            typedef std::array<dReal, 6> Aabb;
+
+            void build(const std::vector<Aabb> &bounds);
+            // the item order has to match the last build
+            void refit(const std::vector<Aabb> &bounds);
+            void clear();
+
+            bool empty() const
+            {
+                return nodes.empty();
+            }
+            const Aabb& getBounds() const
+            {
+                return nodes[0].bounds;
+            }
+
+            static bool overlaps(const dReal *a, const dReal *b)
+            {
+                return a[0] <= b[1] && b[0] <= a[1] &&
+                    a[2] <= b[3] && b[2] <= a[3] &&
+                    a[4] <= b[5] && b[4] <= a[5];
+            }
+
+            // conservative box of the given box after rotation and translation,
+            // a box with an infinite bound results in a box covering everything
+            static void transform(const dReal *in, const utils::Vector &pos,
+                                  const utils::Matrix &rotation, dReal *out);
+
+            // calls callback(item) for all items overlapping the box
+            template<typename Callback> void query(const dReal *aabb, Callback &&callback) const
+            {
+                if(nodes.empty())
+                {
+                    return;
+                }
+                int stack[64];
+                int top = 0;
+                stack[top++] = 0;
+                while(top)
+                {
+                    const Node &node = nodes[stack[--top]];
+                    if(!overlaps(node.bounds.data(), aabb))
+                    {
+                        continue;
+                    }
+                    if(node.count)
+                    {
+                        for(unsigned int i=node.first; i<node.first+node.count; i++)
+                        {
+                            if(overlaps(itemBounds[items[i]].data(), aabb))
+                            {
+                                callback(items[i]);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        stack[top++] = node.first;
+                        stack[top++] = node.first+1;
+                    }
+                }
+            }
+
+        private:
+            struct Node
+            {
+                Aabb bounds;
+                // leaf: first item and item count, inner node: index of the
+                // first child (the second follows) and count 0
+                unsigned int first;
+                unsigned int count;
+            };
+
+            void buildNode(unsigned int index, unsigned int begin, unsigned int end, unsigned int depth);
+            void refitNode(unsigned int index);
+
+            std::vector<Node> nodes;
+            std::vector<unsigned int> items;
+            std::vector<Aabb> itemBounds;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -8,6 +8,8 @@
 #include "CollisionSpace.hpp"
 #include "objects/Object.hpp"
 #include "objects/ObjectFactory.hpp"
+#include "WorkerPool.hpp"
+#include "SweepAndPrune.hpp"
 
 #include <mars_utils/MutexLocker.h>
 #include <mars_interfaces/Logging.hpp>
@@ -17,6 +19,13 @@
 
 #include <configmaps/ConfigSchema.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <set>
+
 #define EPSILON 1e-10
 
 
@@ -28,6 +37,188 @@ namespace mars
         using namespace utils;
         using namespace interfaces;
 
+        namespace
+        {
+            /**
+             * Filters contacts of heightmaps below the surface (depth) and
+             * contacts within a vertical cylinder (radius), the stronger
+             * setting of the two objects is used.
+             */
+            struct ContactFilter
+            {
+                ContactFilter(const Object *object1, const Object *object2) :
+                    depth{std::max(-1.0, std::max(object1->filter_depth, object2->filter_depth))},
+                    radius{-1.0},
+                    sphere{0.0, 0.0, 0.0}
+                {
+                    if(object1->filter_radius > radius)
+                    {
+                        radius = object1->filter_radius;
+                        sphere = object1->filter_sphere;
+                    }
+                    if(object2->filter_radius > radius)
+                    {
+                        radius = object2->filter_radius;
+                        sphere = object2->filter_sphere;
+                    }
+                }
+
+                bool isActive() const
+                {
+                    return depth > 0.0 || radius > 0.0;
+                }
+
+                bool accepts(const dContactGeom &contact) const
+                {
+                    if(depth > 0.0 && (contact.normal[2] < 0.5 || depth < contact.depth))
+                    {
+                        return false;
+                    }
+                    if(radius > 0.0)
+                    {
+                        const Vector v = Vector(contact.pos[0], contact.pos[1], 0.0) - sphere;
+                        if(v.norm() <= radius)
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                double depth;
+                double radius;
+                Vector sphere;
+            };
+
+            // steps with a constant depth after which a pair is resting
+            const int kRestingSteps = 10;
+            const dReal kRestingDepthChange = 1e-3;
+            // contacts per pair of a resting pair
+            const int kRestingContacts = 4;
+
+            /**
+             * Contacts needed for a stable contact of the two geom classes:
+             * one for spheres (and rays), two for the line of a capsule and
+             * four for the faces of boxes, cylinders and convex hulls. Meshes,
+             * heightfields and user classes keep the maximum.
+             */
+            int pairContactCount(dGeomID o1, dGeomID o2, int maxContacts)
+            {
+                auto classCount = [maxContacts](int geomClass)
+                {
+                    switch(geomClass)
+                    {
+                    case dSphereClass:
+                    case dRayClass:
+                        return 1;
+                    case dCapsuleClass:
+                        return 2;
+                    case dBoxClass:
+                    case dCylinderClass:
+                    case dConvexClass:
+                        return 4;
+                    case dPlaneClass:
+                        // a plane does not limit the contacts of the other geom
+                        return std::numeric_limits<int>::max();
+                    default:
+                        return maxContacts;
+                    }
+                };
+                const int count = std::min(classCount(dGeomGetClass(o1)), classCount(dGeomGetClass(o2)));
+                return std::max(1, std::min(count, maxContacts));
+            }
+
+            Vector contactPos(const dContact &contact)
+            {
+                return Vector(contact.geom.pos[0], contact.geom.pos[1], contact.geom.pos[2]);
+            }
+
+            /**
+             * Keeps maxContacts of the contacts marked in keep: the deepest
+             * contact, the one farthest from it and the two that span the
+             * largest area with these on either side of the line between them
+             * (measured along the normal of the deepest contact). Further
+             * contacts are chosen farthest from all kept ones.
+             */
+            void reduceContacts(const dContact *contact, std::vector<char> *keep, int maxContacts)
+            {
+                std::vector<int> candidates;
+                for(size_t i=0; i<keep->size(); i++)
+                {
+                    if((*keep)[i])
+                    {
+                        candidates.push_back(i);
+                    }
+                    (*keep)[i] = 0;
+                }
+                std::vector<int> selected;
+                auto select = [&](size_t candidate)
+                {
+                    selected.push_back(candidates[candidate]);
+                    candidates.erase(candidates.begin()+candidate);
+                };
+                // picks the candidate with the highest score
+                auto selectBest = [&](auto score)
+                {
+                    size_t best = 0;
+                    dReal bestScore = -dInfinity;
+                    for(size_t c=0; c<candidates.size(); c++)
+                    {
+                        const dReal value = score(contactPos(contact[candidates[c]]));
+                        if(value > bestScore)
+                        {
+                            best = c;
+                            bestScore = value;
+                        }
+                    }
+                    select(best);
+                };
+
+                size_t deepest = 0;
+                for(size_t c=1; c<candidates.size(); c++)
+                {
+                    if(contact[candidates[c]].geom.depth > contact[candidates[deepest]].geom.depth)
+                    {
+                        deepest = c;
+                    }
+                }
+                select(deepest);
+                const Vector p0 = contactPos(contact[selected[0]]);
+                const Vector normal(contact[selected[0]].geom.normal[0], contact[selected[0]].geom.normal[1],
+                                    contact[selected[0]].geom.normal[2]);
+                if(maxContacts > 1)
+                {
+                    selectBest([&p0](const Vector &p) {return (p-p0).squaredNorm();});
+                }
+                const Vector edge = maxContacts > 1 ? Vector(contactPos(contact[selected[1]]) - p0) : Vector(Vector::Zero());
+                if(maxContacts > 2)
+                {
+                    // signed area of the triangle with the first two contacts
+                    selectBest([&](const Vector &p) {return edge.cross(p-p0).dot(normal);});
+                }
+                if(maxContacts > 3)
+                {
+                    selectBest([&](const Vector &p) {return -edge.cross(p-p0).dot(normal);});
+                }
+                while((int)selected.size() < maxContacts && !candidates.empty())
+                {
+                    selectBest([&](const Vector &p)
+                    {
+                        dReal distance = dInfinity;
+                        for(const int s : selected)
+                        {
+                            distance = std::min(distance, (p-contactPos(contact[s])).squaredNorm());
+                        }
+                        return distance;
+                    });
+                }
+                for(const int s : selected)
+                {
+                    (*keep)[s] = 1;
+                }
+            }
+        }
+
         /**
          *  \brief The constructor for the collision space.
          *
@@ -51,6 +242,15 @@ namespace mars
             num_contacts = 0;
             create_contacts = 1;
             log_contacts = 0;
+            indexContacts = false;
+            budgetMaxContacts = 0;
+            budgetMaxTime = 0.0;
+            adaptiveContacts = false;
+            adaptiveStep = false;
+            partitionContacts = false;
+            collectPairs = false;
+            queueContactEvents = false;
+            persistContactEvents = false;
             registerSchemaValidators();
             dInitODE();
         }
@@ -180,184 +380,783 @@ namespace mars
             // if world_init = false or step_size <= 0 debug something
             if(space_init > 0)
             {
+                completePendingObjects();
                 /// first check for collisions
                 num_contacts = log_contacts = 0;
                 contactVector.clear();
-                dSpaceCollide(space, this, &CollisionSpace::callbackForward);
+                contactObjects.clear();
+                collectPairs = !contactEventListeners.empty() || queueContactEvents;
+                if(collectPairs)
+                {
+                    previousPairs.swap(contactPairs);
+                    contactPairs.clear();
+                }
+                else
+                {
+                    // collecting again later has to start without contacts
+                    previousPairs.clear();
+                    contactPairs.clear();
+                }
+                adaptiveStep = adaptiveContacts;
+                if(budgetMaxContacts > 0 || budgetMaxTime > 0.0)
+                {
+                    generateBudgetedContacts();
+                }
+                else if(sweepAndPrune)
+                {
+                    collideIncremental();
+                }
+                else
+                {
+                    dSpaceCollide(space, this, &CollisionSpace::callbackForward);
+                }
+                if(!ccdObjects.empty())
+                {
+                    generateSweptContacts();
+                }
+                if(adaptiveStep)
+                {
+                    // pairs without contacts in this step start over
+                    adaptiveHistory.swap(adaptiveCurrent);
+                    adaptiveCurrent.clear();
+                    adaptiveStep = false;
+                }
+                if(partitionContacts)
+                {
+                    partitionIslands();
+                }
+                if(indexContacts)
+                {
+                    buildContactIndex();
+                }
+                if(collectPairs)
+                {
+                    publishContactEvents();
+                    collectPairs = false;
+                }
             }
         }
 
+        void CollisionSpace::setAdaptiveContacts(bool enable)
+        {
+            MutexLocker locker(&iMutex);
+            adaptiveContacts = enable;
+            adaptiveHistory.clear();
+            adaptiveCurrent.clear();
+        }
+
         /**
-         * \brief In this function the collision handling from ode is performed.
-         *
-         * pre:
-         *     - world_init = true
-         *     - o1 and o2 are regular geoms
-         *
-         * post:
-         *     - if o1 or o2 was a Space, called SpaceCollide and exit
-         *     - otherwise tested if the geoms collide and created a contact
-         *       joint if so.
+         * \brief Counts the steps in which the deepest contact of the pair
+         * stayed within kRestingDepthChange.
          *
-         * A lot of the code is uncommented in this function. This
-         * code maybe used later to handle sensors or other special cases
-         * in the simulation.
+         * Objects with several geoms collide more than once per step, those
+         * calls are merged into the state of the step.
          */
-        void CollisionSpace::nearCallback(dGeomID o1, dGeomID o2)
+        void CollisionSpace::updateAdaptiveState(const Object *object1, const Object *object2,
+                                                 const dContact *contact, const std::vector<char> &keep,
+                                                 const AdaptiveState *previous)
         {
-            int i;
-            int numc;
-            // up to MAX_CONTACTS contact per Box-box
-            // dContact contact[MAX_CONTACTS];
-            dVector3 v1, v;
-            // dMatrix3 R;
-            dReal dot;
-
-            if(dGeomIsSpace(o1) || dGeomIsSpace(o2))
+            dReal depth = 0.0;
+            for(size_t i=0; i<keep.size(); i++)
             {
-                /// test if a space is colliding with something
-                dSpaceCollide2(o1, o2, this, &CollisionSpace::callbackForward);
-                return;
-            }
-
-            /// exit without doing anything if the two bodies are connected by a joint
-            // dBodyID b1=dGeomGetBody(o1);
-            // dBodyID b2=dGeomGetBody(o2);
-
-            const auto* const object1 = reinterpret_cast<Object*>(dGeomGetData(o1));
-            const auto* const object2 = reinterpret_cast<Object*>(dGeomGetData(o2));
-            if(!(object1->c_params.coll_bitmask & object2->c_params.coll_bitmask))
-            {
-                return;
+                if(keep[i])
+                {
+                    depth = std::max(depth, contact[i].geom.depth);
+                }
             }
-
-            auto d1 = object1->getMovable();
-            auto d2 = object2->getMovable();
-            // fprintf(stderr, "check collision of: %s / %s\n", object1->getName().c_str(), object2->getName().c_str());
-            if(d1 == d2)
+            const auto result = adaptiveCurrent.emplace(std::minmax(object1, object2), AdaptiveState{0, depth});
+            AdaptiveState &state = result.first->second;
+            if(!result.second)
             {
-                // fprintf(stderr, "\t\treturn since movables are the same\n");
+                state.depth = std::max(state.depth, depth);
                 return;
             }
-            if(d1 && d2 && d1->isLinkedFrame(d2))
+            if(previous && std::fabs(previous->depth - depth) < kRestingDepthChange)
             {
-                return;
+                state.stableSteps = previous->stableSteps + 1;
             }
-            // TODO: add method to check if these objects can collide
-            // for example have a std::map as blacklist for collisions in the objects
-            // Objects cannot collide if they are connected, or if they are in same group id's or
-            // for what ever reason
+        }
 
-            int maxNumContacts = 0;
-            // TODO: how to handle contact parameters
-            if(object1->c_params.max_num_contacts <
-                object2->c_params.max_num_contacts)
+        void CollisionSpace::setContactBudget(int maxContacts, double maxTime)
+        {
+            MutexLocker locker(&iMutex);
+            budgetMaxContacts = maxContacts;
+            budgetMaxTime = maxTime;
+            pairHistory.clear();
+            budgetReport = ContactBudgetReport{};
+        }
+
+        ContactBudgetReport CollisionSpace::getContactBudgetReport() const
+        {
+            MutexLocker locker(&iMutex);
+            return budgetReport;
+        }
+
+        void CollisionSpace::pairCallback(void *data, dGeomID o1, dGeomID o2)
+        {
+            reinterpret_cast<std::vector<std::pair<dGeomID, dGeomID>>*>(data)->emplace_back(o1, o2);
+        }
+
+        /**
+         * \brief Collides the broadphase pairs in the order of their priority
+         * until the budget is used up.
+         *
+         * Pairs are ordered by the higher contact_priority of their objects,
+         * then pairs deferred in the last step, then by the deepest contact of
+         * the pair in the last step (pairs that were not touching last). The
+         * pair that exceeds the contact limit is still completed. The
+         * remaining pairs are deferred to the next step and reported in
+         * budgetReport.
+         */
+        void CollisionSpace::generateBudgetedContacts(void)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::pair<dGeomID, dGeomID>> pairs;
+            if(sweepAndPrune)
             {
-                maxNumContacts = object1->c_params.max_num_contacts;
-            } else
+                collideIncremental(&pairs);
+            }
+            else
             {
-                maxNumContacts = object2->c_params.max_num_contacts;
+                dSpaceCollide(space, &pairs, &CollisionSpace::pairCallback);
             }
-            // fprintf(stderr, "\tmax_num_contacts: %d\n", maxNumContacts);
-            //  todo: for testing we override the max num contacts with one
-            // maxNumContacts = 1;
-            // TODO: Replaceable with vector?
-            auto* const contact = new dContact[maxNumContacts];
 
-            // TODO: Replaceable with std::max?
-            double filter_depth = -1.0;
-            if(object1->filter_depth > filter_depth)
+            // the object of a top level geom, spaces of objects may only
+            // store it in their geoms
+            auto objectOf = [](dGeomID geom) -> const Object*
             {
-                filter_depth = object1->filter_depth;
-            }
-            if(object2->filter_depth > filter_depth)
+                const Object *object = reinterpret_cast<Object*>(dGeomGetData(geom));
+                if(!object && dGeomIsSpace(geom) && dSpaceGetNumGeoms((dSpaceID)geom))
+                {
+                    object = reinterpret_cast<Object*>(dGeomGetData(dSpaceGetGeom((dSpaceID)geom, 0)));
+                }
+                return object;
+            };
+            struct Candidate
             {
-                filter_depth = object2->filter_depth;
-            }
-            // TODO: Replaceable with std::max?
-            double filter_angle = 0.5;
-            if(object1->filter_angle > 0.0)
+                dGeomID o1, o2;
+                std::pair<const Object*, const Object*> objects;
+                int priority;
+                bool deferred;
+                dReal depth;
+            };
+            std::vector<Candidate> candidates;
+            candidates.reserve(pairs.size());
+            for(const auto &pair : pairs)
             {
-                filter_angle = object1->filter_angle;
+                const Object *object1 = objectOf(pair.first);
+                const Object *object2 = objectOf(pair.second);
+                if(!object1 || !object2 || object1 == object2 || !canCollide(object1, object2))
+                {
+                    continue;
+                }
+                Candidate candidate{pair.first, pair.second, std::minmax(object1, object2),
+                                    std::max(object1->contact_priority, object2->contact_priority), false, -1.0};
+                const auto it = pairHistory.find(candidate.objects);
+                if(it != pairHistory.end())
+                {
+                    candidate.deferred = it->second.deferred;
+                    candidate.depth = it->second.depth;
+                }
+                candidates.push_back(candidate);
             }
-            if(object2->filter_angle > 0.0 and object2->filter_angle > object1->filter_angle)
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
             {
-                filter_angle = object2->filter_angle;
-            }
-
-            // TODO: Replaceable with std::max and conditional for sphere?
-            double filter_radius = -1.0;
-            Vector filter_sphere(0.0, 0.0, 0.0);
+                if(a.priority != b.priority)
+                {
+                    return a.priority > b.priority;
+                }
+                if(a.deferred != b.deferred)
+                {
+                    return a.deferred;
+                }
+                return a.depth > b.depth;
+            });
 
-            if(object1->filter_radius > filter_radius)
-            {
-                filter_radius = object1->filter_radius;
-                filter_sphere = object1->filter_sphere;
-            }
-            if(object2->filter_radius > filter_radius)
+            budgetReport = ContactBudgetReport{};
+            budgetReport.numPairs = candidates.size();
+            std::map<std::pair<const Object*, const Object*>, PairHistory> history;
+            for(const auto &candidate : candidates)
             {
-                filter_radius = object2->filter_radius;
-                filter_sphere = object2->filter_sphere;
+                if(!budgetReport.contactLimitReached && !budgetReport.timeLimitReached)
+                {
+                    budgetReport.contactLimitReached = budgetMaxContacts > 0 && (int)contactVector.size() >= budgetMaxContacts;
+                    budgetReport.timeLimitReached = budgetMaxTime > 0.0 &&
+                        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetMaxTime;
+                }
+                if(budgetReport.contactLimitReached || budgetReport.timeLimitReached)
+                {
+                    // keep the depth of the pair for its priority
+                    PairHistory &entry = history[candidate.objects];
+                    entry.deferred = true;
+                    entry.depth = std::max(entry.depth, candidate.depth);
+                    budgetReport.deferredPairs.emplace_back(candidate.objects.first->getName(),
+                                                            candidate.objects.second->getName());
+                    continue;
+                }
+                const size_t first = contactVector.size();
+                nearCallback(candidate.o1, candidate.o2);
+                budgetReport.numProcessed++;
+                if(contactVector.size() > first)
+                {
+                    PairHistory &entry = history[candidate.objects];
+                    for(size_t i=first; i<contactVector.size(); i++)
+                    {
+                        entry.depth = std::max(entry.depth, (dReal)contactVector[i].depth);
+                    }
+                }
             }
+            pairHistory.swap(history);
+            budgetReport.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
 
-            // frist we set the softness values:
-            contact[0].surface.mode = dContactSoftERP | dContactSoftCFM;
-            contact[0].surface.soft_cfm = (object1->c_params.cfm +
-                                           object2->c_params.cfm) /
-                                          2;
-            contact[0].surface.soft_erp = (object1->c_params.erp +
-                                           object2->c_params.erp) /
-                                          2;
-            // then check if one of the geoms want to use the pyramid approximation
-            if(object1->c_params.approx_pyramid ||
-                object2->c_params.approx_pyramid)
-                contact[0].surface.mode |= dContactApprox1;
-
-            // Then check the friction for both directions
-            contact[0].surface.mu = (object1->c_params.friction1 +
-                                     object2->c_params.friction1) /
-                                    2;
-            contact[0].surface.mu2 = (object1->c_params.friction2 +
-                                      object2->c_params.friction2) /
-                                     2;
+        void CollisionSpace::setContactIslands(bool enable)
+        {
+            MutexLocker locker(&iMutex);
+            partitionContacts = enable;
+            islandOffsets.clear();
+        }
 
-            if(contact[0].surface.mu != contact[0].surface.mu2)
+        bool CollisionSpace::getContactIslands(std::vector<size_t> *offsets) const
+        {
+            MutexLocker locker(&iMutex);
+            if(!partitionContacts)
             {
-                contact[0].surface.mode |= dContactMu2;
+                return false;
             }
+            *offsets = islandOffsets;
+            return true;
+        }
 
-            if(object1->c_params.rolling_friction > EPSILON ||
-                object2->c_params.rolling_friction > EPSILON)
+        /**
+         * \brief Sorts the contacts by island and body.
+         *
+         * The bodies are joined by union find over the contacts between two
+         * movable frames. Islands and bodies are numbered in the order of
+         * their first contact, so the order only changes with the contacts.
+         */
+        void CollisionSpace::partitionIslands(void)
+        {
+            islandOffsets.clear();
+            const size_t numContacts = contactVector.size();
+            std::map<const DynamicObject*, int> bodyIndex;
+            std::vector<int> parent;
+            auto indexOf = [&](const DynamicObject *body)
             {
-                contact[0].surface.mode |= dContactRolling;
-                contact[0].surface.rho = object1->c_params.rolling_friction + object2->c_params.rolling_friction;
-                // fprintf(stderr, "set rolling friction to: %g\n", contact[0].surface.rho);
-                if(object1->c_params.rolling_friction2 > EPSILON ||
-                    object2->c_params.rolling_friction2 > EPSILON)
+                if(!body)
                 {
-                    contact[0].surface.rho2 = object1->c_params.rolling_friction2 + object2->c_params.rolling_friction2;
-                } else
+                    return -1;
+                }
+                const auto it = bodyIndex.emplace(body, (int)parent.size());
+                if(it.second)
                 {
-                    contact[0].surface.rho2 = object1->c_params.rolling_friction + object2->c_params.rolling_friction;
+                    parent.push_back(it.first->second);
                 }
-                if(object1->c_params.spinning_friction > EPSILON ||
-                    object2->c_params.spinning_friction > EPSILON)
+                return it.first->second;
+            };
+            auto find = [&parent](int body)
+            {
+                while(parent[body] != body)
                 {
-                    contact[0].surface.rhoN = object1->c_params.spinning_friction + object2->c_params.spinning_friction;
-                } else
+                    parent[body] = parent[parent[body]];
+                    body = parent[body];
+                }
+                return body;
+            };
+
+            std::vector<std::array<int, 2>> contactBodies(numContacts);
+            for(size_t i=0; i<numContacts; i++)
+            {
+                const int body1 = indexOf(contactVector[i].body1.get());
+                const int body2 = indexOf(contactVector[i].body2.get());
+                contactBodies[i] = {body1, body2};
+                if(body1 >= 0 && body2 >= 0)
                 {
-                    contact[0].surface.rhoN = 0.0;
+                    const int root1 = find(body1);
+                    const int root2 = find(body2);
+                    parent[std::max(root1, root2)] = std::min(root1, root2);
                 }
             }
 
-            // check if we have to calculate friction direction1
-            if(object1->c_params.friction_direction1 ||
-                object2->c_params.friction_direction1)
+            // island, first and second body (static last), contact
+            std::vector<std::array<unsigned int, 4>> keys(numContacts);
+            std::vector<int> islandOfRoot(parent.size(), -1);
+            int numIslands = 0;
+            for(size_t i=0; i<numContacts; i++)
             {
-                // here the calculation becomes more complicated
-                // maybe we should make some restrictions
-                // so -> we only use friction motion in friction direction 1
-                // the friction motion is only set if a local vector for friction
+                const unsigned int body1 = contactBodies[i][0];
+                const unsigned int body2 = contactBodies[i][1];
+                // at least one body is movable, canCollide excludes two static objects
+                const int root = find((int)std::min(body1, body2));
+                if(islandOfRoot[root] < 0)
+                {
+                    islandOfRoot[root] = numIslands++;
+                }
+                keys[i] = {(unsigned int)islandOfRoot[root], std::min(body1, body2), std::max(body1, body2), (unsigned int)i};
+            }
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<ContactData> sorted;
+            sorted.reserve(numContacts);
+            std::vector<std::pair<const Object*, const Object*>> sortedObjects;
+            const bool hasObjects = contactObjects.size() == numContacts;
+            for(size_t i=0; i<numContacts; i++)
+            {
+                if(i == 0 || keys[i][0] != keys[i-1][0])
+                {
+                    islandOffsets.push_back(i);
+                }
+                sorted.push_back(std::move(contactVector[keys[i][3]]));
+                if(hasObjects)
+                {
+                    sortedObjects.push_back(contactObjects[keys[i][3]]);
+                }
+            }
+            islandOffsets.push_back(numContacts);
+            contactVector.swap(sorted);
+            if(hasObjects)
+            {
+                contactObjects.swap(sortedObjects);
+            }
+        }
+
+        void CollisionSpace::setContactIndex(bool enable)
+        {
+            MutexLocker locker(&iMutex);
+            indexContacts = enable;
+            contactObjects.clear();
+            contactIndex.clear();
+        }
+
+        /**
+         * \brief Groups the contacts of the last generation by object.
+         *
+         * The entries of objects are kept between the steps to reuse their
+         * memory. The contact normals point towards the first object of a
+         * contact and are flipped for the second one.
+         */
+        void CollisionSpace::buildContactIndex(void)
+        {
+            for(auto &it : contactIndex)
+            {
+                it.second.contacts.clear();
+                it.second.summary = ContactSummary{0, 0.0, Vector::Zero(), Vector::Zero()};
+            }
+            auto add = [this](const Object *object, size_t index, sReal sign)
+            {
+                ContactIndexEntry &entry = contactIndex[object];
+                const ContactData &contact = contactVector[index];
+                entry.contacts.push_back(index);
+                ContactSummary &summary = entry.summary;
+                summary.maxDepth = summary.numContacts ? std::max(summary.maxDepth, (sReal)contact.depth) : contact.depth;
+                summary.numContacts++;
+                summary.normalSum += sign*contact.normal;
+                // the sum of the positions until all contacts are added
+                summary.centroid += contact.pos;
+            };
+            for(size_t i=0; i<contactObjects.size(); i++)
+            {
+                add(contactObjects[i].first, i, 1.0);
+                add(contactObjects[i].second, i, -1.0);
+            }
+            for(auto &it : contactIndex)
+            {
+                if(it.second.summary.numContacts)
+                {
+                    it.second.summary.centroid /= it.second.summary.numContacts;
+                }
+            }
+        }
+
+        bool CollisionSpace::getContactsFor(const Object *object, std::vector<size_t> *indices,
+                                            ContactSummary *summary) const
+        {
+            MutexLocker locker(&iMutex);
+            if(!indexContacts)
+            {
+                return false;
+            }
+            const auto it = contactIndex.find(object);
+            if(it == contactIndex.end())
+            {
+                indices->clear();
+                if(summary)
+                {
+                    *summary = ContactSummary{0, 0.0, Vector::Zero(), Vector::Zero()};
+                }
+                return true;
+            }
+            *indices = it->second.contacts;
+            if(summary)
+            {
+                *summary = it->second.summary;
+            }
+            return true;
+        }
+
+        bool CollisionSpace::getContactsFor(const std::string &objectName, std::vector<size_t> *indices,
+                                            ContactSummary *summary) const
+        {
+            const Object *object = nullptr;
+            {
+                MutexLocker locker(&iMutex);
+                const auto it = objects.find(objectName);
+                if(it == objects.end())
+                {
+                    return false;
+                }
+                object = it->second;
+            }
+            return getContactsFor(object, indices, summary);
+        }
+
+        void CollisionSpace::addContactEventListener(ContactEventListener *listener)
+        {
+            MutexLocker locker(&iMutex);
+            if(std::find(contactEventListeners.begin(), contactEventListeners.end(), listener) == contactEventListeners.end())
+            {
+                contactEventListeners.push_back(listener);
+            }
+        }
+
+        void CollisionSpace::removeContactEventListener(ContactEventListener *listener)
+        {
+            MutexLocker locker(&iMutex);
+            contactEventListeners.erase(std::remove(contactEventListeners.begin(), contactEventListeners.end(), listener),
+                                        contactEventListeners.end());
+        }
+
+        void CollisionSpace::setContactEventOptions(bool queueEvents, bool persistEvents)
+        {
+            MutexLocker locker(&iMutex);
+            queueContactEvents = queueEvents;
+            persistContactEvents = persistEvents;
+            if(!queueEvents)
+            {
+                contactEvents.clear();
+            }
+        }
+
+        void CollisionSpace::pollContactEvents(std::vector<ContactEvent> *events)
+        {
+            MutexLocker locker(&iMutex);
+            events->clear();
+            events->swap(contactEvents);
+        }
+
+        void CollisionSpace::recordContactPair(const Object *object1, const Object *object2, int numContacts)
+        {
+            if(object2 < object1)
+            {
+                std::swap(object1, object2);
+            }
+            // several geoms of an object pair add up
+            auto &pair = contactPairs[std::make_pair(object1, object2)];
+            pair.numContacts += numContacts;
+        }
+
+        /**
+         * \brief Compares the touching object pairs of this and the previous
+         * contact generation.
+         *
+         * Both pair maps are ordered, so a single merge pass finds the pairs
+         * that began or ended touching. The names are only looked up when a
+         * pair begins and are kept for its end event, the objects may be
+         * deleted by then.
+         */
+        void CollisionSpace::publishContactEvents(void)
+        {
+            std::vector<ContactEvent> events;
+            auto current = contactPairs.begin();
+            auto previous = previousPairs.begin();
+            while(current != contactPairs.end() || previous != previousPairs.end())
+            {
+                if(previous == previousPairs.end() ||
+                   (current != contactPairs.end() && current->first < previous->first))
+                {
+                    current->second.nameObject1 = current->first.first->getName();
+                    current->second.nameObject2 = current->first.second->getName();
+                    events.push_back(ContactEvent{ContactEvent::kBegin, current->second.nameObject1,
+                                                  current->second.nameObject2, current->second.numContacts});
+                    ++current;
+                }
+                else if(current == contactPairs.end() || previous->first < current->first)
+                {
+                    events.push_back(ContactEvent{ContactEvent::kEnd, previous->second.nameObject1,
+                                                  previous->second.nameObject2, 0});
+                    ++previous;
+                }
+                else
+                {
+                    current->second.nameObject1.swap(previous->second.nameObject1);
+                    current->second.nameObject2.swap(previous->second.nameObject2);
+                    if(persistContactEvents)
+                    {
+                        events.push_back(ContactEvent{ContactEvent::kPersist, current->second.nameObject1,
+                                                      current->second.nameObject2, current->second.numContacts});
+                    }
+                    ++current;
+                    ++previous;
+                }
+            }
+            for(const auto &event : events)
+            {
+                for(auto *listener : contactEventListeners)
+                {
+                    listener->contactEvent(event);
+                }
+            }
+            if(queueContactEvents)
+            {
+                contactEvents.insert(contactEvents.end(), events.begin(), events.end());
+            }
+        }
+
+        void CollisionSpace::setIncrementalBroadphase(bool enable)
+        {
+            MutexLocker locker(&iMutex);
+            if(!enable)
+            {
+                sweepAndPrune.reset();
+                broadphaseGeoms.clear();
+                broadphaseHandles.clear();
+                // the geoms return to the hash space until the broadphase is enabled again
+                for(auto &it : fatBounds)
+                {
+                    if(it.second.proxy)
+                    {
+                        dGeomDestroy(it.second.proxy);
+                        it.second.proxy = nullptr;
+                        dSpaceAdd(space, it.first->getGeom());
+                    }
+                }
+            }
+            else if(!sweepAndPrune)
+            {
+                sweepAndPrune = std::make_unique<SweepAndPrune>();
+            }
+        }
+
+        /**
+         * \brief Updates the boxes of the geoms in the space that changed since
+         * the last step and calls nearCallback for all overlapping pairs (or
+         * appends them to pairs if given).
+         *
+         * Bounding boxes of unmoved geoms are cached by ode, so an unchanged
+         * scene only costs the comparison of the boxes. Geoms that left the
+         * space or were disabled are removed from the broadphase.
+         */
+        void CollisionSpace::collideIncremental(std::vector<std::pair<dGeomID, dGeomID>> *pairs)
+        {
+            dReal aabb[6];
+            std::vector<char> seen(broadphaseGeoms.size(), 0);
+            for(int i=0; i<dSpaceGetNumGeoms(space); i++)
+            {
+                dGeomID geom = dSpaceGetGeom(space, i);
+                if(!dGeomIsEnabled(geom))
+                {
+                    continue;
+                }
+                dGeomGetAABB(geom, aabb);
+                const auto it = broadphaseHandles.find(geom);
+                if(it == broadphaseHandles.end())
+                {
+                    const unsigned int handle = sweepAndPrune->add(aabb);
+                    if(handle >= broadphaseGeoms.size())
+                    {
+                        broadphaseGeoms.resize(handle+1);
+                        seen.resize(handle+1, 0);
+                    }
+                    broadphaseGeoms[handle] = geom;
+                    broadphaseHandles[geom] = handle;
+                    seen[handle] = 1;
+                    continue;
+                }
+                seen[it->second] = 1;
+                if(!std::equal(aabb, aabb+6, sweepAndPrune->getBounds(it->second).begin()))
+                {
+                    sweepAndPrune->update(it->second, aabb);
+                }
+            }
+            for(unsigned int handle=0; handle<broadphaseGeoms.size(); handle++)
+            {
+                if(broadphaseGeoms[handle] && !seen[handle])
+                {
+                    sweepAndPrune->remove(handle);
+                    broadphaseHandles.erase(broadphaseGeoms[handle]);
+                    broadphaseGeoms[handle] = nullptr;
+                }
+            }
+
+            for(const auto &pair : sweepAndPrune->getPairs())
+            {
+                dGeomID o1 = broadphaseGeoms[pair.box1];
+                dGeomID o2 = broadphaseGeoms[pair.box2];
+                // the test of ode's spaces
+                if(!(dGeomGetCategoryBits(o1) & dGeomGetCollideBits(o2)) &&
+                   !(dGeomGetCategoryBits(o2) & dGeomGetCollideBits(o1)))
+                {
+                    continue;
+                }
+                if(pairs)
+                {
+                    pairs->emplace_back(o1, o2);
+                }
+                else
+                {
+                    nearCallback(o1, o2);
+                }
+            }
+        }
+
+        /**
+         * \brief In this function the collision handling from ode is performed.
+         *
+         * pre:
+         *     - world_init = true
+         *     - o1 and o2 are regular geoms
+         *
+         * post:
+         *     - if o1 or o2 was a Space, called SpaceCollide and exit
+         *     - otherwise tested if the geoms collide and created a contact
+         *       joint if so.
+         *
+         * A lot of the code is uncommented in this function. This
+         * code maybe used later to handle sensors or other special cases
+         * in the simulation.
+         */
+        void CollisionSpace::nearCallback(dGeomID o1, dGeomID o2)
+        {
+            int i;
+            int numc;
+            // up to MAX_CONTACTS contact per Box-box
+            // dContact contact[MAX_CONTACTS];
+            dVector3 v1, v;
+            // dMatrix3 R;
+            dReal dot;
+
+            o1 = resolveProxy(o1);
+            o2 = resolveProxy(o2);
+            if(dGeomIsSpace(o1) || dGeomIsSpace(o2))
+            {
+                /// test if a space is colliding with something
+                dSpaceCollide2(o1, o2, this, &CollisionSpace::callbackForward);
+                return;
+            }
+
+            /// exit without doing anything if the two bodies are connected by a joint
+            // dBodyID b1=dGeomGetBody(o1);
+            // dBodyID b2=dGeomGetBody(o2);
+
+            const auto* const object1 = reinterpret_cast<Object*>(dGeomGetData(o1));
+            const auto* const object2 = reinterpret_cast<Object*>(dGeomGetData(o2));
+            if(!canCollide(object1, object2))
+            {
+                return;
+            }
+
+            // objects can provide a different representation for this pair
+            o1 = object1->selectPairGeom(o1, object2);
+            o2 = object2->selectPairGeom(o2, object1);
+
+            int maxNumContacts = 0;
+            // TODO: how to handle contact parameters
+            if(object1->c_params.max_num_contacts <
+                object2->c_params.max_num_contacts)
+            {
+                maxNumContacts = object1->c_params.max_num_contacts;
+            } else
+            {
+                maxNumContacts = object2->c_params.max_num_contacts;
+            }
+            // state of the pair in the last steps for the adaptive contact count
+            const AdaptiveState *adaptiveState = nullptr;
+            if(adaptiveContacts)
+            {
+                maxNumContacts = std::min(maxNumContacts, pairContactCount(o1, o2, maxNumContacts));
+                const auto it = adaptiveHistory.find(std::minmax(object1, object2));
+                if(it != adaptiveHistory.end())
+                {
+                    adaptiveState = &it->second;
+                }
+            }
+            // fprintf(stderr, "\tmax_num_contacts: %d\n", maxNumContacts);
+            //  todo: for testing we override the max num contacts with one
+            // maxNumContacts = 1;
+            // TODO: Replaceable with vector?
+            auto* const contact = new dContact[maxNumContacts];
+
+            // TODO: Replaceable with std::max?
+            double filter_angle = 0.5;
+            if(object1->filter_angle > 0.0)
+            {
+                filter_angle = object1->filter_angle;
+            }
+            if(object2->filter_angle > 0.0 and object2->filter_angle > object1->filter_angle)
+            {
+                filter_angle = object2->filter_angle;
+            }
+
+            const ContactFilter filter(object1, object2);
+
+            // frist we set the softness values:
+            contact[0].surface.mode = dContactSoftERP | dContactSoftCFM;
+            contact[0].surface.soft_cfm = (object1->c_params.cfm +
+                                           object2->c_params.cfm) /
+                                          2;
+            contact[0].surface.soft_erp = (object1->c_params.erp +
+                                           object2->c_params.erp) /
+                                          2;
+            // then check if one of the geoms want to use the pyramid approximation
+            if(object1->c_params.approx_pyramid ||
+                object2->c_params.approx_pyramid)
+                contact[0].surface.mode |= dContactApprox1;
+
+            // Then check the friction for both directions
+            contact[0].surface.mu = (object1->c_params.friction1 +
+                                     object2->c_params.friction1) /
+                                    2;
+            contact[0].surface.mu2 = (object1->c_params.friction2 +
+                                      object2->c_params.friction2) /
+                                     2;
+
+            if(contact[0].surface.mu != contact[0].surface.mu2)
+            {
+                contact[0].surface.mode |= dContactMu2;
+            }
+
+            if(object1->c_params.rolling_friction > EPSILON ||
+                object2->c_params.rolling_friction > EPSILON)
+            {
+                contact[0].surface.mode |= dContactRolling;
+                contact[0].surface.rho = object1->c_params.rolling_friction + object2->c_params.rolling_friction;
+                // fprintf(stderr, "set rolling friction to: %g\n", contact[0].surface.rho);
+                if(object1->c_params.rolling_friction2 > EPSILON ||
+                    object2->c_params.rolling_friction2 > EPSILON)
+                {
+                    contact[0].surface.rho2 = object1->c_params.rolling_friction2 + object2->c_params.rolling_friction2;
+                } else
+                {
+                    contact[0].surface.rho2 = object1->c_params.rolling_friction + object2->c_params.rolling_friction;
+                }
+                if(object1->c_params.spinning_friction > EPSILON ||
+                    object2->c_params.spinning_friction > EPSILON)
+                {
+                    contact[0].surface.rhoN = object1->c_params.spinning_friction + object2->c_params.spinning_friction;
+                } else
+                {
+                    contact[0].surface.rhoN = 0.0;
+                }
+            }
+
+            // check if we have to calculate friction direction1
+            if(object1->c_params.friction_direction1 ||
+                object2->c_params.friction_direction1)
+            {
+                // here the calculation becomes more complicated
+                // maybe we should make some restrictions
+                // so -> we only use friction motion in friction direction 1
+                // the friction motion is only set if a local vector for friction
                 // direction 1 is given
                 // the steps for the calculation:
                 // 1. rotate the local vectors to global coordinates
@@ -369,292 +1168,788 @@ namespace mars
                 contact[0].surface.mode |= dContactFDir1;
                 if(!object2->c_params.friction_direction1)
                 {
-                    // get the orientation of the geom
-                    // dGeomGetQuaternion(o1, v);
-                    // dRfromQ(R, v);
-                    // copy the friction direction
-                    v1[0] = object1->c_params.friction_direction1->x();
-                    v1[1] = object1->c_params.friction_direction1->y();
-                    v1[2] = object1->c_params.friction_direction1->z();
-                    // translate the friction direction to global coordinates
-                    // and set friction direction for contact
-                    // dMULTIPLY0_331(contact[0].fdir1, R, v1);
-                    contact[0].fdir1[0] = v1[0];
-                    contact[0].fdir1[1] = v1[1];
-                    contact[0].fdir1[2] = v1[2];
-                    if(object1->c_params.motion1)
+                    // get the orientation of the geom
+                    // dGeomGetQuaternion(o1, v);
+                    // dRfromQ(R, v);
+                    // copy the friction direction
+                    v1[0] = object1->c_params.friction_direction1->x();
+                    v1[1] = object1->c_params.friction_direction1->y();
+                    v1[2] = object1->c_params.friction_direction1->z();
+                    // translate the friction direction to global coordinates
+                    // and set friction direction for contact
+                    // dMULTIPLY0_331(contact[0].fdir1, R, v1);
+                    contact[0].fdir1[0] = v1[0];
+                    contact[0].fdir1[1] = v1[1];
+                    contact[0].fdir1[2] = v1[2];
+                    if(object1->c_params.motion1)
+                    {
+                        contact[0].surface.mode |= dContactMotion1;
+                        contact[0].surface.motion1 = object1->c_params.motion1;
+                    }
+                } else if(!object1->c_params.friction_direction1)
+                {
+                    // get the orientation of the geom
+                    // dGeomGetQuaternion(o2, v);
+                    // dRfromQ(R, v);
+                    // copy the friction direction
+                    v1[0] = object2->c_params.friction_direction1->x();
+                    v1[1] = object2->c_params.friction_direction1->y();
+                    v1[2] = object2->c_params.friction_direction1->z();
+                    // translate the friction direction to global coordinates
+                    // and set friction direction for contact
+                    // dMULTIPLY0_331(contact[0].fdir1, R, v1);
+                    contact[0].fdir1[0] = v1[0];
+                    contact[0].fdir1[1] = v1[1];
+                    contact[0].fdir1[2] = v1[2];
+                    if(object2->c_params.motion1)
+                    {
+                        contact[0].surface.mode |= dContactMotion1;
+                        contact[0].surface.motion1 = object2->c_params.motion1;
+                    }
+                } else
+                {
+                    // the calculation steps as mentioned above
+                    fprintf(stderr, "the calculation for friction directen set for both nodes is not done yet.\n");
+                }
+            }
+
+            // then check for fds
+            if(object1->c_params.fds1 || object2->c_params.fds1)
+            {
+                contact[0].surface.mode |= dContactSlip1;
+                contact[0].surface.slip1 = (object1->c_params.fds1 +
+                                            object2->c_params.fds1);
+            }
+            if(object1->c_params.fds2 || object2->c_params.fds2)
+            {
+                contact[0].surface.mode |= dContactSlip2;
+                contact[0].surface.slip2 = (object1->c_params.fds2 +
+                                            object2->c_params.fds2);
+            }
+            if(object1->c_params.bounce || object2->c_params.bounce)
+            {
+                contact[0].surface.mode |= dContactBounce;
+                contact[0].surface.bounce = (object1->c_params.bounce +
+                                             object2->c_params.bounce);
+                if(object1->c_params.bounce_vel > object2->c_params.bounce_vel)
+                    contact[0].surface.bounce_vel = object1->c_params.bounce_vel;
+                else
+                    contact[0].surface.bounce_vel = object2->c_params.bounce_vel;
+            }
+
+            for(i=1; i<maxNumContacts; i++)
+            {
+                contact[i] = contact[0];
+            }
+
+            // fprintf(stderr, "\tcall dCollide\n");
+
+            numc = dCollide(o1, o2, maxNumContacts, &contact[0].geom, sizeof(dContact));
+            if(numc)
+            {
+                Vector contact_point;
+
+                // TODO: add depth handling here too
+                int numAccepted = 0;
+                std::vector<char> keep(numc, 0);
+                for(i=0; i<numc; i++)
+                {
+                    if(filter.accepts(contact[i].geom))
+                    {
+                        keep[i] = 1;
+                        numAccepted++;
+                    }
+                }
+                // the smaller reduction of the two objects is used
+                int reduction = object1->contact_reduction;
+                if(object2->contact_reduction > 0 && (reduction <= 0 || object2->contact_reduction < reduction))
+                {
+                    reduction = object2->contact_reduction;
+                }
+                if(adaptiveState && adaptiveState->stableSteps >= kRestingSteps &&
+                   (reduction <= 0 || reduction > kRestingContacts))
+                {
+                    reduction = kRestingContacts;
+                }
+                if(reduction > 0 && numAccepted > reduction)
+                {
+                    reduceContacts(contact, &keep, reduction);
+                    numAccepted = reduction;
+                }
+                if(adaptiveStep && numAccepted)
+                {
+                    updateAdaptiveState(object1, object2, contact, keep, adaptiveState);
+                }
+                if(numAccepted)
+                {
+                    num_contacts++;
+                    if(collectPairs)
+                    {
+                        recordContactPair(object1, object2, numAccepted);
+                    }
+                }
+                if(create_contacts)
+                {
+                    for(i=0; i<numc; i++)
+                    {
+                        if(!keep[i])
+                        {
+                            continue;
+                        }
+                        if(object1->c_params.friction_direction1 ||
+                            object2->c_params.friction_direction1)
+                        {
+                            v[0] = contact[i].geom.normal[0];
+                            v[1] = contact[i].geom.normal[1];
+                            v[2] = contact[i].geom.normal[2];
+                            dot = dDOT(v, contact[i].fdir1);
+                            dOPEC(v, *=, dot);
+                            contact[i].fdir1[0] -= v[0];
+                            contact[i].fdir1[1] -= v[1];
+                            contact[i].fdir1[2] -= v[2];
+                            dNormalize3(contact[0].fdir1);
+                        }
+                        contact[i].geom.depth += (object1->c_params.depth_correction +
+                                                  object2->c_params.depth_correction);
+
+                        if(contact[i].geom.depth < 0.0)
+                            contact[i].geom.depth = 0.0;
+                        // transfer data from contact[i] to ContactData and store it in the contact list
+                        // also store frame1 and frame2 in ContactData
+                        ContactData cd;
+                        cd.pos.x() = contact[i].geom.pos[0];
+                        cd.pos.y() = contact[i].geom.pos[1];
+                        cd.pos.z() = contact[i].geom.pos[2];
+                        cd.depth = contact[i].geom.depth;
+                        cd.normal.x() = contact[i].geom.normal[0];
+                        cd.normal.y() = contact[i].geom.normal[1];
+                        cd.normal.z() = contact[i].geom.normal[2];
+                        cd.body1 = object1->getMovable();
+                        cd.body2 = object2->getMovable();
+                        cd.contactMaterialObject1 = object1->getMaterialAt(cd.pos);
+                        cd.contactMaterialObject2 = object2->getMaterialAt(cd.pos);
+                        // todo: add transfer of all contact parameters
+                        cd.c_params.cfm = contact[i].surface.soft_cfm;
+                        cd.c_params.erp = contact[i].surface.soft_erp;
+                        cd.c_params.friction1 = contact[i].surface.mu;
+                        cd.c_params.friction2 = contact[i].surface.mu2;
+                        cd.c_params.rolling_friction = contact[i].surface.rho;
+                        cd.c_params.rolling_friction2 = contact[i].surface.rho2;
+                        cd.c_params.spinning_friction = contact[i].surface.rhoN;
+                        cd.nameObject1 = object1->getName();
+                        cd.nameObject2 = object2->getName();
+                        contactVector.push_back(cd);
+                        if(indexContacts)
+                        {
+                            contactObjects.emplace_back(object1, object2);
+                        }
+                        // fprintf(stderr, "\t\tfound contact\n");
+                        //  if(object1->getMovable())
+                        //  {
+                        //      fprintf(stderr, "\t1: %s", object1->getMovable()->getName().c_str());
+                        //  }
+                        //  if(object2->getMovable())
+                        //  {
+                        //      fprintf(stderr, "\t2: %s", object2->getMovable()->getName().c_str());
+                        //  }
+                        //  fprintf(stderr, "\n");
+                        //  TODO: instead of creating the contact here we have to store it
+                        //        in our own contact structure
+                        // dJointID c=dJointCreateContact(world,contactgroup,contact+i);
+                        // dJointAttach(c,b1,b2);
+
+                        // TODO: replace num_ground_collisions with getNumContact in Object
+                        // TODO: we should have the information of contact points already in the contact object
+                        // contact_point.x() = contact[i].geom.pos[0];
+                        // contact_point.y() = contact[i].geom.pos[1];
+                        // contact_point.z() = contact[i].geom.pos[2];
+
+                        // object1->contact_ids.push_back(object2->id);
+                        // object2->contact_ids.push_back(object1->id);
+                        // object1->contact_points.push_back(contact_point);
+                        // object2->contact_points.push_back(contact_point);
+                    }
+                }
+            }
+            delete[] contact;
+        }
+
+        /**
+         * \brief This static function is used to project a normal function
+         *   pointer to a method from a class
+         *
+         * pre:
+         *     - data is a pointer to a correct object from type CollisionSpace
+         *
+         * post:
+         *     - the newCallback method of the data object should be called
+         */
+        void CollisionSpace::callbackForward(void *data, dGeomID o1, dGeomID o2)
+        {
+            auto* const cs = reinterpret_cast<CollisionSpace *>(data);
+            cs->nearCallback(o1, o2);
+        }
+
+        int CollisionSpace::handleCollision(dGeomID theGeom)
+        {
+            ray_collision = 0;
+            dSpaceCollide2(theGeom, (dGeomID)space, this,
+                           &CollisionSpace::callbackForward);
+            return ray_collision;
+        }
+
+        double CollisionSpace::getCollisionDepth(dGeomID theGeom)
+        {
+            dGeomID otherGeom;
+            dContact contact[1];
+            double depth = 0.0;
+            int numc;
+            dBodyID b1;
+            dBodyID b2;
+
+            for(int i=0; i<dSpaceGetNumGeoms(space); i++)
+            {
+                otherGeom = resolveProxy(dSpaceGetGeom(space, i));
+
+                if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
+                {
+                    continue;
+                }
+
+                b1 = dGeomGetBody(theGeom);
+                b2 = dGeomGetBody(otherGeom);
+
+                if(b1 && b2 && dAreConnectedExcluding(b1, b2, dJointTypeContact))
+                {
+                    continue;
+                }
+
+                numc = dCollide(theGeom, otherGeom, 1,
+                                &(contact[0].geom), sizeof(dContact));
+                // numc = dCollide(theGeom, otherGeom, 1 | CONTACTS_UNIMPORTANT,
+                //                 &(contact[0].geom), sizeof(dContact));
+                if(numc)
+                {
+                    if (contact[0].geom.depth > depth)
                     {
-                        contact[0].surface.mode |= dContactMotion1;
-                        contact[0].surface.motion1 = object1->c_params.motion1;
+                        depth = contact[0].geom.depth;
                     }
-                } else if(!object1->c_params.friction_direction1)
+                }
+            }
+
+            return depth;
+        }
+
+        /**
+         * \brief Returns false if the pair is excluded from collision.
+         *
+         * Objects cannot collide if their bitmasks do not match, if they belong
+         * to the same movable or if their movables are linked.
+         */
+        bool CollisionSpace::canCollide(const Object *object1, const Object *object2) const
+        {
+            if(!(object1->c_params.coll_bitmask & object2->c_params.coll_bitmask))
+            {
+                return false;
+            }
+            auto d1 = object1->getMovable();
+            auto d2 = object2->getMovable();
+            if(d1 == d2)
+            {
+                return false;
+            }
+            if(d1 && d2 && d1->isLinkedFrame(d2))
+            {
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Checks the space for colliding pairs without creating contacts.
+         *
+         * Each pair is tested for a single contact with CONTACTS_UNIMPORTANT
+         * unless a contact filter of the objects requires to look at all
+         * contacts. Returns the number of colliding pairs found; with
+         * stopAtFirst the check ends after the first one. The names of the
+         * colliding objects are appended to pairs if given.
+         */
+        int CollisionSpace::checkCollisions(bool stopAtFirst, std::vector<std::pair<std::string, std::string>> *pairs)
+        {
+            MutexLocker locker(&iMutex);
+            if(!space_init)
+            {
+                return 0;
+            }
+            completePendingObjects();
+            check = CollisionCheck{stopAtFirst, false, 0, pairs, nullptr, 0};
+            dSpaceCollide(space, this, &CollisionSpace::checkCallbackForward);
+            return check.numCollisions;
+        }
+
+        /**
+         * \brief Checks only the pairs that contain at least one of the given objects.
+         *
+         * Unknown names are ignored.
+         */
+        int CollisionSpace::checkCollisions(const std::vector<std::string> &objectNames, bool stopAtFirst,
+                                            std::vector<std::pair<std::string, std::string>> *pairs)
+        {
+            MutexLocker locker(&iMutex);
+            if(!space_init)
+            {
+                return 0;
+            }
+            completePendingObjects();
+            std::vector<const Object*> order;
+            std::map<const Object*, size_t> subset;
+            for(const auto &objectName : objectNames)
+            {
+                const auto it = objects.find(objectName);
+                if(it != objects.end() && it->second->getGeom() && subset.emplace(it->second, order.size()).second)
                 {
-                    // get the orientation of the geom
-                    // dGeomGetQuaternion(o2, v);
-                    // dRfromQ(R, v);
-                    // copy the friction direction
-                    v1[0] = object2->c_params.friction_direction1->x();
-                    v1[1] = object2->c_params.friction_direction1->y();
-                    v1[2] = object2->c_params.friction_direction1->z();
-                    // translate the friction direction to global coordinates
-                    // and set friction direction for contact
-                    // dMULTIPLY0_331(contact[0].fdir1, R, v1);
-                    contact[0].fdir1[0] = v1[0];
-                    contact[0].fdir1[1] = v1[1];
-                    contact[0].fdir1[2] = v1[2];
-                    if(object2->c_params.motion1)
+                    order.push_back(it->second);
+                }
+            }
+            check = CollisionCheck{stopAtFirst, false, 0, pairs, &subset, 0};
+            for(check.current=0; check.current<order.size() && !check.done; check.current++)
+            {
+                dSpaceCollide2(order[check.current]->getGeom(), (dGeomID)space, this, &CollisionSpace::checkCallbackForward);
+            }
+            check.subset = nullptr;
+            return check.numCollisions;
+        }
+
+        void CollisionSpace::checkCallback(dGeomID o1, dGeomID o2)
+        {
+            o1 = resolveProxy(o1);
+            o2 = resolveProxy(o2);
+            if(check.done || o1 == o2)
+            {
+                return;
+            }
+            if(dGeomIsSpace(o1) || dGeomIsSpace(o2))
+            {
+                dSpaceCollide2(o1, o2, this, &CollisionSpace::checkCallbackForward);
+                return;
+            }
+            const auto* const object1 = reinterpret_cast<Object*>(dGeomGetData(o1));
+            const auto* const object2 = reinterpret_cast<Object*>(dGeomGetData(o2));
+            if(object1 == object2 || !canCollide(object1, object2))
+            {
+                return;
+            }
+            if(check.subset)
+            {
+                // pairs of two subset objects are checked with the first of them
+                const auto it1 = check.subset->find(object1);
+                const auto it2 = check.subset->find(object2);
+                if((it1 != check.subset->end() && it1->second < check.current) ||
+                   (it2 != check.subset->end() && it2->second < check.current))
+                {
+                    return;
+                }
+            }
+            o1 = object1->selectPairGeom(o1, object2);
+            o2 = object2->selectPairGeom(o2, object1);
+
+            const ContactFilter filter(object1, object2);
+            int flags = 1 | CONTACTS_UNIMPORTANT;
+            if(filter.isActive())
+            {
+                // any of the contacts may pass the filter
+                flags = std::max(1, std::min(object1->c_params.max_num_contacts,
+                                             object2->c_params.max_num_contacts));
+            }
+            check.buffer.resize(flags & 0xffff);
+            const int numc = dCollide(o1, o2, flags, check.buffer.data(), sizeof(dContactGeom));
+            if(!std::any_of(check.buffer.begin(), check.buffer.begin()+numc,
+                            [&filter](const dContactGeom &contact) {return filter.accepts(contact);}))
+            {
+                return;
+            }
+            check.numCollisions++;
+            if(check.pairs)
+            {
+                check.pairs->emplace_back(object1->getName(), object2->getName());
+            }
+            check.done = check.stopAtFirst;
+        }
+
+        void CollisionSpace::checkCallbackForward(void *data, dGeomID o1, dGeomID o2)
+        {
+            reinterpret_cast<CollisionSpace *>(data)->checkCallback(o1, o2);
+        }
+
+        namespace
+        {
+            // the geoms of an object, objects with several geoms use a space
+            void getObjectGeoms(const Object *object, std::vector<dGeomID> *geoms)
+            {
+                geoms->clear();
+                dGeomID geom = object->getGeom();
+                if(!geom)
+                {
+                    return;
+                }
+                if(!dGeomIsSpace(geom))
+                {
+                    geoms->push_back(geom);
+                    return;
+                }
+                for(int i=0; i<dSpaceGetNumGeoms((dSpaceID)geom); i++)
+                {
+                    geoms->push_back(dSpaceGetGeom((dSpaceID)geom, i));
+                }
+            }
+
+            struct DistanceCandidates
+            {
+                dGeomID query;
+                std::set<const Object*> objects;
+            };
+        }
+
+        bool CollisionSpace::computeDistance(const Object *object1, const Object *object2, dReal maxDistance,
+                                             DistanceResult *result) const
+        {
+            if(object1 == object2 || !canCollide(object1, object2))
+            {
+                return false;
+            }
+            std::vector<dGeomID> geoms1, geoms2;
+            getObjectGeoms(object1, &geoms1);
+            getObjectGeoms(object2, &geoms2);
+            bool found = false;
+            DistanceResult candidate;
+            for(auto geom1 : geoms1)
+            {
+                geom1 = object1->selectPairGeom(geom1, object2);
+                for(auto geom2 : geoms2)
+                {
+                    geom2 = object2->selectPairGeom(geom2, object1);
+                    // later pairs only have to beat the current result
+                    const dReal bound = found ? result->distance : maxDistance;
+                    if(Distance::compute(geom1, geom2, bound, &candidate) &&
+                       (!found || candidate.distance < result->distance))
                     {
-                        contact[0].surface.mode |= dContactMotion1;
-                        contact[0].surface.motion1 = object2->c_params.motion1;
+                        *result = candidate;
+                        found = true;
                     }
-                } else
-                {
-                    // the calculation steps as mentioned above
-                    fprintf(stderr, "the calculation for friction directen set for both nodes is not done yet.\n");
                 }
             }
+            return found;
+        }
 
-            // then check for fds
-            if(object1->c_params.fds1 || object2->c_params.fds1)
+        bool CollisionSpace::getDistance(const std::string &objectName1, const std::string &objectName2,
+                                         dReal maxDistance, DistanceResult *result)
+        {
+            MutexLocker locker(&iMutex);
+            const auto it1 = objects.find(objectName1);
+            const auto it2 = objects.find(objectName2);
+            if(it1 == objects.end() || it2 == objects.end())
             {
-                contact[0].surface.mode |= dContactSlip1;
-                contact[0].surface.slip1 = (object1->c_params.fds1 +
-                                            object2->c_params.fds1);
+                LOG_ERROR("ode_collision::CollisionSpace: unknown object in distance query %s / %s",
+                          objectName1.c_str(), objectName2.c_str());
+                return false;
             }
-            if(object1->c_params.fds2 || object2->c_params.fds2)
+            return computeDistance(it1->second, it2->second, maxDistance, result);
+        }
+
+        void CollisionSpace::distanceCallback(void *data, dGeomID o1, dGeomID o2)
+        {
+            auto *candidates = reinterpret_cast<DistanceCandidates*>(data);
+            if(dGeomIsSpace(o1) || dGeomIsSpace(o2))
             {
-                contact[0].surface.mode |= dContactSlip2;
-                contact[0].surface.slip2 = (object1->c_params.fds2 +
-                                            object2->c_params.fds2);
+                dSpaceCollide2(o1, o2, data, &CollisionSpace::distanceCallback);
+                return;
             }
-            if(object1->c_params.bounce || object2->c_params.bounce)
+            dGeomID other = o1 == candidates->query ? o2 : o1;
+            if(other != candidates->query)
             {
-                contact[0].surface.mode |= dContactBounce;
-                contact[0].surface.bounce = (object1->c_params.bounce +
-                                             object2->c_params.bounce);
-                if(object1->c_params.bounce_vel > object2->c_params.bounce_vel)
-                    contact[0].surface.bounce_vel = object1->c_params.bounce_vel;
-                else
-                    contact[0].surface.bounce_vel = object2->c_params.bounce_vel;
+                candidates->objects.insert(reinterpret_cast<Object*>(dGeomGetData(other)));
             }
+        }
 
-            for(i=1; i<maxNumContacts; i++)
+        bool CollisionSpace::getDistance(const std::string &objectName, dReal maxDistance, DistanceResult *result,
+                                         std::string *closestObject)
+        {
+            MutexLocker locker(&iMutex);
+            const auto it = objects.find(objectName);
+            if(it == objects.end() || !it->second->getGeom() || !space_init)
             {
-                contact[i] = contact[0];
+                return false;
+            }
+            const Object *object = it->second;
+            DistanceCandidates candidates;
+            if(std::isfinite(maxDistance))
+            {
+                // a box covering the object and its surrounding within maxDistance
+                // collects the candidates from the broadphase
+                dReal aabb[6];
+                dGeomGetAABB(object->getGeom(), aabb);
+                candidates.query = dCreateBox(0, aabb[1]-aabb[0] + 2.0*maxDistance,
+                                              aabb[3]-aabb[2] + 2.0*maxDistance,
+                                              aabb[5]-aabb[4] + 2.0*maxDistance);
+                dGeomSetPosition(candidates.query, 0.5*(aabb[0]+aabb[1]), 0.5*(aabb[2]+aabb[3]),
+                                 0.5*(aabb[4]+aabb[5]));
+                dSpaceCollide2(candidates.query, (dGeomID)space, &candidates, &CollisionSpace::distanceCallback);
+                dGeomDestroy(candidates.query);
+            }
+            else
+            {
+                for(const auto &namedObject : objects)
+                {
+                    candidates.objects.insert(namedObject.second);
+                }
             }
 
-            // fprintf(stderr, "\tcall dCollide\n");
+            bool found = false;
+            DistanceResult candidate;
+            for(const auto *other : candidates.objects)
+            {
+                if(computeDistance(object, other, found ? result->distance : maxDistance, &candidate) &&
+                   (!found || candidate.distance < result->distance))
+                {
+                    *result = candidate;
+                    found = true;
+                    if(closestObject)
+                    {
+                        *closestObject = other->getName();
+                    }
+                }
+            }
+            return found;
+        }
 
-            numc = dCollide(o1, o2, maxNumContacts, &contact[0].geom, sizeof(dContact));
-            if(numc)
+        void CollisionSpace::getDistances(const std::vector<std::pair<std::string, std::string>> &pairs,
+                                          dReal maxDistance, std::vector<DistanceResult> *results)
+        {
+            MutexLocker locker(&iMutex);
+            results->resize(pairs.size());
+            for(size_t i=0; i<pairs.size(); i++)
             {
-                Vector contact_point;
+                DistanceResult &result = (*results)[i];
+                const auto it1 = objects.find(pairs[i].first);
+                const auto it2 = objects.find(pairs[i].second);
+                if(it1 == objects.end() || it2 == objects.end() ||
+                   !computeDistance(it1->second, it2->second, maxDistance, &result))
+                {
+                    result.distance = dInfinity;
+                }
+            }
+        }
 
-                // TODO: add depth handling here too
-                bool have_contact = false;
-                for(i=0; i<numc; i++)
+        namespace
+        {
+            // linear motion of a geom from its previous (t=0) to its current pose (t=1)
+            struct Sweep
+            {
+                Vector pos0, pos1;
+                Quaternion q0, q1;
+                // bound of the displacement of any point of the geom over the step
+                dReal motion;
+                // smallest half extent of the geom's bounding box
+                dReal extent;
+
+                void place(dGeomID geom, dReal t) const
                 {
-                    // filter_depth is used to filter heightmaps contact under the surface
-                    if(filter_depth > 0.0)
+                    const Vector pos = pos0 + t*(pos1-pos0);
+                    const Quaternion q = q0.slerp(t, q1);
+                    dGeomSetPosition(geom, pos.x(), pos.y(), pos.z());
+                    dQuaternion dQ = {q.w(), q.x(), q.y(), q.z()};
+                    dGeomSetQuaternion(geom, dQ);
+                }
+            };
+
+            /**
+             * Finds the first pose of the sweep that touches the other geom and
+             * leaves the geom slightly penetrating at that pose. Pairs supported
+             * by Distance use conservative advancement, others are sampled at
+             * steps of the geom's extent and refined by bisection.
+             */
+            bool findTimeOfImpact(dGeomID geom, dGeomID other, const Sweep &sweep, dReal *t)
+            {
+                const dReal tolerance = 0.05*sweep.extent;
+                dContactGeom contact;
+                const int flags = 1 | CONTACTS_UNIMPORTANT;
+                if(Distance::isSupported(geom) && Distance::isSupported(other))
+                {
+                    DistanceResult result;
+                    *t = 0.0;
+                    for(int i=0; i<64; i++)
                     {
-                        if(contact[i].geom.normal[2] < 0.5 or filter_depth < contact[i].geom.depth)
+                        sweep.place(geom, *t);
+                        if(!Distance::compute(geom, other, dInfinity, &result))
                         {
-                            continue;
+                            return false;
+                        }
+                        if(result.distance <= tolerance)
+                        {
+                            if(i == 0)
+                            {
+                                // touching before the step and separated after it
+                                return false;
+                            }
+                            // close the remaining gap to get contacts from dCollide
+                            Vector direction = result.point2 - result.point1;
+                            if(direction.norm() < EPSILON)
+                            {
+                                direction = sweep.pos1 - sweep.pos0;
+                            }
+                            const Vector shift = direction.normalized()*(std::max(result.distance, 0.0) + 0.5*tolerance);
+                            const dReal *pos = dGeomGetPosition(geom);
+                            dGeomSetPosition(geom, pos[0]+shift.x(), pos[1]+shift.y(), pos[2]+shift.z());
+                            return true;
                         }
-                    }
-                    if(filter_radius > 0.0)
-                    {
-                        Vector v;
-                        v.x() = contact[i].geom.pos[0];
-                        v.y() = contact[i].geom.pos[1];
-                        v.z() = 0.0; // contact[i].geom.pos[2];
-                        v -= filter_sphere;
-                        if(v.norm() <= filter_radius)
+                        // no point of the geom can cover the distance before
+                        *t += result.distance/sweep.motion;
+                        if(*t >= 1.0)
                         {
-                            continue;
+                            return false;
                         }
                     }
-                    have_contact = true;
-                    break;
-                }
-                if(have_contact)
-                {
-                    num_contacts++;
+                    return false;
                 }
-                if(create_contacts)
+
+                const int steps = std::min(64, (int)std::ceil(sweep.motion/sweep.extent));
+                dReal t0 = 0.0;
+                for(int s=1; s<steps; s++)
                 {
-                    for(i=0; i<numc; i++)
+                    dReal t1 = (dReal)s/steps;
+                    sweep.place(geom, t1);
+                    if(dCollide(geom, other, flags, &contact, sizeof(dContactGeom)))
                     {
-                        // filter_depth is used to filter heightmaps contact under the surface
-                        if(filter_depth > 0.0)
+                        for(int i=0; i<8; i++)
                         {
-                            if(contact[i].geom.normal[2] < 0.5 or filter_depth < contact[i].geom.depth)
+                            const dReal mid = 0.5*(t0+t1);
+                            sweep.place(geom, mid);
+                            if(dCollide(geom, other, flags, &contact, sizeof(dContactGeom)))
                             {
-                                // fprintf(stderr, "\t\tfilter contact\n");
-                                continue;
+                                t1 = mid;
                             }
-                        }
-                        if(filter_radius > 0.0)
-                        {
-                            Vector v;
-                            v.x() = contact[i].geom.pos[0];
-                            v.y() = contact[i].geom.pos[1];
-                            v.z() = 0.0; // contact[i].geom.pos[2];
-                            v -= filter_sphere;
-                            if(v.norm() <= filter_radius)
+                            else
                             {
-                                // fprintf(stderr, "\t\tfilter contact\n");
-                                continue;
+                                t0 = mid;
                             }
                         }
-                        if(object1->c_params.friction_direction1 ||
-                            object2->c_params.friction_direction1)
-                        {
-                            v[0] = contact[i].geom.normal[0];
-                            v[1] = contact[i].geom.normal[1];
-                            v[2] = contact[i].geom.normal[2];
-                            dot = dDOT(v, contact[i].fdir1);
-                            dOPEC(v, *=, dot);
-                            contact[i].fdir1[0] -= v[0];
-                            contact[i].fdir1[1] -= v[1];
-                            contact[i].fdir1[2] -= v[2];
-                            dNormalize3(contact[0].fdir1);
-                        }
-                        contact[i].geom.depth += (object1->c_params.depth_correction +
-                                                  object2->c_params.depth_correction);
-
-                        if(contact[i].geom.depth < 0.0)
-                            contact[i].geom.depth = 0.0;
-                        // transfer data from contact[i] to ContactData and store it in the contact list
-                        // also store frame1 and frame2 in ContactData
-                        ContactData cd;
-                        cd.pos.x() = contact[i].geom.pos[0];
-                        cd.pos.y() = contact[i].geom.pos[1];
-                        cd.pos.z() = contact[i].geom.pos[2];
-                        cd.depth = contact[i].geom.depth;
-                        cd.normal.x() = contact[i].geom.normal[0];
-                        cd.normal.y() = contact[i].geom.normal[1];
-                        cd.normal.z() = contact[i].geom.normal[2];
-                        cd.body1 = object1->getMovable();
-                        cd.body2 = object2->getMovable();
-                        cd.contactMaterialObject1 = object1->getMaterialAt(cd.pos);
-                        cd.contactMaterialObject2 = object2->getMaterialAt(cd.pos);
-                        // todo: add transfer of all contact parameters
-                        cd.c_params.cfm = contact[i].surface.soft_cfm;
-                        cd.c_params.erp = contact[i].surface.soft_erp;
-                        cd.c_params.friction1 = contact[i].surface.mu;
-                        cd.c_params.friction2 = contact[i].surface.mu2;
-                        cd.c_params.rolling_friction = contact[i].surface.rho;
-                        cd.c_params.rolling_friction2 = contact[i].surface.rho2;
-                        cd.c_params.spinning_friction = contact[i].surface.rhoN;
-                        cd.nameObject1 = object1->getName();
-                        cd.nameObject2 = object2->getName();
-                        contactVector.push_back(cd);
-                        // fprintf(stderr, "\t\tfound contact\n");
-                        //  if(object1->getMovable())
-                        //  {
-                        //      fprintf(stderr, "\t1: %s", object1->getMovable()->getName().c_str());
-                        //  }
-                        //  if(object2->getMovable())
-                        //  {
-                        //      fprintf(stderr, "\t2: %s", object2->getMovable()->getName().c_str());
-                        //  }
-                        //  fprintf(stderr, "\n");
-                        //  TODO: instead of creating the contact here we have to store it
-                        //        in our own contact structure
-                        // dJointID c=dJointCreateContact(world,contactgroup,contact+i);
-                        // dJointAttach(c,b1,b2);
-
-                        // TODO: replace num_ground_collisions with getNumContact in Object
-                        // TODO: we should have the information of contact points already in the contact object
-                        // contact_point.x() = contact[i].geom.pos[0];
-                        // contact_point.y() = contact[i].geom.pos[1];
-                        // contact_point.z() = contact[i].geom.pos[2];
-
-                        // object1->contact_ids.push_back(object2->id);
-                        // object2->contact_ids.push_back(object1->id);
-                        // object1->contact_points.push_back(contact_point);
-                        // object2->contact_points.push_back(contact_point);
+                        sweep.place(geom, t1);
+                        *t = t1;
+                        return true;
                     }
+                    t0 = t1;
                 }
+                return false;
             }
-            delete[] contact;
         }
 
         /**
-         * \brief This static function is used to project a normal function
-         *   pointer to a method from a class
+         * \brief Sweeps the objects with continuous collision detection from
+         * their previous to their current pose.
          *
-         * pre:
-         *     - data is a pointer to a correct object from type CollisionSpace
-         *
-         * post:
-         *     - the newCallback method of the data object should be called
+         * Only pairs that are separated at the current pose are swept, all
+         * others are handled by the discrete collision. The contacts of the
+         * first impact are created by nearCallback at the pose of impact and
+         * their depth is increased to the penetration the remaining motion of
+         * the step would cause. The other objects are considered at their
+         * current pose; of two swept objects only the first sweeps the pair.
+         * The contact budget does not apply to the swept pairs, in budget mode
+         * they are only counted in budgetReport.
          */
-        void CollisionSpace::callbackForward(void *data, dGeomID o1, dGeomID o2)
-        {
-            auto* const cs = reinterpret_cast<CollisionSpace *>(data);
-            cs->nearCallback(o1, o2);
-        }
-
-        int CollisionSpace::handleCollision(dGeomID theGeom)
+        void CollisionSpace::generateSweptContacts(void)
         {
-            ray_collision = 0;
-            dSpaceCollide2(theGeom, (dGeomID)space, this,
-                           &CollisionSpace::callbackForward);
-            return ray_collision;
-        }
-
-        double CollisionSpace::getCollisionDepth(dGeomID theGeom)
-        {
-            dGeomID otherGeom;
-            dContact contact[1];
-            double depth = 0.0;
-            int numc;
-            dBodyID b1;
-            dBodyID b2;
-
-            for(int i=0; i<dSpaceGetNumGeoms(space); i++)
+            const auto start = std::chrono::steady_clock::now();
+            const size_t firstSwept = contactVector.size();
+            size_t numSweptPairs = 0;
+            std::set<const Object*> swept;
+            std::vector<dGeomID> otherGeoms;
+            dContactGeom contact;
+            for(auto *object : ccdObjects)
             {
-                otherGeom = dSpaceGetGeom(space, i);
-
-                if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
+                swept.insert(object);
+                dGeomID geom = object->getGeom();
+                Sweep sweep;
+                if(!geom || dGeomIsSpace(geom) || !object->getPreviousPose(&sweep.pos0, &sweep.q0))
                 {
                     continue;
                 }
-
-                b1 = dGeomGetBody(theGeom);
-                b2 = dGeomGetBody(otherGeom);
-
-                if(b1 && b2 && dAreConnectedExcluding(b1, b2, dJointTypeContact))
+                const dReal *pos = dGeomGetPosition(geom);
+                sweep.pos1 = Vector(pos[0], pos[1], pos[2]);
+                dQuaternion dQ;
+                dGeomGetQuaternion(geom, dQ);
+                sweep.q1 = Quaternion(dQ[0], dQ[1], dQ[2], dQ[3]);
+
+                dReal aabb[6], aabb0[6];
+                dGeomGetAABB(geom, aabb);
+                dReal radius2 = 0.0;
+                sweep.extent = dInfinity;
+                for(int k=0; k<3; k++)
+                {
+                    const dReal r = std::max(std::fabs(aabb[k*2]-pos[k]), std::fabs(aabb[k*2+1]-pos[k]));
+                    radius2 += r*r;
+                    sweep.extent = std::min(sweep.extent, 0.5*(aabb[k*2+1]-aabb[k*2]));
+                }
+                sweep.motion = (sweep.pos1-sweep.pos0).norm() + sweep.q0.angularDistance(sweep.q1)*std::sqrt(radius2);
+                // slower objects can not pass through others between two steps
+                if(sweep.extent < EPSILON || sweep.motion < sweep.extent)
                 {
                     continue;
                 }
 
-                numc = dCollide(theGeom, otherGeom, 1,
-                                &(contact[0].geom), sizeof(dContact));
-                // numc = dCollide(theGeom, otherGeom, 1 | CONTACTS_UNIMPORTANT,
-                //                 &(contact[0].geom), sizeof(dContact));
-                if(numc)
+                // the broadphase collects the candidates within the swept bounds
+                sweep.place(geom, 0.0);
+                dGeomGetAABB(geom, aabb0);
+                sweep.place(geom, 1.0);
+                for(int k=0; k<3; k++)
                 {
-                    if (contact[0].geom.depth > depth)
+                    aabb[k*2] = std::min(aabb[k*2], aabb0[k*2]);
+                    aabb[k*2+1] = std::max(aabb[k*2+1], aabb0[k*2+1]);
+                }
+                DistanceCandidates candidates;
+                candidates.query = dCreateBox(0, aabb[1]-aabb[0], aabb[3]-aabb[2], aabb[5]-aabb[4]);
+                dGeomSetPosition(candidates.query, 0.5*(aabb[0]+aabb[1]), 0.5*(aabb[2]+aabb[3]),
+                                 0.5*(aabb[4]+aabb[5]));
+                dSpaceCollide2(candidates.query, (dGeomID)space, &candidates, &CollisionSpace::distanceCallback);
+                dGeomDestroy(candidates.query);
+
+                for(const auto *other : candidates.objects)
+                {
+                    if(swept.count(other) || !canCollide(object, other))
                     {
-                        depth = contact[0].geom.depth;
+                        continue;
+                    }
+                    getObjectGeoms(other, &otherGeoms);
+                    for(auto otherGeom : otherGeoms)
+                    {
+                        dGeomID pairGeom = other->selectPairGeom(otherGeom, object);
+                        dReal t;
+                        if(dCollide(geom, pairGeom, 1 | CONTACTS_UNIMPORTANT, &contact, sizeof(dContactGeom)) ||
+                           !findTimeOfImpact(geom, pairGeom, sweep, &t))
+                        {
+                            sweep.place(geom, 1.0);
+                            continue;
+                        }
+                        const size_t first = contactVector.size();
+                        nearCallback(geom, otherGeom);
+                        numSweptPairs++;
+                        const Vector remaining = (1.0-t)*(sweep.pos1-sweep.pos0);
+                        for(size_t i=first; i<contactVector.size(); i++)
+                        {
+                            contactVector[i].depth = std::max(contactVector[i].depth,
+                                                              (sReal)-remaining.dot(contactVector[i].normal));
+                        }
+                        sweep.place(geom, 1.0);
                     }
                 }
             }
-
-            return depth;
+            if(budgetMaxContacts > 0 || budgetMaxTime > 0.0)
+            {
+                budgetReport.numSweptPairs = numSweptPairs;
+                budgetReport.numSweptContacts = contactVector.size() - firstSwept;
+                budgetReport.sweptTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
         }
 
-        // int CollisionSpace::checkCollisions(void) {
-        //     MutexLocker locker(&iMutex);
-        //     num_contacts = log_contacts = 0;
-        //     create_contacts = 0;
-        //     dSpaceCollide(space,this, &CollisionSpace::callbackForward);
-        //     return num_contacts;
-        // }
-
         double CollisionSpace::getVectorCollision(const Vector &pos,
                                                   const Vector &ray) const
         {
@@ -673,7 +1968,7 @@ namespace mars
             // TODO: first check if there is a collision with the bounding box of the space
             for(int i=0; i<dSpaceGetNumGeoms(space); i++)
             {
-                otherGeom = dSpaceGetGeom(space, i);
+                otherGeom = resolveProxy(dSpaceGetGeom(space, i));
 
                 // todo: collision bits are not yet defined for rays
                 // if(!(dGeomGetCollideBits(theGeom) & dGeomGetCollideBits(otherGeom)))
@@ -836,9 +2131,54 @@ namespace mars
             {
                 const auto msg = std::string{"CollisionSpace::createObject: Replacing object named \""} + objectName + "\".";
                 LOG_WARN("%s", msg.c_str());
+                ccdObjects.erase(std::remove(ccdObjects.begin(), ccdObjects.end(), objects[objectName]),
+                                 ccdObjects.end());
+                removeFatBounds(objects[objectName]);
                 delete objects[objectName];
             }
             objects[objectName] = newObject;
+            // meshes create their geom after this call, thus hasLevelOfDetail
+            // is not known yet and the levels are taken from the config
+            bool levelOfDetail = false;
+            if(config.hasKey("lod"))
+            {
+                configmaps::ConfigMap &lod = config["lod"];
+                levelOfDetail = lod.hasKey("levels");
+            }
+            if(newObject->hasContinuousCollision())
+            {
+                if(levelOfDetail)
+                {
+                    LOG_WARN("CollisionSpace::createObject: continuous collision detection is not supported for object %s with level of detail.", objectName.c_str());
+                }
+                else
+                {
+                    ccdObjects.push_back(newObject);
+                }
+            }
+            if(config.hasKey("aabb_margin") || config.hasKey("aabb_velocity_factor"))
+            {
+                FatBounds bounds{};
+                if(config.hasKey("aabb_margin"))
+                {
+                    bounds.baseMargin = config["aabb_margin"];
+                }
+                if(config.hasKey("aabb_velocity_factor"))
+                {
+                    bounds.velocityFactor = config["aabb_velocity_factor"];
+                }
+                if(levelOfDetail)
+                {
+                    LOG_WARN("CollisionSpace::createObject: inflated bounding boxes are not supported for object %s with level of detail.", objectName.c_str());
+                }
+                else if(bounds.baseMargin > 0.0 || bounds.velocityFactor > 0.0)
+                {
+                    // the proxy is created with the first transform update while
+                    // the incremental broadphase is enabled, the hash space would
+                    // only pay for the proxy lookup
+                    fatBounds[newObject] = bounds;
+                }
+            }
             //if(movable)
             {
                 dynamicObjects.push_back(newObject);
@@ -848,10 +2188,202 @@ namespace mars
 
         void CollisionSpace::updateTransforms(void)
         {
+            completePendingObjects();
             for(auto &object : dynamicObjects)
             {
+                if(object->hasContinuousCollision())
+                {
+                    object->storePreviousPose();
+                }
                 object->updateTransform();
             }
+            // the hash space re-inserts every geom in each step anyway, only the
+            // incremental broadphase saves work for unchanged proxies
+            if(sweepAndPrune)
+            {
+                for(auto it=fatBounds.begin(); it!=fatBounds.end();)
+                {
+                    if(updateFatBounds(it->first, &it->second))
+                    {
+                        ++it;
+                        continue;
+                    }
+                    LOG_WARN("CollisionSpace: inflated bounding boxes are not supported for object %s.",
+                             it->first->getName().c_str());
+                    it = fatBounds.erase(it);
+                }
+            }
+            updateLevelsOfDetail();
+        }
+
+        /**
+         * \brief Maintains the proxy box of an object with an inflated
+         * bounding box.
+         *
+         * The geom of the object is taken out of the space and a box covering
+         * its bounding box plus the margin takes its place in the broadphase.
+         * The box is only rebuilt (and thus the space only changes) once the
+         * geom can have left it, which is decided by a bound of the motion of
+         * the geom since the rebuild without computing its bounding box. The
+         * narrowphase still collides the geom itself, see resolveProxy.
+         */
+        bool CollisionSpace::updateFatBounds(const Object *object, FatBounds *bounds)
+        {
+            dGeomID geom = object->getGeom();
+            if(!bounds->proxy)
+            {
+                if(!geom)
+                {
+                    // not created yet
+                    return true;
+                }
+                switch(dGeomIsSpace(geom) ? -1 : dGeomGetClass(geom))
+                {
+                case dSphereClass:
+                case dBoxClass:
+                case dCapsuleClass:
+                case dCylinderClass:
+                case dConvexClass:
+                case dTriMeshClass:
+                    break;
+                default:
+                    return false;
+                }
+                if(dGeomGetSpace(geom) != space)
+                {
+                    return false;
+                }
+                dSpaceRemove(space, geom);
+                bounds->proxy = dCreateBox(space, 1.0, 1.0, 1.0);
+                dGeomSetData(bounds->proxy, const_cast<Object*>(object));
+                dGeomSetCategoryBits(bounds->proxy, dGeomGetCategoryBits(geom));
+                dGeomSetCollideBits(bounds->proxy, dGeomGetCollideBits(geom));
+                rebuildFatBounds(geom, bounds, 0.0);
+                bounds->lastPos = bounds->pos;
+                bounds->lastQ = bounds->q;
+                return true;
+            }
+
+            const dReal *pos = dGeomGetPosition(geom);
+            dQuaternion dQ;
+            dGeomGetQuaternion(geom, dQ);
+            const Vector p(pos[0], pos[1], pos[2]);
+            const Quaternion q(dQ[0], dQ[1], dQ[2], dQ[3]);
+            // no point of the geom moves further than the translation plus
+            // the rotation angle times the radius
+            const dReal stepMotion = (p - bounds->lastPos).norm() + bounds->lastQ.angularDistance(q)*bounds->radius;
+            bounds->lastPos = p;
+            bounds->lastQ = q;
+            if((p - bounds->pos).norm() + bounds->q.angularDistance(q)*bounds->radius > bounds->margin)
+            {
+                rebuildFatBounds(geom, bounds, stepMotion);
+            }
+            return true;
+        }
+
+        void CollisionSpace::rebuildFatBounds(dGeomID geom, FatBounds *bounds, dReal stepMotion)
+        {
+            const dReal *pos = dGeomGetPosition(geom);
+            dQuaternion dQ;
+            dGeomGetQuaternion(geom, dQ);
+            bounds->pos = Vector(pos[0], pos[1], pos[2]);
+            bounds->q = Quaternion(dQ[0], dQ[1], dQ[2], dQ[3]);
+            bounds->margin = bounds->baseMargin + bounds->velocityFactor*stepMotion;
+
+            dReal aabb[6];
+            dGeomGetAABB(geom, aabb);
+            dReal radius2 = 0.0;
+            for(int k=0; k<3; k++)
+            {
+                const dReal r = std::max(std::fabs(aabb[k*2]-pos[k]), std::fabs(aabb[k*2+1]-pos[k]));
+                radius2 += r*r;
+            }
+            bounds->radius = std::sqrt(radius2);
+            dGeomBoxSetLengths(bounds->proxy, aabb[1]-aabb[0] + 2.0*bounds->margin,
+                               aabb[3]-aabb[2] + 2.0*bounds->margin,
+                               aabb[5]-aabb[4] + 2.0*bounds->margin);
+            dGeomSetPosition(bounds->proxy, 0.5*(aabb[0]+aabb[1]), 0.5*(aabb[2]+aabb[3]),
+                             0.5*(aabb[4]+aabb[5]));
+        }
+
+        void CollisionSpace::removeFatBounds(const Object *object)
+        {
+            const auto it = fatBounds.find(object);
+            if(it == fatBounds.end())
+            {
+                return;
+            }
+            if(it->second.proxy)
+            {
+                dGeomDestroy(it->second.proxy);
+            }
+            fatBounds.erase(it);
+        }
+
+        dGeomID CollisionSpace::resolveProxy(dGeomID geom)
+        {
+            if(dGeomIsSpace(geom) || dGeomGetClass(geom) != dBoxClass)
+            {
+                return geom;
+            }
+            const auto* const object = reinterpret_cast<Object*>(dGeomGetData(geom));
+            if(!object || !object->getCollisionSpace())
+            {
+                return geom;
+            }
+            const auto &bounds = object->getCollisionSpace()->fatBounds;
+            const auto it = bounds.find(object);
+            return it != bounds.end() && it->second.proxy == geom ? object->getGeom() : geom;
+        }
+
+        /**
+         * \brief Selects the collision resolution of objects with level of
+         * detail by the distance of their bounding box to the bounding boxes
+         * of all movable objects.
+         */
+        void CollisionSpace::updateLevelsOfDetail(void)
+        {
+            std::vector<Object*> lodObjects;
+            std::vector<std::pair<const Object*, std::array<dReal, 6>>> movableBounds;
+            for(auto &object : dynamicObjects)
+            {
+                if(object->hasLevelOfDetail())
+                {
+                    lodObjects.push_back(object);
+                }
+                if(object->getMovable() && object->getGeom())
+                {
+                    std::array<dReal, 6> aabb;
+                    dGeomGetAABB(object->getGeom(), aabb.data());
+                    movableBounds.emplace_back(object, aabb);
+                }
+            }
+            for(auto &object : lodObjects)
+            {
+                dReal aabb[6];
+                dGeomGetAABB(object->getGeom(), aabb);
+                const auto movable = object->getMovable();
+                dReal minDistance = dInfinity;
+                for(const auto &other : movableBounds)
+                {
+                    if(other.first == object || (movable && other.first->getMovable() == movable))
+                    {
+                        continue;
+                    }
+                    // ode aabb layout: min x, max x, min y, max y, min z, max z
+                    dReal distance2 = 0.0;
+                    for(int k=0; k<3; k++)
+                    {
+                        const dReal gap = std::max(aabb[k*2] - other.second[k*2+1], other.second[k*2] - aabb[k*2+1]);
+                        if(gap > 0.0)
+                        {
+                            distance2 += gap*gap;
+                        }
+                    }
+                    minDistance = std::min(minDistance, std::sqrt(distance2));
+                }
+                object->updateLevelOfDetail(minDistance);
+            }
         }
 
         void CollisionSpace::showDebugObjects(bool show)
@@ -869,6 +2401,32 @@ namespace mars
         {
             contactVector.clear();
             dynamicObjects.clear();
+            pendingObjects.clear();
+            ccdObjects.clear();
+            contactPairs.clear();
+            previousPairs.clear();
+            contactEvents.clear();
+            contactObjects.clear();
+            contactIndex.clear();
+            // keyed by the removed objects, new objects may reuse their addresses
+            pairHistory.clear();
+            adaptiveHistory.clear();
+            adaptiveCurrent.clear();
+            islandOffsets.clear();
+            if(sweepAndPrune)
+            {
+                sweepAndPrune->clear();
+                broadphaseGeoms.clear();
+                broadphaseHandles.clear();
+            }
+            for(auto &it : fatBounds)
+            {
+                if(it.second.proxy)
+                {
+                    dGeomDestroy(it.second.proxy);
+                }
+            }
+            fatBounds.clear();
             objects.clear();
         }
 
@@ -896,6 +2454,7 @@ namespace mars
                 {
                     num_contacts = log_contacts = 0;
                     this->contactVector.clear();
+                    contactObjects.clear();
                     dSpaceCollide2((dxGeom*)space, (dxGeom*)otherSpace->getSpace(), this, &CollisionSpace::callbackForward);
                     for(const auto &it : this->contactVector)
                     {
@@ -910,6 +2469,42 @@ namespace mars
             return space;
         }
 
+        WorkerPool& CollisionSpace::getWorkerPool()
+        {
+            if(!workerPool)
+            {
+                workerPool = std::make_unique<WorkerPool>();
+            }
+            return *workerPool;
+        }
+
+        void CollisionSpace::addPendingObject(Object *object)
+        {
+            pendingObjects.push_back(object);
+        }
+
+        void CollisionSpace::removePendingObject(Object *object)
+        {
+            pendingObjects.erase(std::remove(pendingObjects.begin(), pendingObjects.end(), object),
+                                 pendingObjects.end());
+        }
+
+        void CollisionSpace::completePendingObjects(bool wait)
+        {
+            auto it = pendingObjects.begin();
+            while(it != pendingObjects.end())
+            {
+                if((*it)->completeGeom(wait))
+                {
+                    it = pendingObjects.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
         configmaps::ConfigMap CollisionSpace::getConfigMap() const
         {
             configmaps::ConfigMap result;
@@ -923,6 +2518,7 @@ namespace mars
             }
             const auto objectsKey = std::string{"objects ("} + std::to_string(objects.size()) + ")";
             result[objectsKey] = objectsConfigMap;
+            result["incremental broadphase"] = (bool)sweepAndPrune;
 
             return result;
         }
@@ -14,10 +14,14 @@
 #include <mars_interfaces/sim/CollisionInterface.hpp>
 #include <data_broker/DataBrokerInterface.h>
 
+#include <memory>
 #include <vector>
 
 #include <ode/ode.h>
 
+#include "ContactEvent.hpp"
+#include "Distance.hpp"
+
 //#include "ContactsPhysics.hpp"
 
 namespace mars
@@ -26,6 +30,36 @@ namespace mars
     {
 
         class Object;
+        class WorkerPool;
+        class SweepAndPrune;
+        class ValidityChecker;
+
+        // aggregate of the contacts of an object in a contact generation
+        struct ContactSummary
+        {
+            int numContacts;
+            interfaces::sReal maxDepth;
+            // sum of the contact normals pointing towards the object
+            utils::Vector normalSum;
+            utils::Vector centroid;
+        };
+
+        // work of the last contact generation in budget mode
+        struct ContactBudgetReport
+        {
+            size_t numPairs = 0;
+            size_t numProcessed = 0;
+            // names of the object pairs deferred to the next step
+            std::vector<std::pair<std::string, std::string>> deferredPairs;
+            bool contactLimitReached = false;
+            bool timeLimitReached = false;
+            // seconds
+            double time = 0.0;
+            // swept pairs of ccd objects, they are not limited by the budget
+            size_t numSweptPairs = 0;
+            size_t numSweptContacts = 0;
+            double sweptTime = 0.0;
+        };
 
         /**
          * Declaration of the physical class, that implements the
@@ -62,15 +96,129 @@ namespace mars
 
             void registerSchemaValidators();
 
+            /**
+             * Boolean collision queries for planners, they use the current
+             * transforms and do not touch the contacts of generateContacts.
+             */
+            int checkCollisions(bool stopAtFirst=true,
+                                std::vector<std::pair<std::string, std::string>> *pairs=nullptr);
+            int checkCollisions(const std::vector<std::string> &objectNames, bool stopAtFirst=true,
+                                std::vector<std::pair<std::string, std::string>> *pairs=nullptr);
+            bool canCollide(const Object *object1, const Object *object2) const;
+
+            /**
+             * Distance queries between objects, pairs excluded by canCollide are
+             * ignored. They return false if no supported geoms are within
+             * maxDistance; the query against the space only considers objects
+             * whose boxes are within maxDistance (found by the broadphase).
+             */
+            bool getDistance(const std::string &objectName1, const std::string &objectName2,
+                             dReal maxDistance, DistanceResult *result);
+            bool getDistance(const std::string &objectName, dReal maxDistance, DistanceResult *result,
+                             std::string *closestObject=nullptr);
+            // distance is set to dInfinity for pairs without result
+            void getDistances(const std::vector<std::pair<std::string, std::string>> &pairs,
+                              dReal maxDistance, std::vector<DistanceResult> *results);
+
+            /**
+             * Replaces the broadphase of the hash space in generateContacts by
+             * an incremental sweep and prune over the top level geoms of the
+             * space (see SweepAndPrune). The pairs take the same path through
+             * nearCallback. Other queries still use the hash space. Inflated
+             * bounding boxes (aabb_margin, aabb_velocity_factor) only take
+             * effect with this broadphase.
+             */
+            void setIncrementalBroadphase(bool enable);
+
+            /**
+             * Contact events report the object pairs that began or ended
+             * touching between two calls of generateContacts (and optionally
+             * all pairs that kept touching). They are passed to the listeners
+             * and, if enabled, queued until pollContactEvents. The pairs are
+             * only tracked while one of the two is used.
+             */
+            void addContactEventListener(ContactEventListener *listener);
+            void removeContactEventListener(ContactEventListener *listener);
+            void setContactEventOptions(bool queueEvents, bool persistEvents=false);
+            // moves the queued events into events
+            void pollContactEvents(std::vector<ContactEvent> *events);
+
+            /**
+             * With the contact index enabled, generateContacts groups the
+             * contacts per object. getContactsFor returns the indices into the
+             * contacts of the last generation (in the order handed out by
+             * swapContacts and getContacts) and their summary. Objects without
+             * contacts get an empty list and a zero summary; false is returned
+             * for unknown objects or if the index is disabled.
+             */
+            void setContactIndex(bool enable);
+            bool getContactsFor(const Object *object, std::vector<size_t> *indices,
+                                ContactSummary *summary=nullptr) const;
+            bool getContactsFor(const std::string &objectName, std::vector<size_t> *indices,
+                                ContactSummary *summary=nullptr) const;
+
+            /**
+             * With islands enabled, generateContacts orders the contacts by
+             * islands: connected components of the movable frames through
+             * contacts, static objects do not connect islands. Within an
+             * island the contacts are grouped by their bodies. offsets
+             * receives the index of the first contact of each island followed
+             * by the number of contacts.
+             */
+            void setContactIslands(bool enable);
+            bool getContactIslands(std::vector<size_t> *offsets) const;
+
+            /**
+             * Limits the contacts and the wall time (in seconds) of the pair
+             * collisions in generateContacts, values <= 0 disable the limit.
+             * With a limit the broadphase pairs are collided by priority and
+             * the pairs left when the budget is used up are deferred to the
+             * next step (see generateBudgetedContacts). The swept pairs of
+             * ccd objects are exempt: a deferred sweep would lose the impact
+             * since the next step starts at the new pose. Their contacts and
+             * time are reported separately and do not count against the limits.
+             */
+            void setContactBudget(int maxContacts, double maxTime);
+            ContactBudgetReport getContactBudgetReport() const;
+
+            /**
+             * In adaptive mode the contacts per pair are limited by the geom
+             * classes of the pair (e.g. one for spheres, four for boxes on
+             * planes) below the max_num_contacts of the objects, and pairs
+             * resting for several steps are reduced to four contacts (see
+             * reduceContacts).
+             */
+            void setAdaptiveContacts(bool enable);
+
             int handleCollision(dGeomID theGeom);
             interfaces::sReal getCollisionDepth(dGeomID theGeom);
             dSpaceID getSpace();
 
+            // background preparation of collision data
+            WorkerPool& getWorkerPool();
+            void addPendingObject(Object *object);
+            void removePendingObject(Object *object);
+            /**
+             * Inserts all objects into the space whose data is prepared. If
+             * wait is set, the method blocks until all pending objects are
+             * created.
+             */
+            void completePendingObjects(bool wait=false);
+            /**
+             * Objects with an inflated bounding box (see updateFatBounds) are
+             * represented in the space by a proxy box. Returns the geom of the
+             * object for a proxy and the given geom otherwise.
+             */
+            static dGeomID resolveProxy(dGeomID geom);
+
             mutable utils::Mutex iMutex;
             dReal max_angular_speed;
             dReal max_correcting_vel;
 
         private:
+            // takes snapshots of the objects
+            friend class ValidityChecker;
+
             utils::Mutex drawLock;
             dSpaceID space;
             bool space_init;
@@ -80,6 +228,71 @@ namespace mars
             // NOTE: The Object* are deleted by removing the shared_ptr<Object> from the envireGraph in core::CollisionManager::clear.
             std::map<std::string, Object*> objects;
             std::vector<Object*> dynamicObjects;
+            std::vector<Object*> pendingObjects;
+            // objects with continuous collision detection
+            std::vector<Object*> ccdObjects;
+            std::unique_ptr<WorkerPool> workerPool;
+            std::unique_ptr<SweepAndPrune> sweepAndPrune;
+            // top level geom of the space per handle of sweepAndPrune
+            std::vector<dGeomID> broadphaseGeoms;
+            std::map<dGeomID, unsigned int> broadphaseHandles;
+
+            // touching object pairs (ordered by address) of the current and
+            // the previous contact generation
+            struct ContactPair
+            {
+                int numContacts = 0;
+                std::string nameObject1, nameObject2;
+            };
+            typedef std::map<std::pair<const Object*, const Object*>, ContactPair> ContactPairMap;
+            ContactPairMap contactPairs, previousPairs;
+            bool collectPairs, queueContactEvents, persistContactEvents;
+            std::vector<ContactEventListener*> contactEventListeners;
+            std::vector<ContactEvent> contactEvents;
+            void recordContactPair(const Object *object1, const Object *object2, int numContacts);
+            void publishContactEvents(void);
+
+            // objects of the contacts in contactVector while indexContacts is set
+            bool indexContacts;
+            std::vector<std::pair<const Object*, const Object*>> contactObjects;
+            struct ContactIndexEntry
+            {
+                std::vector<size_t> contacts;
+                ContactSummary summary;
+            };
+            std::map<const Object*, ContactIndexEntry> contactIndex;
+            void buildContactIndex(void);
+            bool partitionContacts;
+            std::vector<size_t> islandOffsets;
+            void partitionIslands(void);
+
+            bool adaptiveContacts;
+            // set while generateContacts updates the pair states
+            bool adaptiveStep;
+            struct AdaptiveState
+            {
+                int stableSteps;
+                // deepest contact of the step
+                dReal depth;
+            };
+            // states of the touching pairs of the last and the current step
+            std::map<std::pair<const Object*, const Object*>, AdaptiveState> adaptiveHistory, adaptiveCurrent;
+            void updateAdaptiveState(const Object *object1, const Object *object2, const dContact *contact,
+                                     const std::vector<char> &keep, const AdaptiveState *previous);
+
+            int budgetMaxContacts;
+            double budgetMaxTime;
+            ContactBudgetReport budgetReport;
+            struct PairHistory
+            {
+                // deepest contact of the last step, -1 if not touching
+                dReal depth = -1.0;
+                bool deferred = false;
+            };
+            // pairs that were touching or deferred in the last step
+            std::map<std::pair<const Object*, const Object*>, PairHistory> pairHistory;
+            void generateBudgetedContacts(void);
+            static void pairCallback(void *data, dGeomID o1, dGeomID o2);
 
             bool create_contacts, log_contacts;
             int num_contacts;
@@ -87,6 +300,54 @@ namespace mars
             // this functions are for the collision implementation
             void nearCallback (dGeomID o1, dGeomID o2);
             static void callbackForward(void *data, dGeomID o1, dGeomID o2);
+            // brings sweepAndPrune up to date and collides its pairs
+            void collideIncremental(std::vector<std::pair<dGeomID, dGeomID>> *pairs=nullptr);
+            // time of impact contacts of the objects with continuous collision detection
+            void generateSweptContacts(void);
+
+            // state of a running checkCollisions
+            struct CollisionCheck
+            {
+                bool stopAtFirst;
+                bool done;
+                int numCollisions;
+                std::vector<std::pair<std::string, std::string>> *pairs;
+                // index of the objects of a subset check
+                const std::map<const Object*, size_t> *subset;
+                size_t current;
+                std::vector<dContactGeom> buffer;
+            };
+            CollisionCheck check;
+            void checkCallback(dGeomID o1, dGeomID o2);
+            static void checkCallbackForward(void *data, dGeomID o1, dGeomID o2);
+
+            bool computeDistance(const Object *object1, const Object *object2, dReal maxDistance,
+                                 DistanceResult *result) const;
+            static void distanceCallback(void *data, dGeomID o1, dGeomID o2);
+
+            // broadphase proxy of an object with an inflated bounding box
+            struct FatBounds
+            {
+                dGeomID proxy;
+                // the margin is the base margin plus the velocity factor times
+                // the motion of the last step when the proxy is rebuilt
+                dReal baseMargin;
+                dReal velocityFactor;
+                dReal margin;
+                // pose of the geom when the proxy was built and in the last step
+                utils::Vector pos, lastPos;
+                utils::Quaternion q, lastQ;
+                // radius of the geom around its origin
+                dReal radius;
+            };
+            std::map<const Object*, FatBounds> fatBounds;
+            // returns false if the object is not supported
+            bool updateFatBounds(const Object *object, FatBounds *bounds);
+            void rebuildFatBounds(dGeomID geom, FatBounds *bounds, dReal stepMotion);
+            void removeFatBounds(const Object *object);
+
+            // selects the resolution of objects with level of detail
+            void updateLevelsOfDetail(void);
 
             // Step the World auxiliar methods
             void preStepChecks(void);
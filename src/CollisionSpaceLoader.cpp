@@ -14,6 +14,11 @@
 #include "objects/Cylinder.hpp"
 #include "objects/Capsule.hpp"
 #include "objects/Mesh.hpp"
+#include "objects/Convex.hpp"
+#include "objects/Compound.hpp"
+#include "objects/InstancedScatter.hpp"
+#include "objects/Sdf.hpp"
+#include "objects/VoxelGrid.hpp"
 
 namespace mars
 {
@@ -28,7 +33,12 @@ namespace mars
             ObjectFactory::Instance().addObjectType("heightfield", &Heightfield::instantiate);
             ObjectFactory::Instance().addObjectType("mesh", &Mesh::instantiate);
             ObjectFactory::Instance().addObjectType("cylinder", &Cylinder::instantiate);
-            ObjectFactory::Instance().addObjectType("capsule", &Capsule::instantiate);        
+            ObjectFactory::Instance().addObjectType("capsule", &Capsule::instantiate);
+            ObjectFactory::Instance().addObjectType("convex", &Convex::instantiate);
+            ObjectFactory::Instance().addObjectType("compound", &Compound::instantiate);
+            ObjectFactory::Instance().addObjectType("instanced_scatter", &InstancedScatter::instantiate);
+            ObjectFactory::Instance().addObjectType("sdf", &Sdf::instantiate);
+            ObjectFactory::Instance().addObjectType("voxelgrid", &VoxelGrid::instantiate);
         }
 
         CollisionSpaceLoader::~CollisionSpaceLoader(void)
@@ -0,0 +1,46 @@
+/**
+ * \file ContactEvent.hpp
+ * \brief "ContactEvent" describes the change of the touching state of an
+ *        object pair between two contact generations.
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        struct ContactEvent
+        {
+            enum Type
+            {
+                kBegin,
+                kPersist,
+                kEnd,
+            };
+            Type type;
+            std::string nameObject1;
+            std::string nameObject2;
+            // accepted contacts of the pair in the current step, 0 for kEnd
+            int numContacts;
+        };
+
+        /**
+         * Listeners are called from CollisionSpace::generateContacts while the
+         * space is locked and must not call back into the space.
+         */
+        class ContactEventListener
+        {
+        public:
+            virtual ~ContactEventListener()
+            {
+            }
+            virtual void contactEvent(const ContactEvent &event) = 0;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
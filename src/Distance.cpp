@@ -0,0 +1,742 @@
+/**
+ * \file Distance.cpp
+ * \brief "Distance" computes the minimum distance and closest points of two
+ *        geoms.
+ *
+ */
+
+#include "Distance.hpp"
+#include "AabbTree.hpp"
+#include "objects/Object.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+
+        namespace
+        {
+            const int kMaxIterations = 64;
+            // relative tolerance of the gjk termination
+            const dReal kRelativeTolerance = 1e-10;
+            // squared distance below which the core shapes are considered overlapping
+            const dReal kOverlapTolerance = 1e-16;
+
+            // vertices of the minkowski difference with their support points
+            struct Simplex
+            {
+                Vector w[4], a[4], b[4];
+                dReal lambda[4];
+                int size;
+
+                void keep(std::initializer_list<int> indices, std::initializer_list<dReal> weights)
+                {
+                    Vector nw[4], na[4], nb[4];
+                    int n = 0;
+                    auto weight = weights.begin();
+                    for(int i : indices)
+                    {
+                        nw[n] = w[i];
+                        na[n] = a[i];
+                        nb[n] = b[i];
+                        lambda[n++] = *weight++;
+                    }
+                    std::copy(nw, nw+n, w);
+                    std::copy(na, na+n, a);
+                    std::copy(nb, nb+n, b);
+                    size = n;
+                }
+
+                Vector closest() const
+                {
+                    Vector v = Vector::Zero();
+                    for(int i=0; i<size; i++)
+                    {
+                        v += lambda[i]*w[i];
+                    }
+                    return v;
+                }
+            };
+
+            void closestOnSegment(Simplex &s, int i0, int i1)
+            {
+                const Vector ab = s.w[i1] - s.w[i0];
+                const dReal length2 = ab.squaredNorm();
+                const dReal t = length2 > 0.0 ? -s.w[i0].dot(ab)/length2 : 0.0;
+                if(t <= 0.0)
+                {
+                    s.keep({i0}, {1.0});
+                }
+                else if(t >= 1.0)
+                {
+                    s.keep({i1}, {1.0});
+                }
+                else
+                {
+                    s.keep({i0, i1}, {1.0-t, t});
+                }
+            }
+
+            // closest point of the triangle to the origin by region, see Ericson,
+            // Real-Time Collision Detection, 5.1.5
+            void closestOnTriangle(Simplex &s, int i0, int i1, int i2)
+            {
+                const Vector &a = s.w[i0], &b = s.w[i1], &c = s.w[i2];
+                const Vector ab = b - a, ac = c - a;
+                const dReal d1 = -ab.dot(a), d2 = -ac.dot(a);
+                if(d1 <= 0.0 && d2 <= 0.0)
+                {
+                    s.keep({i0}, {1.0});
+                    return;
+                }
+                const dReal d3 = -ab.dot(b), d4 = -ac.dot(b);
+                if(d3 >= 0.0 && d4 <= d3)
+                {
+                    s.keep({i1}, {1.0});
+                    return;
+                }
+                const dReal vc = d1*d4 - d3*d2;
+                if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+                {
+                    const dReal t = d1/(d1-d3);
+                    s.keep({i0, i1}, {1.0-t, t});
+                    return;
+                }
+                const dReal d5 = -ab.dot(c), d6 = -ac.dot(c);
+                if(d6 >= 0.0 && d5 <= d6)
+                {
+                    s.keep({i2}, {1.0});
+                    return;
+                }
+                const dReal vb = d5*d2 - d1*d6;
+                if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+                {
+                    const dReal t = d2/(d2-d6);
+                    s.keep({i0, i2}, {1.0-t, t});
+                    return;
+                }
+                const dReal va = d3*d6 - d5*d4;
+                if(va <= 0.0 && (d4-d3) >= 0.0 && (d5-d6) >= 0.0)
+                {
+                    const dReal t = (d4-d3)/((d4-d3)+(d5-d6));
+                    s.keep({i1, i2}, {1.0-t, t});
+                    return;
+                }
+                const dReal sum = va + vb + vc;
+                if(sum <= 0.0)
+                {
+                    // degenerated triangle, the longest edge contains the closest point
+                    const dReal lab = ab.squaredNorm(), lac = ac.squaredNorm(), lbc = (c-b).squaredNorm();
+                    if(lab >= lac && lab >= lbc)
+                    {
+                        closestOnSegment(s, i0, i1);
+                    }
+                    else if(lac >= lbc)
+                    {
+                        closestOnSegment(s, i0, i2);
+                    }
+                    else
+                    {
+                        closestOnSegment(s, i1, i2);
+                    }
+                    return;
+                }
+                const dReal v = vb/sum, w = vc/sum;
+                s.keep({i0, i1, i2}, {1.0-v-w, v, w});
+            }
+
+            // returns true if the origin and the point opposite to abc are not
+            // on the same side of the plane through abc
+            bool originOutside(const Vector &a, const Vector &b, const Vector &c, const Vector &opposite)
+            {
+                const Vector normal = (b-a).cross(c-a);
+                const dReal signOpposite = (opposite-a).dot(normal);
+                // degenerated tetrahedra are reduced to their faces
+                if(signOpposite*signOpposite <= kOverlapTolerance*normal.squaredNorm())
+                {
+                    return true;
+                }
+                return (-a).dot(normal)*signOpposite < 0.0;
+            }
+
+            // returns false if the origin is inside of the tetrahedron
+            bool closestOnTetrahedron(Simplex &s)
+            {
+                static const int faces[4][4] = {{0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 3, 1}, {1, 2, 3, 0}};
+                Simplex best;
+                dReal bestDistance = dInfinity;
+                for(const auto &face : faces)
+                {
+                    if(!originOutside(s.w[face[0]], s.w[face[1]], s.w[face[2]], s.w[face[3]]))
+                    {
+                        continue;
+                    }
+                    Simplex candidate = s;
+                    closestOnTriangle(candidate, face[0], face[1], face[2]);
+                    const dReal distance = candidate.closest().squaredNorm();
+                    if(distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = candidate;
+                    }
+                }
+                if(bestDistance == dInfinity)
+                {
+                    return false;
+                }
+                s = best;
+                return true;
+            }
+
+            Matrix getRotationMatrix(dGeomID geom)
+            {
+                const dReal *r = dGeomGetRotation(geom);
+                Matrix rotation;
+                rotation << r[0], r[1], r[2],
+                            r[4], r[5], r[6],
+                            r[8], r[9], r[10];
+                return rotation;
+            }
+
+            dReal sign(dReal value)
+            {
+                return value < 0.0 ? -1.0 : 1.0;
+            }
+
+            void swapPoints(DistanceResult *result)
+            {
+                std::swap(result->point1, result->point2);
+            }
+
+            // covers the rounding of the triangles transformed back into mesh coordinates
+            const dReal kTriangleMargin = 1e-9;
+
+            // triangle boxes of a trimesh data in mesh coordinates, shared by
+            // all geoms of the data
+            struct TriangleTree
+            {
+                AabbTree tree;
+                int numTriangles;
+            };
+            std::mutex triangleTreesMutex;
+            std::map<dTriMeshDataID, std::shared_ptr<const TriangleTree>> triangleTrees;
+
+            std::shared_ptr<const TriangleTree> getTriangleTree(dGeomID mesh)
+            {
+                const dTriMeshDataID data = dGeomTriMeshGetData(mesh);
+                const int numTriangles = dGeomTriMeshGetTriangleCount(mesh);
+                std::lock_guard<std::mutex> lock(triangleTreesMutex);
+                std::shared_ptr<const TriangleTree> &cached = triangleTrees[data];
+                if(cached && cached->numTriangles == numTriangles)
+                {
+                    return cached;
+                }
+                // ode only returns the triangles in world coordinates
+                const dReal *p = dGeomGetPosition(mesh);
+                const Vector pos(p[0], p[1], p[2]);
+                const Matrix inverse = getRotationMatrix(mesh).transpose();
+                std::vector<AabbTree::Aabb> bounds(numTriangles);
+                for(int t=0; t<numTriangles; t++)
+                {
+                    dVector3 v[3];
+                    dGeomTriMeshGetTriangle(mesh, t, &v[0], &v[1], &v[2]);
+                    for(int i=0; i<3; i++)
+                    {
+                        const Vector local = inverse*(Vector(v[i][0], v[i][1], v[i][2]) - pos);
+                        for(int k=0; k<3; k++)
+                        {
+                            bounds[t][k*2] = i ? std::min(bounds[t][k*2], local[k]) : local[k];
+                            bounds[t][k*2+1] = i ? std::max(bounds[t][k*2+1], local[k]) : local[k];
+                        }
+                    }
+                    for(int k=0; k<3; k++)
+                    {
+                        bounds[t][k*2] -= kTriangleMargin;
+                        bounds[t][k*2+1] += kTriangleMargin;
+                    }
+                }
+                auto tree = std::make_shared<TriangleTree>();
+                tree->tree.build(bounds);
+                tree->numTriangles = numTriangles;
+                cached = tree;
+                return cached;
+            }
+
+            // world box grown by margin in the coordinates of the given geom
+            void toGeomBox(const dReal *aabb, dReal margin, dGeomID geom, dReal *out)
+            {
+                dReal grown[6];
+                for(int k=0; k<3; k++)
+                {
+                    grown[k*2] = aabb[k*2] - margin;
+                    grown[k*2+1] = aabb[k*2+1] + margin;
+                }
+                const dReal *p = dGeomGetPosition(geom);
+                const Matrix inverse = getRotationMatrix(geom).transpose();
+                AabbTree::transform(grown, -(inverse*Vector(p[0], p[1], p[2])), inverse, out);
+            }
+
+            // a box that overlaps nothing, ends a running tree query
+            void setEmpty(dReal *aabb)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    aabb[k*2] = dInfinity;
+                    aabb[k*2+1] = -dInfinity;
+                }
+            }
+        }
+
+        void Distance::releaseTriMeshData(dTriMeshDataID data)
+        {
+            std::lock_guard<std::mutex> lock(triangleTreesMutex);
+            triangleTrees.erase(data);
+        }
+
+        Vector Distance::Shape::support(const Vector &direction) const
+        {
+            const Vector local = rotation.transpose()*direction;
+            Vector point;
+            switch(type)
+            {
+            case kPoint:
+                return pos;
+            case kSegment:
+                point = Vector(0.0, 0.0, sign(local.z())*params[1]);
+                break;
+            case kBox:
+                point = Vector(sign(local.x())*params[0], sign(local.y())*params[1], sign(local.z())*params[2]);
+                break;
+            case kCylinder:
+            {
+                const dReal radial = std::sqrt(local.x()*local.x() + local.y()*local.y());
+                point = Vector(0.0, 0.0, sign(local.z())*params[1]);
+                if(radial > 0.0)
+                {
+                    point.x() = params[0]*local.x()/radial;
+                    point.y() = params[0]*local.y()/radial;
+                }
+                break;
+            }
+            case kPoints:
+            {
+                size_t best = 0;
+                dReal bestDot = -dInfinity;
+                for(size_t i=0; i<numPoints; i++)
+                {
+                    const dReal *p = points + i*3;
+                    const dReal dot = p[0]*local.x() + p[1]*local.y() + p[2]*local.z();
+                    if(dot > bestDot)
+                    {
+                        bestDot = dot;
+                        best = i;
+                    }
+                }
+                point = Vector(points[best*3], points[best*3+1], points[best*3+2]);
+                break;
+            }
+            }
+            return pos + rotation*point;
+        }
+
+        bool Distance::isSupported(dGeomID geom)
+        {
+            switch(dGeomGetClass(geom))
+            {
+            case dSphereClass:
+            case dCapsuleClass:
+            case dBoxClass:
+            case dCylinderClass:
+            case dPlaneClass:
+            case dTriMeshClass:
+                return true;
+            case dConvexClass:
+            {
+                const Object *object = reinterpret_cast<Object*>(dGeomGetData(geom));
+                return object && object->getConvexPoints(geom);
+            }
+            default:
+                return false;
+            }
+        }
+
+        bool Distance::getShape(dGeomID geom, Shape *shape)
+        {
+            const dReal *pos = dGeomGetPosition(geom);
+            shape->pos = Vector(pos[0], pos[1], pos[2]);
+            shape->rotation = getRotationMatrix(geom);
+            shape->margin = 0.0;
+            shape->points = nullptr;
+            shape->numPoints = 0;
+            switch(dGeomGetClass(geom))
+            {
+            case dSphereClass:
+                shape->type = Shape::kPoint;
+                shape->margin = dGeomSphereGetRadius(geom);
+                return true;
+            case dCapsuleClass:
+            {
+                dReal radius, length;
+                dGeomCapsuleGetParams(geom, &radius, &length);
+                shape->type = Shape::kSegment;
+                shape->params[1] = 0.5*length;
+                shape->margin = radius;
+                return true;
+            }
+            case dBoxClass:
+            {
+                dVector3 lengths;
+                dGeomBoxGetLengths(geom, lengths);
+                shape->type = Shape::kBox;
+                for(int k=0; k<3; k++)
+                {
+                    shape->params[k] = 0.5*lengths[k];
+                }
+                return true;
+            }
+            case dCylinderClass:
+            {
+                dReal radius, length;
+                dGeomCylinderGetParams(geom, &radius, &length);
+                shape->type = Shape::kCylinder;
+                shape->params[0] = radius;
+                shape->params[1] = 0.5*length;
+                return true;
+            }
+            case dConvexClass:
+            {
+                const Object *object = reinterpret_cast<Object*>(dGeomGetData(geom));
+                const std::vector<dReal> *points = object ? object->getConvexPoints(geom) : nullptr;
+                if(!points || points->size() < 3)
+                {
+                    return false;
+                }
+                shape->type = Shape::kPoints;
+                shape->points = points->data();
+                shape->numPoints = points->size()/3;
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * \brief Distance of two convex shapes by GJK.
+         *
+         * The iteration stops early with false if the lower bound of the
+         * distance exceeds maxDistance. overlap is set if the shapes
+         * including their margins intersect.
+         */
+        bool Distance::computeConvex(const Shape &shape1, const Shape &shape2, dReal maxDistance,
+                                     DistanceResult *result, bool *overlap)
+        {
+            const dReal margins = shape1.margin + shape2.margin;
+            const dReal cutoff = maxDistance + margins;
+            *overlap = false;
+
+            Simplex s;
+            Vector v = shape1.pos - shape2.pos;
+            if(v.squaredNorm() == 0.0)
+            {
+                v = Vector::UnitX();
+            }
+            s.a[0] = shape1.support(-v);
+            s.b[0] = shape2.support(v);
+            s.w[0] = s.a[0] - s.b[0];
+            s.lambda[0] = 1.0;
+            s.size = 1;
+            v = s.w[0];
+
+            for(int iteration=0; iteration<kMaxIterations; iteration++)
+            {
+                const dReal vv = v.squaredNorm();
+                if(vv <= kOverlapTolerance)
+                {
+                    *overlap = true;
+                    return true;
+                }
+                const Vector a = shape1.support(-v);
+                const Vector b = shape2.support(v);
+                const Vector w = a - b;
+                const dReal vw = v.dot(w);
+                // v.w/|v| is a lower bound of the distance
+                if(vw > 0.0 && vw*vw > cutoff*cutoff*vv)
+                {
+                    return false;
+                }
+                bool duplicate = false;
+                for(int i=0; i<s.size; i++)
+                {
+                    duplicate |= s.w[i] == w;
+                }
+                if(duplicate || vv - vw <= kRelativeTolerance*vv)
+                {
+                    break;
+                }
+                s.w[s.size] = w;
+                s.a[s.size] = a;
+                s.b[s.size] = b;
+                s.size++;
+                switch(s.size)
+                {
+                case 2:
+                    closestOnSegment(s, 0, 1);
+                    break;
+                case 3:
+                    closestOnTriangle(s, 0, 1, 2);
+                    break;
+                case 4:
+                    if(!closestOnTetrahedron(s))
+                    {
+                        *overlap = true;
+                        return true;
+                    }
+                    break;
+                }
+                const Vector next = s.closest();
+                if(next.squaredNorm() >= vv)
+                {
+                    // no progress due to numerical issues
+                    break;
+                }
+                v = next;
+            }
+
+            Vector point1 = Vector::Zero(), point2 = Vector::Zero();
+            for(int i=0; i<s.size; i++)
+            {
+                point1 += s.lambda[i]*s.a[i];
+                point2 += s.lambda[i]*s.b[i];
+            }
+            const Vector delta = point2 - point1;
+            const dReal coreDistance = delta.norm();
+            if(coreDistance <= margins)
+            {
+                *overlap = true;
+                return true;
+            }
+            const Vector normal = delta/coreDistance;
+            result->distance = coreDistance - margins;
+            result->point1 = point1 + normal*shape1.margin;
+            result->point2 = point2 - normal*shape2.margin;
+            return result->distance <= maxDistance;
+        }
+
+        bool Distance::computePlane(dGeomID plane, const Shape &shape, dReal maxDistance,
+                                    DistanceResult *result)
+        {
+            dVector4 params;
+            dGeomPlaneGetParams(plane, params);
+            const Vector normal(params[0], params[1], params[2]);
+            const Vector point = shape.support(-normal) - normal*shape.margin;
+            const dReal distance = normal.dot(point) - params[3];
+            if(distance > maxDistance)
+            {
+                return false;
+            }
+            result->distance = distance;
+            result->point1 = point - normal*distance;
+            result->point2 = point;
+            return true;
+        }
+
+        /**
+         * \brief Distance of a trimesh to another geom, triangle by triangle.
+         *
+         * The triangles are found in a tree over their boxes in mesh
+         * coordinates, built once per trimesh data. The query box is the box of
+         * the other geom grown by the current distance bound and shrinks with
+         * every closer triangle. The triangles are treated as surface, thus a
+         * geom inside of a closed mesh is not overlapping.
+         */
+        bool Distance::computeTriMesh(dGeomID mesh, dGeomID other, dReal maxDistance,
+                                      DistanceResult *result, bool *overlap)
+        {
+            *overlap = false;
+            const bool otherIsMesh = dGeomGetClass(other) == dTriMeshClass;
+            const bool otherIsPlane = dGeomGetClass(other) == dPlaneClass;
+            Shape otherShape;
+            if(!otherIsMesh && !otherIsPlane && !getShape(other, &otherShape))
+            {
+                return false;
+            }
+            dReal otherAabb[6];
+            dGeomGetAABB(other, otherAabb);
+
+            auto triangleShape = [](dGeomID geom, int index, dReal *points, dReal *aabb, Shape *shape)
+            {
+                dVector3 v[3];
+                dGeomTriMeshGetTriangle(geom, index, &v[0], &v[1], &v[2]);
+                for(int k=0; k<3; k++)
+                {
+                    aabb[k*2] = std::min(v[0][k], std::min(v[1][k], v[2][k]));
+                    aabb[k*2+1] = std::max(v[0][k], std::max(v[1][k], v[2][k]));
+                    for(int i=0; i<3; i++)
+                    {
+                        points[i*3+k] = v[i][k];
+                    }
+                }
+                shape->type = Shape::kPoints;
+                shape->pos = Vector::Zero();
+                shape->rotation = Matrix::Identity();
+                shape->margin = 0.0;
+                shape->points = points;
+                shape->numPoints = 3;
+            };
+            auto expanded = [](const dReal *aabb, dReal margin, dReal *out)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    out[k*2] = aabb[k*2] - margin;
+                    out[k*2+1] = aabb[k*2+1] + margin;
+                }
+            };
+
+            const std::shared_ptr<const TriangleTree> meshTree = getTriangleTree(mesh);
+            std::shared_ptr<const TriangleTree> otherTree;
+            if(otherIsMesh)
+            {
+                otherTree = getTriangleTree(other);
+            }
+
+            bool found = false;
+            dReal bound = maxDistance;
+            DistanceResult candidate;
+            dReal points1[9], points2[9], aabb1[6], aabb2[6], search[6], otherSearch[6];
+            Shape triangle1, triangle2;
+            // the running queries read the search boxes at every node
+            toGeomBox(otherAabb, bound, mesh, search);
+            auto update = [&](bool pairFound, bool pairOverlap)
+            {
+                if(pairOverlap)
+                {
+                    *overlap = true;
+                    setEmpty(search);
+                    setEmpty(otherSearch);
+                    return;
+                }
+                if(pairFound && (!found || candidate.distance < result->distance))
+                {
+                    *result = candidate;
+                    bound = candidate.distance;
+                    found = true;
+                    toGeomBox(otherAabb, bound, mesh, search);
+                    if(otherIsMesh)
+                    {
+                        toGeomBox(aabb1, bound, other, otherSearch);
+                    }
+                }
+            };
+            meshTree->tree.query(search, [&](unsigned int t1)
+            {
+                triangleShape(mesh, t1, points1, aabb1, &triangle1);
+                dReal box[6];
+                expanded(aabb1, bound, box);
+                if(!AabbTree::overlaps(box, otherAabb))
+                {
+                    return;
+                }
+                bool pairOverlap = false;
+                if(otherIsPlane)
+                {
+                    const bool pairFound = computePlane(other, triangle1, bound, &candidate);
+                    swapPoints(&candidate);
+                    update(pairFound, pairFound && candidate.distance < 0.0);
+                }
+                else if(otherIsMesh)
+                {
+                    toGeomBox(aabb1, bound, other, otherSearch);
+                    otherTree->tree.query(otherSearch, [&](unsigned int t2)
+                    {
+                        triangleShape(other, t2, points2, aabb2, &triangle2);
+                        expanded(aabb1, bound, box);
+                        if(!AabbTree::overlaps(box, aabb2))
+                        {
+                            return;
+                        }
+                        const bool pairFound = computeConvex(triangle1, triangle2, bound, &candidate, &pairOverlap);
+                        update(pairFound, pairOverlap);
+                    });
+                }
+                else
+                {
+                    const bool pairFound = computeConvex(triangle1, otherShape, bound, &candidate, &pairOverlap);
+                    update(pairFound, pairOverlap);
+                }
+            });
+            return found || *overlap;
+        }
+
+        void Distance::computePenetration(dGeomID geom1, dGeomID geom2, DistanceResult *result)
+        {
+            dContactGeom contacts[8];
+            const int n = dCollide(geom1, geom2, 8, contacts, sizeof(dContactGeom));
+            // touching geoms may not generate a contact
+            const dReal *pos = dGeomGetPosition(geom1);
+            result->distance = 0.0;
+            result->point1 = Vector(pos[0], pos[1], pos[2]);
+            for(int i=0; i<n; i++)
+            {
+                if(i == 0 || -contacts[i].depth < result->distance)
+                {
+                    result->distance = -contacts[i].depth;
+                    result->point1 = Vector(contacts[i].pos[0], contacts[i].pos[1], contacts[i].pos[2]);
+                }
+            }
+            result->point2 = result->point1;
+        }
+
+        bool Distance::compute(dGeomID geom1, dGeomID geom2, dReal maxDistance, DistanceResult *result)
+        {
+            if(!isSupported(geom1) || !isSupported(geom2))
+            {
+                return false;
+            }
+            const int class1 = dGeomGetClass(geom1), class2 = dGeomGetClass(geom2);
+            bool found = false, overlap = false;
+            Shape shape1, shape2;
+            if(class1 == dPlaneClass && class2 == dPlaneClass)
+            {
+                return false;
+            }
+            else if(class1 == dTriMeshClass)
+            {
+                found = computeTriMesh(geom1, geom2, maxDistance, result, &overlap);
+            }
+            else if(class2 == dTriMeshClass)
+            {
+                found = computeTriMesh(geom2, geom1, maxDistance, result, &overlap);
+                swapPoints(result);
+            }
+            else if(class1 == dPlaneClass)
+            {
+                found = getShape(geom2, &shape2) && computePlane(geom1, shape2, maxDistance, result);
+            }
+            else if(class2 == dPlaneClass)
+            {
+                found = getShape(geom1, &shape1) && computePlane(geom2, shape1, maxDistance, result);
+                swapPoints(result);
+            }
+            else if(getShape(geom1, &shape1) && getShape(geom2, &shape2))
+            {
+                found = computeConvex(shape1, shape2, maxDistance, result, &overlap);
+            }
+            if(overlap)
+            {
+                computePenetration(geom1, geom2, result);
+                return true;
+            }
+            return found;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,96 @@
+/**
+ * \file Distance.hpp
+ * \brief "Distance" computes the minimum distance and closest points of two
+ *        geoms.
+ *
+ */
+
+#pragma once
+
+#include <mars_utils/Vector.h>
+#include <ode/ode.h>
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        struct DistanceResult
+        {
+            // negative penetration depth if the geoms overlap
+            dReal distance;
+            // closest points on the first and second geom in world coordinates
+            utils::Vector point1;
+            utils::Vector point2;
+        };
+
+        /**
+         * Convex shapes (spheres, capsules, boxes, cylinders and the hulls of
+         * Convex objects) are handled by GJK on their core shapes, the radius
+         * of spheres and capsules is added as margin. Trimeshes are handled
+         * triangle by triangle using a tree over the triangles that is cached
+         * per trimesh data, planes in closed form. For overlapping geoms
+         * the distance is the negative depth of the deepest contact reported by
+         * dCollide.
+         */
+        class Distance
+        {
+        public:
+            static bool isSupported(dGeomID geom);
+
+            /**
+             * \brief Computes the distance of two geoms.
+             *
+             * Returns false if one of the geoms is not supported or if the
+             * geoms are further apart than maxDistance.
+             */
+            static bool compute(dGeomID geom1, dGeomID geom2, dReal maxDistance, DistanceResult *result);
+
+            /**
+             * \brief Drops the cached triangle tree of a trimesh data.
+             *
+             * Has to be called before the data is rebuilt with other vertices
+             * or destroyed.
+             */
+            static void releaseTriMeshData(dTriMeshDataID data);
+
+        private:
+            struct Shape
+            {
+                enum Type
+                {
+                    kPoint,
+                    kSegment,
+                    kBox,
+                    kCylinder,
+                    kPoints,
+                };
+                Type type;
+                utils::Vector pos;
+                utils::Matrix rotation;
+                // box: half lengths, cylinder and segment: radius and half length
+                dReal params[3];
+                // radius around the core shape
+                dReal margin;
+                // kPoints: local x, y, z triples
+                const dReal *points;
+                size_t numPoints;
+
+                // support point of the core shape in world coordinates
+                utils::Vector support(const utils::Vector &direction) const;
+            };
+
+            static bool getShape(dGeomID geom, Shape *shape);
+            static bool computeConvex(const Shape &shape1, const Shape &shape2, dReal maxDistance,
+                                      DistanceResult *result, bool *overlap);
+            static bool computePlane(dGeomID plane, const Shape &shape, dReal maxDistance,
+                                     DistanceResult *result);
+            static bool computeTriMesh(dGeomID mesh, dGeomID other, dReal maxDistance,
+                                       DistanceResult *result, bool *overlap);
+            static void computePenetration(dGeomID geom1, dGeomID geom2, DistanceResult *result);
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
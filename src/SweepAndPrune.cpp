@@ -0,0 +1,185 @@
+#include "SweepAndPrune.hpp"
+
+#include <algorithm>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        unsigned int SweepAndPrune::add(const dReal *aabb)
+        {
+            unsigned int handle;
+            if(freeHandles.empty())
+            {
+                handle = boxes.size();
+                boxes.emplace_back();
+            }
+            else
+            {
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+            }
+            Box &box = boxes[handle];
+            std::copy(aabb, aabb+6, box.aabb.begin());
+            box.used = true;
+
+            // a new box has no previous order, its pairs are found directly
+            for(unsigned int i=0; i<boxes.size(); i++)
+            {
+                if(i != handle && boxes[i].used && AabbTree::overlaps(boxes[i].aabb.data(), aabb))
+                {
+                    addPair(handle, i);
+                }
+            }
+            for(int axis=0; axis<3; axis++)
+            {
+                for(uint32_t k=0; k<2; k++)
+                {
+                    axes[axis].push_back(Endpoint{aabb[axis*2+k], handle*2+k});
+                    sift(axis, axes[axis].size()-1, false);
+                }
+            }
+            return handle;
+        }
+
+        void SweepAndPrune::update(unsigned int handle, const dReal *aabb)
+        {
+            Box &box = boxes[handle];
+            std::copy(aabb, aabb+6, box.aabb.begin());
+            for(int axis=0; axis<3; axis++)
+            {
+                std::vector<Endpoint> &endpoints = axes[axis];
+                const uint32_t minPosition = box.endpoints[axis*2];
+                const uint32_t maxPosition = box.endpoints[axis*2+1];
+                const bool moveUp = aabb[axis*2] > endpoints[minPosition].value;
+                endpoints[minPosition].value = aabb[axis*2];
+                endpoints[maxPosition].value = aabb[axis*2+1];
+                // the leading endpoint moves first, so that the endpoints of
+                // the box never pass each other
+                if(moveUp)
+                {
+                    sift(axis, maxPosition, true);
+                    sift(axis, box.endpoints[axis*2], true);
+                }
+                else
+                {
+                    sift(axis, minPosition, true);
+                    sift(axis, box.endpoints[axis*2+1], true);
+                }
+            }
+        }
+
+        void SweepAndPrune::remove(unsigned int handle)
+        {
+            for(size_t i=0; i<pairs.size();)
+            {
+                if(pairs[i].box1 == handle || pairs[i].box2 == handle)
+                {
+                    removePair(pairs[i].box1, pairs[i].box2);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            for(int axis=0; axis<3; axis++)
+            {
+                std::vector<Endpoint> &endpoints = axes[axis];
+                endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(),
+                                               [handle](const Endpoint &e) {return e.id/2 == handle;}),
+                                endpoints.end());
+                for(uint32_t i=0; i<endpoints.size(); i++)
+                {
+                    boxes[endpoints[i].id/2].endpoints[axis*2+(endpoints[i].id & 1)] = i;
+                }
+            }
+            boxes[handle].used = false;
+            freeHandles.push_back(handle);
+        }
+
+        void SweepAndPrune::clear()
+        {
+            for(int axis=0; axis<3; axis++)
+            {
+                axes[axis].clear();
+            }
+            boxes.clear();
+            freeHandles.clear();
+            pairs.clear();
+            pairIndex.clear();
+        }
+
+        /**
+         * Moves the endpoint at position to its place. The order of two
+         * boxes along an axis only decides their overlap on that axis when a
+         * min and a max endpoint swap; for those the pair is tested with the
+         * current boxes. Every pair whose overlap changed since the last
+         * update has such a swap on at least one axis.
+         */
+        void SweepAndPrune::sift(int axis, uint32_t position, bool evaluate)
+        {
+            std::vector<Endpoint> &endpoints = axes[axis];
+            const Endpoint endpoint = endpoints[position];
+            const uint32_t box = endpoint.id/2;
+            auto swap = [&](const Endpoint &other)
+            {
+                const uint32_t otherBox = other.id/2;
+                if(evaluate && otherBox != box && (other.id & 1) != (endpoint.id & 1))
+                {
+                    if(AabbTree::overlaps(boxes[box].aabb.data(), boxes[otherBox].aabb.data()))
+                    {
+                        addPair(box, otherBox);
+                    }
+                    else
+                    {
+                        removePair(box, otherBox);
+                    }
+                }
+            };
+            while(position > 0 && less(endpoint, endpoints[position-1]))
+            {
+                swap(endpoints[position-1]);
+                endpoints[position] = endpoints[position-1];
+                boxes[endpoints[position].id/2].endpoints[axis*2+(endpoints[position].id & 1)] = position;
+                position--;
+            }
+            while(position+1 < endpoints.size() && less(endpoints[position+1], endpoint))
+            {
+                swap(endpoints[position+1]);
+                endpoints[position] = endpoints[position+1];
+                boxes[endpoints[position].id/2].endpoints[axis*2+(endpoints[position].id & 1)] = position;
+                position++;
+            }
+            endpoints[position] = endpoint;
+            boxes[box].endpoints[axis*2+(endpoint.id & 1)] = position;
+        }
+
+        void SweepAndPrune::addPair(uint32_t box1, uint32_t box2)
+        {
+            if(pairIndex.emplace(pairKey(box1, box2), pairs.size()).second)
+            {
+                pairs.push_back(Pair{box1, box2});
+            }
+        }
+
+        void SweepAndPrune::removePair(uint32_t box1, uint32_t box2)
+        {
+            const auto it = pairIndex.find(pairKey(box1, box2));
+            if(it == pairIndex.end())
+            {
+                return;
+            }
+            // the last pair takes the place of the removed one
+            const size_t index = it->second;
+            pairIndex.erase(it);
+            if(index+1 < pairs.size())
+            {
+                pairs[index] = pairs.back();
+                pairIndex[pairKey(pairs[index].box1, pairs[index].box2)] = index;
+            }
+            pairs.pop_back();
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,92 @@
+/**
+ * \file SweepAndPrune.hpp
+ * \brief "SweepAndPrune" is an incremental broadphase that keeps the set of
+ *        overlapping boxes up to date while the boxes move.
+ *
+ */
+
+#pragma once
+
+#include "AabbTree.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The endpoints of all boxes are kept sorted along each axis between
+         * updates. A moved box is sorted back into place by insertion sort and
+         * only the pairs whose endpoints swapped are tested again, so the cost
+         * of an update is proportional to the change of the order and not to
+         * the number of boxes. Boxes use the ode layout (see AabbTree) and are
+         * closed: touching boxes overlap.
+         */
+        class SweepAndPrune
+        {
+        public:
+            struct Pair
+            {
+                unsigned int box1;
+                unsigned int box2;
+            };
+
+            // returns the handle of the new box, handles of removed boxes are reused
+            unsigned int add(const dReal *aabb);
+            void update(unsigned int handle, const dReal *aabb);
+            void remove(unsigned int handle);
+            void clear();
+
+            const AabbTree::Aabb& getBounds(unsigned int handle) const
+            {
+                return boxes[handle].aabb;
+            }
+            // the currently overlapping pairs in no particular order
+            const std::vector<Pair>& getPairs() const
+            {
+                return pairs;
+            }
+
+        private:
+            struct Endpoint
+            {
+                dReal value;
+                // box handle times two, plus one for the max endpoint
+                uint32_t id;
+            };
+            struct Box
+            {
+                AabbTree::Aabb aabb;
+                // position of the endpoints in the axes in ode layout
+                uint32_t endpoints[6];
+                bool used;
+            };
+
+            static bool less(const Endpoint &a, const Endpoint &b)
+            {
+                // min endpoints first on equal values to keep boxes closed
+                return a.value < b.value || (a.value == b.value && (a.id & 1) < (b.id & 1));
+            }
+            static uint64_t pairKey(uint32_t box1, uint32_t box2)
+            {
+                return box1 < box2 ? ((uint64_t)box1 << 32) | box2 : ((uint64_t)box2 << 32) | box1;
+            }
+
+            void sift(int axis, uint32_t position, bool evaluate);
+            void addPair(uint32_t box1, uint32_t box2);
+            void removePair(uint32_t box1, uint32_t box2);
+
+            std::vector<Endpoint> axes[3];
+            std::vector<Box> boxes;
+            std::vector<unsigned int> freeHandles;
+            std::vector<Pair> pairs;
+            // index into pairs
+            std::unordered_map<uint64_t, size_t> pairIndex;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
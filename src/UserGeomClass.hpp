@@ -0,0 +1,49 @@
+/**
+ * \file UserGeomClass.hpp
+ * \brief "UserGeomClass" holds the helpers shared by the objects that are
+ *        collided through an ode user geom class.
+ *
+ */
+
+#pragma once
+
+#include <ode/ode.h>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * Compound, InstancedScatter, Sdf and VoxelGrid each register one
+         * user geom class on first use. The class data of their geoms is the
+         * pointer to the object. Ode supports only dMaxUserClasses (4) user
+         * classes, thus these objects use up all slots; another user class
+         * requires an ode build with a larger limit.
+         */
+        class UserGeomClass
+        {
+        public:
+            // the lower 16 bits of the collider flags hold the contact count
+            static const int kNumContactsMask = 0xffff;
+
+            static int create(int bytes, dGetColliderFnFn *collider, dGetAABBFn *aabb)
+            {
+                dGeomClass geomClass;
+                geomClass.bytes = bytes;
+                geomClass.collider = collider;
+                geomClass.aabb = aabb;
+                geomClass.aabb_test = nullptr;
+                geomClass.dtor = nullptr;
+                return dCreateGeomClass(&geomClass);
+            }
+
+            // contact index of the collider output with the given stride
+            static dContactGeom* contactAt(dContactGeom *contact, int index, int skip)
+            {
+                return reinterpret_cast<dContactGeom*>(reinterpret_cast<char*>(contact) + index*skip);
+            }
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
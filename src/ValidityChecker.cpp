@@ -0,0 +1,438 @@
+/**
+ * \file ValidityChecker.cpp
+ * \brief "ValidityChecker" evaluates batches of candidate poses of a group of
+ *        objects against a snapshot of the collision space.
+ *
+ */
+
+#include "ValidityChecker.hpp"
+#include "CollisionSpace.hpp"
+#include "Distance.hpp"
+#include "WorkerPool.hpp"
+#include "objects/Object.hpp"
+
+#include <mars_utils/MutexLocker.h>
+#include <mars_interfaces/Logging.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <map>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+
+        namespace
+        {
+            /**
+             * Creates a geom outside of any space with the shape and pose of the
+             * given geom. Returns nullptr for classes that cannot be copied.
+             */
+            dGeomID cloneGeom(dGeomID geom)
+            {
+                dGeomID clone = nullptr;
+                switch(dGeomGetClass(geom))
+                {
+                case dSphereClass:
+                    clone = dCreateSphere(0, dGeomSphereGetRadius(geom));
+                    break;
+                case dBoxClass:
+                {
+                    dVector3 lengths;
+                    dGeomBoxGetLengths(geom, lengths);
+                    clone = dCreateBox(0, lengths[0], lengths[1], lengths[2]);
+                    break;
+                }
+                case dCapsuleClass:
+                {
+                    dReal radius, length;
+                    dGeomCapsuleGetParams(geom, &radius, &length);
+                    clone = dCreateCapsule(0, radius, length);
+                    break;
+                }
+                case dCylinderClass:
+                {
+                    dReal radius, length;
+                    dGeomCylinderGetParams(geom, &radius, &length);
+                    clone = dCreateCylinder(0, radius, length);
+                    break;
+                }
+                case dPlaneClass:
+                {
+                    // planes are not placeable
+                    dVector4 params;
+                    dGeomPlaneGetParams(geom, params);
+                    clone = dCreatePlane(0, params[0], params[1], params[2], params[3]);
+                    dGeomSetData(clone, dGeomGetData(geom));
+                    return clone;
+                }
+                case dTriMeshClass:
+                    // the trimesh data is only read during collision
+                    clone = dCreateTriMesh(0, dGeomTriMeshGetData(geom), nullptr, nullptr, nullptr);
+                    break;
+                case dHeightfieldClass:
+                    clone = dCreateHeightfield(0, dGeomHeightfieldGetHeightfieldData(geom), 1);
+                    break;
+                default:
+                    return nullptr;
+                }
+                const dReal *pos = dGeomGetPosition(geom);
+                dGeomSetPosition(clone, pos[0], pos[1], pos[2]);
+                dGeomSetRotation(clone, dGeomGetRotation(geom));
+                dGeomSetData(clone, dGeomGetData(geom));
+                return clone;
+            }
+
+            void setGeomPose(dGeomID geom, const ValidityChecker::Pose &pose)
+            {
+                dGeomSetPosition(geom, pose.pos.x(), pose.pos.y(), pose.pos.z());
+                dQuaternion dQ = {pose.q.w(), pose.q.x(), pose.q.y(), pose.q.z()};
+                dGeomSetQuaternion(geom, dQ);
+            }
+
+            /**
+             * Calls function with the live geom moved to the given pose and
+             * moves it back afterwards. The caller has to hold iMutex.
+             */
+            template<typename Function>
+            void atPose(dGeomID geom, const dReal *pos, const dReal *rotation, Function &&function)
+            {
+                dVector3 currentPos;
+                dMatrix3 currentRotation;
+                std::copy(dGeomGetPosition(geom), dGeomGetPosition(geom)+3, currentPos);
+                std::copy(dGeomGetRotation(geom), dGeomGetRotation(geom)+12, currentRotation);
+                dGeomSetPosition(geom, pos[0], pos[1], pos[2]);
+                dGeomSetRotation(geom, rotation);
+                function();
+                dGeomSetPosition(geom, currentPos[0], currentPos[1], currentPos[2]);
+                dGeomSetRotation(geom, currentRotation);
+            }
+        }
+
+        ValidityChecker::ValidityChecker(CollisionSpace *space, const std::vector<std::string> &group) :
+            space{space},
+            valid{false}
+        {
+            MutexLocker locker(&space->iMutex);
+            // meshes still built in the background would be missing in the snapshot
+            space->completePendingObjects(true);
+            const size_t numWorkers = space->getWorkerPool().size();
+
+            std::map<const Object*, size_t> groupIndex;
+            for(const auto &objectName : group)
+            {
+                const auto it = space->objects.find(objectName);
+                if(it == space->objects.end() || !it->second->getGeom())
+                {
+                    LOG_ERROR("ode_collision::ValidityChecker: unknown object %s", objectName.c_str());
+                    return;
+                }
+                const Object *object = it->second;
+                dGeomID geom = object->getGeom();
+                if(dGeomIsSpace(geom) || dGeomGetClass(geom) == dPlaneClass)
+                {
+                    LOG_ERROR("ode_collision::ValidityChecker: unsupported group object %s", objectName.c_str());
+                    return;
+                }
+                std::vector<dGeomID> clones;
+                for(size_t w=0; w<numWorkers; w++)
+                {
+                    dGeomID clone = cloneGeom(geom);
+                    if(!clone)
+                    {
+                        break;
+                    }
+                    clones.push_back(clone);
+                }
+                workerClones.resize(numWorkers);
+                for(size_t w=0; w<clones.size(); w++)
+                {
+                    workerClones[w].push_back(clones[w]);
+                }
+                if(clones.size() < numWorkers)
+                {
+                    LOG_ERROR("ode_collision::ValidityChecker: unsupported group object %s", objectName.c_str());
+                    return;
+                }
+
+                // offset of the geom relative to the movable frame
+                Pose frame{Vector::Zero(), Quaternion::Identity()};
+                if(auto movable = object->getMovable())
+                {
+                    movable->getPosition(&frame.pos);
+                    movable->getRotation(&frame.q);
+                }
+                const dReal *pos = dGeomGetPosition(geom);
+                dQuaternion dQ;
+                dGeomGetQuaternion(geom, dQ);
+                const Quaternion inverse = frame.q.conjugate();
+                offsets.push_back({inverse*(Vector(pos[0], pos[1], pos[2]) - frame.pos),
+                                   inverse*Quaternion(dQ[0], dQ[1], dQ[2], dQ[3])});
+                groupIndex.emplace(object, groupObjects.size());
+                groupObjects.push_back(object);
+            }
+
+            // snapshot of all other geoms
+            std::vector<AabbTree::Aabb> bounds;
+            auto addEntry = [&](dGeomID geom)
+            {
+                const Object *object = reinterpret_cast<Object*>(dGeomGetData(geom));
+                if(dGeomGetClass(geom) >= dFirstUserClass)
+                {
+                    // the colliders of user classes read the pose and shape of their object
+                    LOG_ERROR("ode_collision::ValidityChecker: unsupported object %s",
+                              object ? object->getName().c_str() : "");
+                    return false;
+                }
+                Entry entry{cloneGeom(geom), object, false};
+                if(!entry.geom)
+                {
+                    entry.geom = geom;
+                    entry.shared = true;
+                    std::copy(dGeomGetPosition(geom), dGeomGetPosition(geom)+3, entry.pos);
+                    std::copy(dGeomGetRotation(geom), dGeomGetRotation(geom)+12, entry.rotation);
+                }
+                AabbTree::Aabb aabb;
+                // also brings the position data of the clone up to date before
+                // it is read concurrently
+                dGeomGetAABB(entry.geom, aabb.data());
+                if(std::all_of(aabb.begin(), aabb.end(), [](dReal v) {return std::isfinite(v);}))
+                {
+                    boundedEntries.push_back(entries.size());
+                    bounds.push_back(aabb);
+                }
+                else
+                {
+                    unboundedEntries.push_back(entries.size());
+                }
+                entries.push_back(entry);
+                return true;
+            };
+            for(const auto &namedObject : space->objects)
+            {
+                dGeomID geom = namedObject.second->getGeom();
+                if(!geom || groupIndex.count(namedObject.second))
+                {
+                    continue;
+                }
+                if(dGeomIsSpace(geom))
+                {
+                    dSpaceID objectSpace = (dSpaceID)geom;
+                    for(int i=0; i<dSpaceGetNumGeoms(objectSpace); i++)
+                    {
+                        if(!addEntry(dSpaceGetGeom(objectSpace, i)))
+                        {
+                            return;
+                        }
+                    }
+                }
+                else if(!addEntry(geom))
+                {
+                    return;
+                }
+            }
+            tree.build(bounds);
+
+            const size_t groupSize = groupObjects.size();
+            entryPairs.resize(entries.size()*groupSize);
+            for(size_t e=0; e<entries.size(); e++)
+            {
+                for(size_t i=0; i<groupSize; i++)
+                {
+                    entryPairs[e*groupSize+i] = space->canCollide(entries[e].object, groupObjects[i]);
+                }
+            }
+            groupPairs.resize(groupSize*groupSize);
+            for(size_t i=0; i<groupSize; i++)
+            {
+                for(size_t j=0; j<groupSize; j++)
+                {
+                    groupPairs[i*groupSize+j] = i != j && space->canCollide(groupObjects[i], groupObjects[j]);
+                }
+            }
+            valid = true;
+        }
+
+        ValidityChecker::~ValidityChecker()
+        {
+            for(auto &clones : workerClones)
+            {
+                for(auto &clone : clones)
+                {
+                    dGeomDestroy(clone);
+                }
+            }
+            for(auto &entry : entries)
+            {
+                if(!entry.shared)
+                {
+                    dGeomDestroy(entry.geom);
+                }
+            }
+        }
+
+        bool ValidityChecker::check(const std::vector<Pose> &poses, std::vector<bool> *collisionFree,
+                                    std::vector<dReal> *distances, dReal maxDistance)
+        {
+            if(!valid || groupObjects.empty() || poses.size() % groupObjects.size())
+            {
+                LOG_ERROR("ode_collision::ValidityChecker: invalid checker or number of poses");
+                return false;
+            }
+            const size_t numConfigurations = poses.size()/groupObjects.size();
+            const size_t numTasks = std::min(workerClones.size(), numConfigurations);
+            // bytes instead of std::vector<bool> since the tasks write concurrently
+            std::vector<char> results(numConfigurations, 0);
+            if(distances)
+            {
+                distances->assign(numConfigurations, 0.0);
+            }
+            std::vector<std::future<void>> futures;
+            for(size_t t=0; t<numTasks; t++)
+            {
+                futures.push_back(space->getWorkerPool().submit([this, t, numTasks, numConfigurations, distances, maxDistance, &poses, &results]()
+                {
+                    for(size_t c=t; c<numConfigurations; c+=numTasks)
+                    {
+                        results[c] = !checkConfiguration(&poses[c*groupObjects.size()], workerClones[t]);
+                        if(distances && results[c])
+                        {
+                            // the clones are still placed at the configuration
+                            (*distances)[c] = computeDistance(workerClones[t], maxDistance);
+                        }
+                    }
+                }));
+            }
+            for(auto &future : futures)
+            {
+                future.get();
+            }
+            collisionFree->assign(results.begin(), results.end());
+            return true;
+        }
+
+        template<typename Callback>
+        void ValidityChecker::queryEntries(const dReal *aabb, Callback &&callback) const
+        {
+            for(const auto &e : unboundedEntries)
+            {
+                callback(e);
+            }
+            tree.query(aabb, [&](unsigned int item) {callback(boundedEntries[item]);});
+        }
+
+        bool ValidityChecker::checkConfiguration(const Pose *poses, std::vector<dGeomID> &clones) const
+        {
+            const size_t groupSize = groupObjects.size();
+            std::vector<AabbTree::Aabb> aabbs(groupSize);
+            for(size_t i=0; i<groupSize; i++)
+            {
+                setGeomPose(clones[i], Pose{poses[i].pos + poses[i].q*offsets[i].pos, poses[i].q*offsets[i].q});
+                dGeomGetAABB(clones[i], aabbs[i].data());
+            }
+
+            dContactGeom contact;
+            const int flags = 1 | CONTACTS_UNIMPORTANT;
+            for(size_t i=0; i<groupSize; i++)
+            {
+                for(size_t j=i+1; j<groupSize; j++)
+                {
+                    if(groupPairs[i*groupSize+j] && AabbTree::overlaps(aabbs[i].data(), aabbs[j].data()) &&
+                       dCollide(clones[i], clones[j], flags, &contact, sizeof(dContactGeom)))
+                    {
+                        return true;
+                    }
+                }
+            }
+            for(size_t i=0; i<groupSize; i++)
+            {
+                bool collision = false;
+                queryEntries(aabbs[i].data(), [&](unsigned int e)
+                {
+                    if(collision || !entryPairs[e*groupSize+i])
+                    {
+                        return;
+                    }
+                    const Entry &entry = entries[e];
+                    if(entry.shared)
+                    {
+                        MutexLocker locker(&space->iMutex);
+                        atPose(entry.geom, entry.pos, entry.rotation, [&]()
+                        {
+                            collision = dCollide(clones[i], entry.geom, flags, &contact, sizeof(dContactGeom)) > 0;
+                        });
+                    }
+                    else
+                    {
+                        collision = dCollide(clones[i], entry.geom, flags, &contact, sizeof(dContactGeom)) > 0;
+                    }
+                });
+                if(collision)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        dReal ValidityChecker::computeDistance(std::vector<dGeomID> &clones, dReal maxDistance) const
+        {
+            const size_t groupSize = groupObjects.size();
+            dReal best = maxDistance;
+            bool found = false;
+            DistanceResult result;
+            auto update = [&](dGeomID geom1, dGeomID geom2)
+            {
+                if(Distance::compute(geom1, geom2, best, &result) && (!found || result.distance < best))
+                {
+                    best = result.distance;
+                    found = true;
+                }
+            };
+            for(size_t i=0; i<groupSize; i++)
+            {
+                for(size_t j=i+1; j<groupSize; j++)
+                {
+                    if(groupPairs[i*groupSize+j])
+                    {
+                        update(clones[i], clones[j]);
+                    }
+                }
+            }
+            for(size_t i=0; i<groupSize; i++)
+            {
+                // entries within the current bound of the clone box
+                AabbTree::Aabb aabb;
+                dGeomGetAABB(clones[i], aabb.data());
+                for(int k=0; k<3; k++)
+                {
+                    aabb[k*2] -= best;
+                    aabb[k*2+1] += best;
+                }
+                queryEntries(aabb.data(), [&](unsigned int e)
+                {
+                    if(!entryPairs[e*groupSize+i])
+                    {
+                        return;
+                    }
+                    const Entry &entry = entries[e];
+                    if(entry.shared)
+                    {
+                        MutexLocker locker(&space->iMutex);
+                        atPose(entry.geom, entry.pos, entry.rotation, [&]() {update(clones[i], entry.geom);});
+                    }
+                    else
+                    {
+                        update(clones[i], entry.geom);
+                    }
+                });
+            }
+            return found ? best : dInfinity;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,118 @@
+/**
+ * \file ValidityChecker.hpp
+ * \brief "ValidityChecker" evaluates batches of candidate poses of a group of
+ *        objects against a snapshot of the collision space.
+ *
+ */
+
+#pragma once
+
+#include "AabbTree.hpp"
+
+#include <mars_utils/Vector.h>
+#include <ode/ode.h>
+
+#include <string>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        class CollisionSpace;
+        class Object;
+
+        /**
+         * On construction the geoms of all other objects are copied at their
+         * current poses into a private snapshot (the data of trimeshes and
+         * heightfields is shared), and every worker of the space's WorkerPool
+         * gets its own copies of the group geoms. Thus the checks do not block
+         * the simulation. Convex geoms cannot be copied; they are used
+         * directly, moved back to their snapshot pose for each test and
+         * restored afterwards while holding CollisionSpace::iMutex. Objects of
+         * user geom classes (Compound, InstancedScatter, Sdf, VoxelGrid) are
+         * not supported since their colliders read the live state of the
+         * object, the checker is invalid if the space contains one. The group
+         * objects have to be primitives, trimeshes or meshes with a primitive
+         * proxy. Pending
+         * objects are completed first, and geoms with infinite bounds (planes)
+         * are tested against every pose instead of being put into the tree.
+         *
+         * A pose of a group object is the global pose of its movable frame (of
+         * the world frame for static objects), as it would be set by moving
+         * the DynamicObject.
+         */
+        class ValidityChecker
+        {
+        public:
+            struct Pose
+            {
+                utils::Vector pos;
+                utils::Quaternion q;
+            };
+
+            ValidityChecker(CollisionSpace *space, const std::vector<std::string> &group);
+            ~ValidityChecker();
+            ValidityChecker(const ValidityChecker&) = delete;
+            ValidityChecker& operator=(const ValidityChecker&) = delete;
+
+            bool isValid() const
+            {
+                return valid;
+            }
+
+            /**
+             * \brief Checks configurations in parallel.
+             *
+             * poses holds one pose per group object (in group order) for each
+             * configuration. collisionFree receives one entry per configuration.
+             * If distances is given, it receives the minimum distance of the
+             * group to the scene and between the group objects for each
+             * collision free configuration (0 for colliding configurations,
+             * dInfinity if nothing supported is within maxDistance).
+             */
+            bool check(const std::vector<Pose> &poses, std::vector<bool> *collisionFree,
+                       std::vector<dReal> *distances=nullptr, dReal maxDistance=dInfinity);
+
+        private:
+            struct Entry
+            {
+                dGeomID geom;
+                const Object *object;
+                // the geom is the live geom of the space
+                bool shared;
+                // pose of a shared geom at construction
+                dVector3 pos;
+                dMatrix3 rotation;
+            };
+
+            // returns true if the configuration collides
+            bool checkConfiguration(const Pose *poses, std::vector<dGeomID> &clones) const;
+            // minimum distance of the placed clones up to maxDistance
+            dReal computeDistance(std::vector<dGeomID> &clones, dReal maxDistance) const;
+            // calls callback(entry index) for the unbounded entries and the entries overlapping aabb
+            template<typename Callback>
+            void queryEntries(const dReal *aabb, Callback &&callback) const;
+
+            CollisionSpace *space;
+            bool valid;
+            std::vector<const Object*> groupObjects;
+            // transformation of the movable frame to the geom per group object
+            std::vector<Pose> offsets;
+            // group geoms per worker
+            std::vector<std::vector<dGeomID>> workerClones;
+            std::vector<Entry> entries;
+            // entries with finite bounds, indexed by the items of the tree
+            std::vector<unsigned int> boundedEntries;
+            // entries with infinite or nan bounds (e.g. planes) are tested always
+            std::vector<unsigned int> unboundedEntries;
+            AabbTree tree;
+            // canCollide of entry e and group object i at e*group size+i
+            std::vector<char> entryPairs;
+            // canCollide of the group objects i and j at i*group size+j
+            std::vector<char> groupPairs;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
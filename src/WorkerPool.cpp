@@ -0,0 +1,77 @@
+/**
+ * \file WorkerPool.cpp
+ * \brief "WorkerPool" a small fixed size thread pool used for the preparation
+ *        of collision data in the background.
+ *
+ */
+
+#include "WorkerPool.hpp"
+
+#include <ode/ode.h>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        WorkerPool::WorkerPool(size_t numThreads) : stop{false}
+        {
+            if(numThreads == 0)
+            {
+                numThreads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for(size_t i=0; i<numThreads; ++i)
+            {
+                threads.emplace_back(&WorkerPool::run, this);
+            }
+        }
+
+        WorkerPool::~WorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock{tasksMutex};
+                stop = true;
+            }
+            tasksCondition.notify_all();
+            for(auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        std::future<void> WorkerPool::submit(std::function<void()> task)
+        {
+            std::packaged_task<void()> packagedTask{std::move(task)};
+            auto result = packagedTask.get_future();
+            {
+                std::lock_guard<std::mutex> lock{tasksMutex};
+                tasks.push_back(std::move(packagedTask));
+            }
+            tasksCondition.notify_one();
+            return result;
+        }
+
+        void WorkerPool::run()
+        {
+            dAllocateODEDataForThread(dAllocateMaskAll);
+            while(true)
+            {
+                std::packaged_task<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock{tasksMutex};
+                    tasksCondition.wait(lock, [this]{ return stop || !tasks.empty(); });
+                    // finish all queued tasks before shutting down
+                    if(tasks.empty())
+                    {
+                        break;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+            dCleanupODEAllDataForThread();
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
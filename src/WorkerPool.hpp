@@ -0,0 +1,54 @@
+/**
+ * \file WorkerPool.hpp
+ * \brief "WorkerPool" a small fixed size thread pool used for the preparation
+ *        of collision data in the background.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * Each worker thread allocates its own ODE thread data, thus the
+         * tasks are allowed to call ODE functions that do not modify
+         * shared state (e.g. building trimesh data).
+         */
+        class WorkerPool
+        {
+        public:
+            // numThreads == 0 uses the number of available cores
+            explicit WorkerPool(size_t numThreads=0);
+            ~WorkerPool();
+            WorkerPool(const WorkerPool&) = delete;
+            WorkerPool& operator=(const WorkerPool&) = delete;
+
+            std::future<void> submit(std::function<void()> task);
+            size_t size() const
+            {
+                return threads.size();
+            }
+
+        private:
+            void run();
+
+            std::vector<std::thread> threads;
+            std::deque<std::packaged_task<void()>> tasks;
+            std::mutex tasksMutex;
+            std::condition_variable tasksCondition;
+            bool stop;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
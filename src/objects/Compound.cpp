@@ -0,0 +1,232 @@
+#include "Compound.hpp"
+#include "../UserGeomClass.hpp"
+
+#include <mars_utils/mathUtils.h>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+        using namespace interfaces;
+        using namespace configmaps;
+
+        Compound::Compound(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config) :
+            Object(space, movable, config),
+            globalPos{0.0, 0.0, 0.0},
+            globalQ{1.0, 0.0, 0.0, 0.0},
+            poseStamp{1}
+        {
+            LOG_INFO("ode_collision: Compound constructor.\n");
+        }
+
+        Compound::~Compound(void)
+        {
+            for(auto &child : children)
+            {
+                dGeomDestroy(child.geom);
+            }
+        }
+
+        Object* Compound::instantiate(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config)
+        {
+            Compound *compound = new Compound(space, movable, config);
+            compound->createGeom();
+            return compound;
+        }
+
+        /**
+         * \brief Registers the compound geom class with ode on first use.
+         */
+        int Compound::getGeomClass()
+        {
+            static const int geomClass = UserGeomClass::create(sizeof(Compound*), &Compound::getCollider,
+                                                               &Compound::computeAabb);
+            return geomClass;
+        }
+
+        dColliderFn* Compound::getCollider(int geomClass)
+        {
+            // the children are collided with dCollide, thus every class is supported
+            return &Compound::collide;
+        }
+
+        bool Compound::createGeom()
+        {
+            name << config["name"];
+            if(config.hasKey("bitmask"))
+            {
+                c_params.coll_bitmask = config["bitmask"];
+            }
+            if(!config.hasKey("children"))
+            {
+                LOG_ERROR("ode_collision::Compound: %s has no children", name.c_str());
+                return false;
+            }
+            ConfigVector &childConfigs = config["children"];
+            for(auto &childConfig : childConfigs)
+            {
+                if(!createChild(childConfig))
+                {
+                    return false;
+                }
+            }
+
+            std::vector<AabbTree::Aabb> bounds(children.size());
+            for(size_t i=0; i<children.size(); i++)
+            {
+                // the child geoms are still placed in compound coordinates
+                dGeomGetAABB(children[i].geom, bounds[i].data());
+            }
+            tree.build(bounds);
+
+            nGeom = dCreateGeom(getGeomClass());
+            *static_cast<Compound**>(dGeomGetClassData(nGeom)) = this;
+            dSpaceAdd(space->getSpace(), nGeom);
+            dGeomSetData(nGeom, this);
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        bool Compound::createChild(ConfigMap &childConfig)
+        {
+            const std::string type = childConfig["type"];
+            // same convention as the primitive objects: radius in x and length in y
+            ConfigMap &extend = childConfig["extend"];
+            const double x = extend["x"];
+            const double y = extend.hasKey("y") ? static_cast<double>(extend["y"]) : 0.0;
+            const double z = extend.hasKey("z") ? static_cast<double>(extend["z"]) : 0.0;
+            Child child;
+            // the children are not inserted into a space
+            if(type == "box")
+            {
+                child.geom = dCreateBox(0, x, y, z);
+            }
+            else if(type == "sphere")
+            {
+                child.geom = dCreateSphere(0, x);
+            }
+            else if(type == "capsule")
+            {
+                child.geom = dCreateCapsule(0, x, y);
+            }
+            else if(type == "cylinder")
+            {
+                child.geom = dCreateCylinder(0, x, y);
+            }
+            else
+            {
+                LOG_ERROR("ode_collision::Compound: unsupported child type \"%s\" in %s", type.c_str(), name.c_str());
+                return false;
+            }
+            child.pos = Vector::Zero();
+            child.q = Quaternion::Identity();
+            if(childConfig.hasKey("position"))
+            {
+                vectorFromConfigItem(&childConfig["position"], &child.pos);
+            }
+            if(childConfig.hasKey("rotation"))
+            {
+                quaternionFromConfigItem(&childConfig["rotation"], &child.q);
+            }
+            dGeomSetPosition(child.geom, child.pos.x(), child.pos.y(), child.pos.z());
+            dQuaternion dQ = {child.q.w(), child.q.x(), child.q.y(), child.q.z()};
+            dGeomSetQuaternion(child.geom, dQ);
+            dGeomSetData(child.geom, this);
+            child.stamp = 0;
+            children.push_back(child);
+            return true;
+        }
+
+        void Compound::updateTransform(void)
+        {
+            if(!nGeom)
+            {
+                return;
+            }
+            // one pose update per compound, the children follow on demand
+            getGlobalTransform(&globalPos, &globalQ);
+            dGeomSetPosition(nGeom, globalPos.x(), globalPos.y(), globalPos.z());
+            dQuaternion dQ = {globalQ.w(), globalQ.x(), globalQ.y(), globalQ.z()};
+            dGeomSetQuaternion(nGeom, dQ);
+            ++poseStamp;
+        }
+
+        void Compound::updateChild(Child &child)
+        {
+            if(child.stamp == poseStamp)
+            {
+                return;
+            }
+            const Vector pos = globalPos + globalQ*child.pos;
+            const Quaternion q = globalQ*child.q;
+            dGeomSetPosition(child.geom, pos.x(), pos.y(), pos.z());
+            dQuaternion dQ = {q.w(), q.x(), q.y(), q.z()};
+            dGeomSetQuaternion(child.geom, dQ);
+            child.stamp = poseStamp;
+        }
+
+        void Compound::computeAabb(dGeomID geom, dReal aabb[6])
+        {
+            const Compound *compound = *static_cast<Compound**>(dGeomGetClassData(geom));
+            const dReal *p = dGeomGetPosition(geom);
+            if(compound->tree.empty())
+            {
+                aabb[0] = aabb[1] = p[0];
+                aabb[2] = aabb[3] = p[1];
+                aabb[4] = aabb[5] = p[2];
+                return;
+            }
+            AabbTree::transform(compound->tree.getBounds().data(), Vector(p[0], p[1], p[2]),
+                          compound->globalQ.toRotationMatrix(), aabb);
+        }
+
+        /**
+         * \brief Collider of the compound class, o1 is always the compound.
+         */
+        int Compound::collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip)
+        {
+            Compound *compound = *static_cast<Compound**>(dGeomGetClassData(o1));
+            const int maxContacts = flags & UserGeomClass::kNumContactsMask;
+            if(maxContacts < 1)
+            {
+                return 0;
+            }
+
+            // bounding box of the other geom in compound coordinates
+            dReal aabb[6], localAabb[6];
+            dGeomGetAABB(o2, aabb);
+            const Matrix inverse = compound->globalQ.conjugate().toRotationMatrix();
+            AabbTree::transform(aabb, -(inverse*compound->globalPos), inverse, localAabb);
+
+            int numContacts = 0;
+            compound->tree.query(localAabb, [&](unsigned int index)
+            {
+                if(numContacts >= maxContacts || ((flags & CONTACTS_UNIMPORTANT) && numContacts))
+                {
+                    return;
+                }
+                Child &child = compound->children[index];
+                compound->updateChild(child);
+                dContactGeom *out = UserGeomClass::contactAt(contact, numContacts, skip);
+                const int n = dCollide(child.geom, o2, (flags & ~UserGeomClass::kNumContactsMask) | (maxContacts-numContacts), out, skip);
+                for(int i=0; i<n; i++)
+                {
+                    UserGeomClass::contactAt(out, i, skip)->g1 = o1;
+                }
+                numContacts += n;
+            });
+            return numContacts;
+        }
+
+        ConfigMap Compound::getConfigMap() const
+        {
+            ConfigMap result = Object::getConfigMap();
+            result["children"] = static_cast<int>(children.size());
+            return result;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,66 @@
+ /**
+ * \file Compound.hpp
+ * \brief "Compound" holds many primitive shapes in local coordinates behind a
+ *        single ode geom with its own bounding volume hierarchy.
+ *
+ */
+
+#pragma once
+
+#include "Object.hpp"
+#include "../AabbTree.hpp"
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The compound is a user geom class of ode. Only the compound geom is
+         * inserted into the space and transformed in updateTransform. The child
+         * geoms (box, sphere, capsule, cylinder) are not part of any space: the
+         * collider of the compound queries the child tree with the bounding box
+         * of the other geom, updates the pose of the hit children if the compound
+         * moved since their last use and collides them with dCollide. Contacts
+         * are reported with the compound as geom.
+         */
+        class Compound : public Object
+        {
+        public:
+            Compound(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual ~Compound(void);
+            static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual bool createGeom() override;
+            virtual void updateTransform(void) override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+
+        private:
+            struct Child
+            {
+                dGeomID geom;
+                utils::Vector pos;
+                utils::Quaternion q;
+                // pose stamp of the compound the geom pose was computed for
+                unsigned long stamp;
+            };
+
+            static int getGeomClass();
+            static dColliderFn* getCollider(int geomClass);
+            static int collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip);
+            static void computeAabb(dGeomID geom, dReal aabb[6]);
+
+            bool createChild(configmaps::ConfigMap &childConfig);
+            void updateChild(Child &child);
+
+            std::vector<Child> children;
+            // child bounds in compound coordinates
+            AabbTree tree;
+            utils::Vector globalPos;
+            utils::Quaternion globalQ;
+            unsigned long poseStamp;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
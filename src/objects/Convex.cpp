@@ -0,0 +1,285 @@
+#include "Convex.hpp"
+#include <mars_interfaces/graphics/GraphicsManagerInterface.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+        using namespace utils;
+        using namespace interfaces;
+        using namespace configmaps;
+
+        Convex::Convex(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, ConfigMap& config) :
+            Mesh(space, movable, config)
+        {
+            LOG_INFO("ode_collision: Convex constructor.\n");
+        }
+
+        Convex::~Convex(void)
+        {
+            // the hull geoms are destroyed together with their space in ~Object
+        }
+
+        Object* Convex::instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, ConfigMap& config)
+        {
+            return new Convex{space, movable, config};
+        }
+
+        bool Convex::createGeom()
+        {
+            assert(vertexcount > 0);
+
+            name << config["name"];
+            unsigned int maxHulls = 1;
+            dReal concavity = 0.01;
+            if(config.hasKey("decomposition"))
+            {
+                if(config["decomposition"].hasKey("max_hulls"))
+                {
+                    maxHulls = static_cast<int>(config["decomposition"]["max_hulls"]);
+                }
+                if(config["decomposition"].hasKey("concavity"))
+                {
+                    concavity = config["decomposition"]["concavity"];
+                }
+            }
+            readBuildConfig();
+            uint64_t key = computeCacheKey();
+            key = MeshCache::hash(&maxHulls, sizeof(maxHulls), key);
+            key = MeshCache::hash(&concavity, sizeof(concavity), key);
+            const std::string cacheFile = getCacheFile("convex", key);
+
+            if(cacheFile.empty() || !loadHulls(cacheFile, key))
+            {
+                processMeshData();
+                std::vector<dReal> vertices(vertexcount*3);
+                for(unsigned long i=0; i<vertexcount; i++)
+                {
+                    std::copy(myVertices[i], myVertices[i]+3, &vertices[i*3]);
+                }
+                if(maxHulls > 1)
+                {
+                    const std::vector<dTriIndex> indices(myIndices, myIndices+indexcount);
+                    hulls = ConvexHull::decompose(vertices, indices, maxHulls, concavity);
+                }
+                else
+                {
+                    ConvexHull hull;
+                    if(hull.compute(vertices))
+                    {
+                        hulls.push_back(std::move(hull));
+                    }
+                }
+                if(hulls.empty())
+                {
+                    LOG_ERROR("ode_collision::Convex: could not compute a convex hull for %s", name.c_str());
+                    return false;
+                }
+                if(!cacheFile.empty())
+                {
+                    storeHulls(cacheFile, key);
+                }
+            }
+            // the hulls are all we need from the mesh data
+            freeMemory();
+
+            dSpaceID hullSpace = space->getSpace();
+            if(hulls.size() > 1)
+            {
+                hullSpace = dSimpleSpaceCreate(space->getSpace());
+                nGeom = (dGeomID)hullSpace;
+            }
+            for(const auto &hull : hulls)
+            {
+                dGeomID hullGeom = dCreateConvex(hullSpace, hull.planes.data(), hull.numPlanes(),
+                                                 hull.points.data(), hull.numPoints(), hull.polygons.data());
+                // all hulls report this object in the collision callback
+                dGeomSetData(hullGeom, this);
+                hullGeoms.push_back(hullGeom);
+            }
+            if(hulls.size() == 1)
+            {
+                nGeom = hullGeoms.front();
+            }
+            LOG_INFO("ode_collision::Convex: created %s from %lu hull(s)", name.c_str(), static_cast<unsigned long>(hulls.size()));
+            objectCreated = true;
+            return true;
+        }
+
+        void Convex::updateTransform(void)
+        {
+            if(hullGeoms.size() <= 1)
+            {
+                Object::updateTransform();
+                return;
+            }
+            // all hulls are given in the local frame of the object
+            Vector globalPos;
+            Quaternion globalQ;
+            getGlobalTransform(&globalPos, &globalQ);
+            dQuaternion dQ = {globalQ.w(), globalQ.x(), globalQ.y(), globalQ.z()};
+            for(auto &hullGeom : hullGeoms)
+            {
+                dGeomSetPosition(hullGeom, (dReal)globalPos.x(),
+                                 (dReal)globalPos.y(), (dReal)globalPos.z());
+                dGeomSetQuaternion(hullGeom, dQ);
+            }
+        }
+
+        void Convex::getPosition(Vector *pos) const
+        {
+            if(hullGeoms.empty())
+            {
+                *pos = this->pos;
+                return;
+            }
+            const dReal *dPos = dGeomGetPosition(hullGeoms.front());
+            pos->x() = dPos[0];
+            pos->y() = dPos[1];
+            pos->z() = dPos[2];
+        }
+
+        void Convex::getRotation(Quaternion *q) const
+        {
+            if(hullGeoms.empty())
+            {
+                *q = this->q;
+                return;
+            }
+            dQuaternion dQ;
+            dGeomGetQuaternion(hullGeoms.front(), dQ);
+            q->w() = dQ[0];
+            q->x() = dQ[1];
+            q->y() = dQ[2];
+            q->z() = dQ[3];
+        }
+
+        void Convex::setSize(const utils::Vector &size)
+        {
+            const dReal s[3] = {size.x()/static_cast<double>(config["extend"]["x"]),
+                                size.y()/static_cast<double>(config["extend"]["y"]),
+                                size.z()/static_cast<double>(config["extend"]["z"])};
+            for(size_t h=0; h<hulls.size(); ++h)
+            {
+                ConvexHull &hull = hulls[h];
+                for(size_t i=0; i<hull.points.size(); ++i)
+                {
+                    hull.points[i] *= s[i%3];
+                }
+                // the planes have to be recalculated for non uniform scaling
+                size_t plane = 0;
+                for(size_t i=0; i<hull.polygons.size(); i+=hull.polygons[i]+1, ++plane)
+                {
+                    const dReal *a = &hull.points[hull.polygons[i+1]*3];
+                    const dReal *b = &hull.points[hull.polygons[i+2]*3];
+                    const dReal *c = &hull.points[hull.polygons[i+3]*3];
+                    const dReal u[3] = {b[0]-a[0], b[1]-a[1], b[2]-a[2]};
+                    const dReal v[3] = {c[0]-a[0], c[1]-a[1], c[2]-a[2]};
+                    dReal *n = &hull.planes[plane*4];
+                    n[0] = u[1]*v[2]-u[2]*v[1];
+                    n[1] = u[2]*v[0]-u[0]*v[2];
+                    n[2] = u[0]*v[1]-u[1]*v[0];
+                    const dReal length = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+                    if(length > 0.0)
+                    {
+                        n[0] /= length;
+                        n[1] /= length;
+                        n[2] /= length;
+                    }
+                    n[3] = n[0]*a[0] + n[1]*a[1] + n[2]*a[2];
+                }
+                dGeomSetConvex(hullGeoms[h], hull.planes.data(), hull.numPlanes(),
+                               hull.points.data(), hull.numPoints(), hull.polygons.data());
+            }
+            if(graphics)
+            {
+                graphics->lock();
+                graphics->setDrawObjectScale(drawID, Vector{s[0], s[1], s[2]});
+                graphics->unlock();
+            }
+        }
+
+        const std::vector<dReal>* Convex::getConvexPoints(dGeomID geom) const
+        {
+            const auto it = std::find(hullGeoms.begin(), hullGeoms.end(), geom);
+            if(it == hullGeoms.end())
+            {
+                return nullptr;
+            }
+            return &hulls[it-hullGeoms.begin()].points;
+        }
+
+        bool Convex::loadHulls(const std::string &file, uint64_t key)
+        {
+            MeshCache entry;
+            if(!entry.open(file, key))
+            {
+                return false;
+            }
+            uint64_t numInfo = 0, numPoints = 0, numPlanes = 0, numPolygons = 0;
+            const auto *info = entry.getSection<uint32_t>(MeshCache::kHullInfo, &numInfo);
+            const auto *points = entry.getSection<dReal>(MeshCache::kHullPoints, &numPoints);
+            const auto *planes = entry.getSection<dReal>(MeshCache::kHullPlanes, &numPlanes);
+            const auto *polygons = entry.getSection<uint32_t>(MeshCache::kHullPolygons, &numPolygons);
+            if(!info || !points || !planes || !polygons || numInfo%3 != 0)
+            {
+                LOG_WARN("ode_collision::Convex: ignore incomplete cache file %s", file.c_str());
+                return false;
+            }
+            std::vector<ConvexHull> cachedHulls(numInfo/3);
+            uint64_t pointOffset = 0, planeOffset = 0, polygonOffset = 0;
+            for(size_t h=0; h<cachedHulls.size(); ++h)
+            {
+                const uint64_t hullPoints = info[h*3]*3, hullPlanes = info[h*3+1]*4, hullPolygons = info[h*3+2];
+                if(pointOffset+hullPoints > numPoints || planeOffset+hullPlanes > numPlanes ||
+                   polygonOffset+hullPolygons > numPolygons)
+                {
+                    LOG_WARN("ode_collision::Convex: ignore inconsistent cache file %s", file.c_str());
+                    return false;
+                }
+                cachedHulls[h].points.assign(points+pointOffset, points+pointOffset+hullPoints);
+                cachedHulls[h].planes.assign(planes+planeOffset, planes+planeOffset+hullPlanes);
+                cachedHulls[h].polygons.assign(polygons+polygonOffset, polygons+polygonOffset+hullPolygons);
+                pointOffset += hullPoints;
+                planeOffset += hullPlanes;
+                polygonOffset += hullPolygons;
+            }
+            hulls.swap(cachedHulls);
+            return !hulls.empty();
+        }
+
+        void Convex::storeHulls(const std::string &file, uint64_t key) const
+        {
+            std::vector<uint32_t> info;
+            std::vector<dReal> points, planes;
+            std::vector<uint32_t> polygons;
+            for(const auto &hull : hulls)
+            {
+                info.insert(info.end(), {hull.numPoints(), hull.numPlanes(), static_cast<uint32_t>(hull.polygons.size())});
+                points.insert(points.end(), hull.points.begin(), hull.points.end());
+                planes.insert(planes.end(), hull.planes.begin(), hull.planes.end());
+                polygons.insert(polygons.end(), hull.polygons.begin(), hull.polygons.end());
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+            MeshCache::Writer writer;
+            writer.addSection(MeshCache::kHullInfo, info.data(), sizeof(uint32_t), info.size());
+            writer.addSection(MeshCache::kHullPoints, points.data(), sizeof(dReal), points.size());
+            writer.addSection(MeshCache::kHullPlanes, planes.data(), sizeof(dReal), planes.size());
+            writer.addSection(MeshCache::kHullPolygons, polygons.data(), sizeof(uint32_t), polygons.size());
+            writer.write(file, key);
+        }
+
+        configmaps::ConfigMap Convex::getConfigMap() const
+        {
+            configmaps::ConfigMap result = Object::getConfigMap();
+            result["hulls"] = static_cast<int>(hulls.size());
+            return result;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,50 @@
+ /**
+ * \file Convex.hpp
+ * \brief "Convex" implements a convex collision object, or a compound of convex
+ *        hulls, computed from mesh data.
+ *
+ */
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "ConvexHull.hpp"
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The mesh data is set with setMeshData and processed like the data of a
+         * Mesh (rescaling and preprocessing). On createGeom the convex hull, or an
+         * approximate convex decomposition if configured, is computed. A compound
+         * of several hulls is represented by a simple space holding one dConvex
+         * geom per hull.
+         */
+        class Convex : public Mesh
+        {
+        public:
+            Convex(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap& config);
+            virtual ~Convex(void);
+            static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap& config);
+            virtual bool createGeom() override;
+            virtual void setSize(const utils::Vector& size) override;
+            virtual void updateTransform(void) override;
+            virtual void getPosition(utils::Vector *pos) const override;
+            virtual void getRotation(utils::Quaternion *q) const override;
+            virtual const std::vector<dReal>* getConvexPoints(dGeomID geom) const override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+
+        private:
+            bool loadHulls(const std::string &file, uint64_t key);
+            void storeHulls(const std::string &file, uint64_t key) const;
+
+            std::vector<ConvexHull> hulls;
+            std::vector<dGeomID> hullGeoms;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,419 @@
+#include "ConvexHull.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        namespace
+        {
+            struct HullFace
+            {
+                int v[3];
+                dReal n[3];
+                dReal d;
+                std::vector<int> outside;
+                bool alive;
+            };
+
+            dReal distance(const HullFace &face, const dReal *p)
+            {
+                return face.n[0]*p[0] + face.n[1]*p[1] + face.n[2]*p[2] - face.d;
+            }
+
+            HullFace makeFace(const std::vector<dReal> &vertices, int a, int b, int c)
+            {
+                HullFace face;
+                face.v[0] = a;
+                face.v[1] = b;
+                face.v[2] = c;
+                const dReal *pa = &vertices[a*3];
+                const dReal *pb = &vertices[b*3];
+                const dReal *pc = &vertices[c*3];
+                const dReal u[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]};
+                const dReal v[3] = {pc[0]-pa[0], pc[1]-pa[1], pc[2]-pa[2]};
+                face.n[0] = u[1]*v[2]-u[2]*v[1];
+                face.n[1] = u[2]*v[0]-u[0]*v[2];
+                face.n[2] = u[0]*v[1]-u[1]*v[0];
+                const dReal length = std::sqrt(face.n[0]*face.n[0] + face.n[1]*face.n[1] + face.n[2]*face.n[2]);
+                if(length > 0.0)
+                {
+                    face.n[0] /= length;
+                    face.n[1] /= length;
+                    face.n[2] /= length;
+                }
+                face.d = face.n[0]*pa[0] + face.n[1]*pa[1] + face.n[2]*pa[2];
+                face.alive = true;
+                return face;
+            }
+
+            uint64_t edgeKey(int a, int b)
+            {
+                return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+            }
+
+            dReal squaredDistance(const dReal *a, const dReal *b)
+            {
+                return (a[0]-b[0])*(a[0]-b[0]) + (a[1]-b[1])*(a[1]-b[1]) + (a[2]-b[2])*(a[2]-b[2]);
+            }
+        }
+
+        bool ConvexHull::compute(const std::vector<dReal> &vertices)
+        {
+            points.clear();
+            planes.clear();
+            polygons.clear();
+            const int n = vertices.size()/3;
+            if(n < 4)
+            {
+                return false;
+            }
+            const dReal *p = vertices.data();
+
+            // initial simplex from the extreme points
+            int extremes[6] = {0, 0, 0, 0, 0, 0};
+            for(int i=1; i<n; ++i)
+            {
+                for(int k=0; k<3; ++k)
+                {
+                    if(p[i*3+k] < p[extremes[k]*3+k]) extremes[k] = i;
+                    if(p[i*3+k] > p[extremes[k+3]*3+k]) extremes[k+3] = i;
+                }
+            }
+            int i0 = extremes[0], i1 = extremes[3];
+            dReal maxDistance = -1.0;
+            for(int a=0; a<6; ++a)
+            {
+                for(int b=a+1; b<6; ++b)
+                {
+                    const dReal dist = squaredDistance(p+extremes[a]*3, p+extremes[b]*3);
+                    if(dist > maxDistance)
+                    {
+                        maxDistance = dist;
+                        i0 = extremes[a];
+                        i1 = extremes[b];
+                    }
+                }
+            }
+            const dReal epsilon = 1e-9*std::max(dReal(1.0), std::sqrt(maxDistance));
+            if(std::sqrt(maxDistance) <= epsilon)
+            {
+                return false;
+            }
+
+            int i2 = -1;
+            maxDistance = epsilon;
+            const dReal *a0 = p+i0*3, *a1 = p+i1*3;
+            const dReal axis[3] = {a1[0]-a0[0], a1[1]-a0[1], a1[2]-a0[2]};
+            for(int i=0; i<n; ++i)
+            {
+                const dReal w[3] = {p[i*3]-a0[0], p[i*3+1]-a0[1], p[i*3+2]-a0[2]};
+                const dReal c[3] = {axis[1]*w[2]-axis[2]*w[1], axis[2]*w[0]-axis[0]*w[2], axis[0]*w[1]-axis[1]*w[0]};
+                const dReal dist = std::sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+                if(dist > maxDistance)
+                {
+                    maxDistance = dist;
+                    i2 = i;
+                }
+            }
+            if(i2 < 0)
+            {
+                return false;
+            }
+
+            int i3 = -1;
+            maxDistance = epsilon;
+            const HullFace base = makeFace(vertices, i0, i1, i2);
+            for(int i=0; i<n; ++i)
+            {
+                const dReal dist = std::fabs(distance(base, p+i*3));
+                if(dist > maxDistance)
+                {
+                    maxDistance = dist;
+                    i3 = i;
+                }
+            }
+            if(i3 < 0)
+            {
+                return false;
+            }
+
+            std::vector<HullFace> faces;
+            const int simplex[4][3] = {{i0, i1, i2}, {i0, i3, i1}, {i1, i3, i2}, {i2, i3, i0}};
+            dReal center[3];
+            for(int k=0; k<3; ++k)
+            {
+                center[k] = (p[i0*3+k] + p[i1*3+k] + p[i2*3+k] + p[i3*3+k])*0.25;
+            }
+            // directed edge -> face, used to walk from a face to its neighbours
+            std::unordered_map<uint64_t, size_t> edgeFaces;
+            auto addFace = [&](const HullFace &face)
+            {
+                for(int k=0; k<3; ++k)
+                {
+                    edgeFaces[edgeKey(face.v[k], face.v[(k+1)%3])] = faces.size();
+                }
+                faces.push_back(face);
+            };
+            for(const auto &tri : simplex)
+            {
+                HullFace face = makeFace(vertices, tri[0], tri[1], tri[2]);
+                if(distance(face, center) > 0.0)
+                {
+                    face = makeFace(vertices, tri[0], tri[2], tri[1]);
+                }
+                addFace(face);
+            }
+            for(int i=0; i<n; ++i)
+            {
+                for(auto &face : faces)
+                {
+                    if(distance(face, p+i*3) > epsilon)
+                    {
+                        face.outside.push_back(i);
+                        break;
+                    }
+                }
+            }
+
+            // add the farthest outside point of a face until no outside points are left
+            size_t current = 0;
+            std::vector<size_t> visible, stack;
+            std::vector<std::pair<int, int>> horizon;
+            std::vector<int> orphans;
+            while(current < faces.size())
+            {
+                if(!faces[current].alive || faces[current].outside.empty())
+                {
+                    ++current;
+                    continue;
+                }
+                int eye = faces[current].outside[0];
+                dReal eyeDistance = distance(faces[current], p+eye*3);
+                for(const auto &candidate : faces[current].outside)
+                {
+                    const dReal dist = distance(faces[current], p+candidate*3);
+                    if(dist > eyeDistance)
+                    {
+                        eyeDistance = dist;
+                        eye = candidate;
+                    }
+                }
+
+                // the faces visible from the eye point are connected, collect
+                // them starting at the current face; the edges to non visible
+                // neighbours form the horizon
+                visible.clear();
+                horizon.clear();
+                orphans.clear();
+                stack.assign(1, current);
+                faces[current].alive = false;
+                while(!stack.empty())
+                {
+                    const size_t f = stack.back();
+                    stack.pop_back();
+                    visible.push_back(f);
+                    for(int k=0; k<3; ++k)
+                    {
+                        const int a = faces[f].v[k], b = faces[f].v[(k+1)%3];
+                        const size_t neighbour = edgeFaces[edgeKey(b, a)];
+                        if(!faces[neighbour].alive)
+                        {
+                            continue;
+                        }
+                        if(distance(faces[neighbour], p+eye*3) > epsilon)
+                        {
+                            faces[neighbour].alive = false;
+                            stack.push_back(neighbour);
+                        }
+                        else
+                        {
+                            horizon.emplace_back(a, b);
+                        }
+                    }
+                }
+                for(const auto &f : visible)
+                {
+                    for(int k=0; k<3; ++k)
+                    {
+                        edgeFaces.erase(edgeKey(faces[f].v[k], faces[f].v[(k+1)%3]));
+                    }
+                    orphans.insert(orphans.end(), faces[f].outside.begin(), faces[f].outside.end());
+                    faces[f].outside.clear();
+                }
+                const size_t firstNewFace = faces.size();
+                for(const auto &edge : horizon)
+                {
+                    addFace(makeFace(vertices, edge.first, edge.second, eye));
+                }
+                for(const auto &orphan : orphans)
+                {
+                    if(orphan == eye)
+                    {
+                        continue;
+                    }
+                    for(size_t f=firstNewFace; f<faces.size(); ++f)
+                    {
+                        if(distance(faces[f], p+orphan*3) > epsilon)
+                        {
+                            faces[f].outside.push_back(orphan);
+                            break;
+                        }
+                    }
+                }
+                // faces before current can not gain new outside points
+            }
+
+            // compact the output to the hull vertices
+            std::map<int, unsigned int> remap;
+            for(const auto &face : faces)
+            {
+                if(!face.alive)
+                {
+                    continue;
+                }
+                polygons.push_back(3);
+                for(int k=0; k<3; ++k)
+                {
+                    auto it = remap.find(face.v[k]);
+                    if(it == remap.end())
+                    {
+                        it = remap.emplace(face.v[k], numPoints()).first;
+                        points.insert(points.end(), p+face.v[k]*3, p+face.v[k]*3+3);
+                    }
+                    polygons.push_back(it->second);
+                }
+                planes.insert(planes.end(), {face.n[0], face.n[1], face.n[2], face.d});
+            }
+            return true;
+        }
+
+        dReal ConvexHull::depthInside(const dReal *p) const
+        {
+            dReal depth = std::numeric_limits<dReal>::max();
+            for(size_t i=0; i<planes.size(); i+=4)
+            {
+                depth = std::min(depth, planes[i+3] - (planes[i]*p[0] + planes[i+1]*p[1] + planes[i+2]*p[2]));
+            }
+            return depth;
+        }
+
+        namespace
+        {
+            struct HullPart
+            {
+                std::vector<dTriIndex> triangles;
+                ConvexHull hull;
+                dReal concavity;
+                bool valid;
+            };
+
+            HullPart makePart(const std::vector<dReal> &vertices, std::vector<dTriIndex> &&triangles)
+            {
+                HullPart part;
+                part.triangles = std::move(triangles);
+                std::vector<dTriIndex> used(part.triangles);
+                std::sort(used.begin(), used.end());
+                used.erase(std::unique(used.begin(), used.end()), used.end());
+                std::vector<dReal> partVertices;
+                partVertices.reserve(used.size()*3);
+                for(const auto &index : used)
+                {
+                    partVertices.insert(partVertices.end(), &vertices[index*3], &vertices[index*3]+3);
+                }
+                part.valid = part.hull.compute(partVertices);
+                part.concavity = 0.0;
+                for(size_t t=0; part.valid && t<part.triangles.size(); t+=3)
+                {
+                    dReal centroid[3];
+                    for(int k=0; k<3; ++k)
+                    {
+                        centroid[k] = (vertices[part.triangles[t]*3+k] + vertices[part.triangles[t+1]*3+k] +
+                                       vertices[part.triangles[t+2]*3+k])/3.0;
+                    }
+                    part.concavity = std::max(part.concavity, part.hull.depthInside(centroid));
+                }
+                return part;
+            }
+        }
+
+        std::vector<ConvexHull> ConvexHull::decompose(const std::vector<dReal> &vertices,
+                                                      const std::vector<dTriIndex> &indices,
+                                                      unsigned int maxHulls, dReal concavity)
+        {
+            std::vector<HullPart> parts;
+            parts.push_back(makePart(vertices, std::vector<dTriIndex>(indices)));
+
+            while(parts.size() < maxHulls)
+            {
+                auto worst = std::max_element(parts.begin(), parts.end(),
+                                              [](const HullPart &a, const HullPart &b) { return a.concavity < b.concavity; });
+                if(worst->concavity <= concavity)
+                {
+                    break;
+                }
+
+                // split at the mean triangle center along the longest axis
+                dReal min[3], max[3], mean[3] = {0.0, 0.0, 0.0};
+                std::fill(min, min+3, std::numeric_limits<dReal>::max());
+                std::fill(max, max+3, std::numeric_limits<dReal>::lowest());
+                const std::vector<dTriIndex> &triangles = worst->triangles;
+                std::vector<dReal> centroids(triangles.size());
+                for(size_t t=0; t<triangles.size(); t+=3)
+                {
+                    for(int k=0; k<3; ++k)
+                    {
+                        centroids[t+k] = (vertices[triangles[t]*3+k] + vertices[triangles[t+1]*3+k] +
+                                          vertices[triangles[t+2]*3+k])/3.0;
+                        min[k] = std::min(min[k], centroids[t+k]);
+                        max[k] = std::max(max[k], centroids[t+k]);
+                        mean[k] += centroids[t+k]*3.0/triangles.size();
+                    }
+                }
+                int axis = 0;
+                for(int k=1; k<3; ++k)
+                {
+                    if(max[k]-min[k] > max[axis]-min[axis])
+                    {
+                        axis = k;
+                    }
+                }
+                std::vector<dTriIndex> left, right;
+                for(size_t t=0; t<triangles.size(); t+=3)
+                {
+                    auto &side = centroids[t+axis] < mean[axis] ? left : right;
+                    side.insert(side.end(), triangles.begin()+t, triangles.begin()+t+3);
+                }
+                HullPart leftPart = makePart(vertices, std::move(left));
+                HullPart rightPart = makePart(vertices, std::move(right));
+                if(!leftPart.valid || !rightPart.valid)
+                {
+                    // the part can not be split into two volumes, keep it as it is
+                    worst->concavity = 0.0;
+                    continue;
+                }
+                *worst = std::move(leftPart);
+                parts.push_back(std::move(rightPart));
+            }
+
+            std::vector<ConvexHull> hulls;
+            for(auto &part : parts)
+            {
+                if(part.valid)
+                {
+                    hulls.push_back(std::move(part.hull));
+                }
+            }
+            return hulls;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
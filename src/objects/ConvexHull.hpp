@@ -0,0 +1,58 @@
+ /**
+ * \file ConvexHull.hpp
+ * \brief "ConvexHull" computes convex hulls and approximate convex
+ *        decompositions of triangle meshes in the data layout of dCreateConvex.
+ *
+ */
+
+#pragma once
+
+#include <ode/ode.h>
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        class ConvexHull
+        {
+        public:
+            // x, y, z per point
+            std::vector<dReal> points;
+            // a, b, c, d per face with a*x + b*y + c*z = d and (a, b, c) pointing outwards
+            std::vector<dReal> planes;
+            // number of vertices followed by the point indices (counter clockwise) per face
+            std::vector<unsigned int> polygons;
+
+            /**
+             * Computes the hull of the given points with the quickhull algorithm.
+             * Returns false if the points do not span a volume.
+             */
+            bool compute(const std::vector<dReal> &vertices);
+            unsigned int numPoints() const
+            {
+                return points.size()/3;
+            }
+            unsigned int numPlanes() const
+            {
+                return planes.size()/4;
+            }
+            // depth of the point below the hull surface, negative if the point is outside
+            dReal depthInside(const dReal *p) const;
+
+            /**
+             * Approximate convex decomposition: the mesh is split recursively
+             * along the longest axis of the part with the largest concavity,
+             * until all parts are within the concavity tolerance or maxHulls
+             * is reached. The concavity of a part is the largest distance of
+             * one of its triangle centers to the surface of its hull.
+             */
+            static std::vector<ConvexHull> decompose(const std::vector<dReal> &vertices,
+                                                     const std::vector<dTriIndex> &indices,
+                                                     unsigned int maxHulls, dReal concavity);
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,406 @@
+#include "DistanceField.hpp"
+
+#include <mars_utils/Vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+
+        namespace
+        {
+            // exact distances are computed within this number of cells around the triangles
+            const unsigned int kBandCells = 2;
+            // keeps the grid memory bounded (1 GB of floats)
+            const uint64_t kMaxValues = 1ULL << 28;
+
+            // closest feature of a triangle to a point
+            enum Feature
+            {
+                kFace,
+                kVertexA,
+                kVertexB,
+                kVertexC,
+                kEdgeAB,
+                kEdgeBC,
+                kEdgeCA,
+            };
+
+            // closest point of the triangle abc to p (by region, see Ericson,
+            // Real-Time Collision Detection, 5.1.5)
+            Vector closestPointOnTriangle(const Vector &p, const Vector &a, const Vector &b, const Vector &c,
+                                          Feature *feature)
+            {
+                const Vector ab = b - a, ac = c - a, ap = p - a;
+                const dReal d1 = ab.dot(ap), d2 = ac.dot(ap);
+                if(d1 <= 0.0 && d2 <= 0.0)
+                {
+                    *feature = kVertexA;
+                    return a;
+                }
+                const Vector bp = p - b;
+                const dReal d3 = ab.dot(bp), d4 = ac.dot(bp);
+                if(d3 >= 0.0 && d4 <= d3)
+                {
+                    *feature = kVertexB;
+                    return b;
+                }
+                const dReal vc = d1*d4 - d3*d2;
+                if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+                {
+                    *feature = kEdgeAB;
+                    return a + ab*(d1/(d1-d3));
+                }
+                const Vector cp = p - c;
+                const dReal d5 = ab.dot(cp), d6 = ac.dot(cp);
+                if(d6 >= 0.0 && d5 <= d6)
+                {
+                    *feature = kVertexC;
+                    return c;
+                }
+                const dReal vb = d5*d2 - d1*d6;
+                if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+                {
+                    *feature = kEdgeCA;
+                    return a + ac*(d2/(d2-d6));
+                }
+                const dReal va = d3*d6 - d5*d4;
+                if(va <= 0.0 && (d4-d3) >= 0.0 && (d5-d6) >= 0.0)
+                {
+                    *feature = kEdgeBC;
+                    return b + (c-b)*((d4-d3)/((d4-d3)+(d5-d6)));
+                }
+                const dReal denom = 1.0/(va + vb + vc);
+                *feature = kFace;
+                return a + ab*(vb*denom) + ac*(vc*denom);
+            }
+
+            /**
+             * Angle weighted pseudo-normals of the faces, edges and vertices
+             * (Baerentzen and Aanaes, Signed Distance Computation Using the
+             * Angle Weighted Pseudonormal). The sign of the dot product with the
+             * direction from the closest point gives the side of the surface,
+             * also for points closest to an edge or a vertex. Vertices are
+             * identified by position, so split vertices share their normal.
+             */
+            class PseudoNormals
+            {
+            public:
+                PseudoNormals(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices) :
+                    indices(indices)
+                {
+                    std::map<std::array<dReal, 3>, uint32_t> positions;
+                    welded.resize(vertices.size()/3);
+                    for(size_t i=0; i<welded.size(); i++)
+                    {
+                        const std::array<dReal, 3> key = {vertices[i*3], vertices[i*3+1], vertices[i*3+2]};
+                        welded[i] = positions.emplace(key, positions.size()).first->second;
+                    }
+                    vertexNormals.assign(positions.size(), Vector::Zero());
+                    faceNormals.resize(indices.size()/3);
+                    for(size_t t=0; t<faceNormals.size(); t++)
+                    {
+                        Vector p[3];
+                        for(int k=0; k<3; k++)
+                        {
+                            p[k] = Vector(&vertices[indices[t*3+k]*3]);
+                        }
+                        Vector n = (p[1]-p[0]).cross(p[2]-p[0]);
+                        const dReal length = n.norm();
+                        faceNormals[t] = length > 0.0 ? Vector(n/length) : Vector(Vector::Zero());
+                        for(int k=0; k<3; k++)
+                        {
+                            // every edge gets an entry, also those of degenerate triangles
+                            auto edge = edgeNormals.emplace(edgeKey(t, k, (k+1)%3), Vector::Zero()).first;
+                            edge->second += faceNormals[t];
+                        }
+                        if(!(length > 0.0))
+                        {
+                            continue;
+                        }
+                        for(int k=0; k<3; k++)
+                        {
+                            const Vector u = (p[(k+1)%3]-p[k]).normalized();
+                            const Vector v = (p[(k+2)%3]-p[k]).normalized();
+                            const dReal angle = std::acos(std::max(-1.0, std::min(1.0, u.dot(v))));
+                            vertexNormals[welded[indices[t*3+k]]] += angle*faceNormals[t];
+                        }
+                    }
+                }
+
+                Vector get(size_t triangle, Feature feature) const
+                {
+                    switch(feature)
+                    {
+                    case kVertexA:
+                    case kVertexB:
+                    case kVertexC:
+                        return vertexNormals[welded[indices[triangle*3 + feature-kVertexA]]];
+                    case kEdgeAB:
+                        return edgeNormals.at(edgeKey(triangle, 0, 1));
+                    case kEdgeBC:
+                        return edgeNormals.at(edgeKey(triangle, 1, 2));
+                    case kEdgeCA:
+                        return edgeNormals.at(edgeKey(triangle, 2, 0));
+                    default:
+                        return faceNormals[triangle];
+                    }
+                }
+
+            private:
+                uint64_t edgeKey(size_t triangle, int k1, int k2) const
+                {
+                    const uint64_t v1 = welded[indices[triangle*3+k1]];
+                    const uint64_t v2 = welded[indices[triangle*3+k2]];
+                    return v1 < v2 ? (v1 << 32) | v2 : (v2 << 32) | v1;
+                }
+
+                const std::vector<dTriIndex> &indices;
+                std::vector<uint32_t> welded;
+                std::vector<Vector> faceNormals;
+                std::vector<Vector> vertexNormals;
+                std::unordered_map<uint64_t, Vector> edgeNormals;
+            };
+        }
+
+        DistanceField::DistanceField() :
+            origin{0.0, 0.0, 0.0},
+            cellSize{0.0},
+            dims{0, 0, 0}
+        {
+        }
+
+        bool DistanceField::build(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices,
+                                  dReal cellSize, unsigned int padding)
+        {
+            values.clear();
+            if(vertices.empty() || indices.size() < 3 || !(cellSize > 0.0))
+            {
+                return false;
+            }
+            dReal min[3], max[3];
+            for(int k=0; k<3; k++)
+            {
+                min[k] = std::numeric_limits<dReal>::max();
+                max[k] = std::numeric_limits<dReal>::lowest();
+            }
+            for(size_t i=0; i<vertices.size(); i+=3)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    min[k] = std::min(min[k], vertices[i+k]);
+                    max[k] = std::max(max[k], vertices[i+k]);
+                }
+            }
+            this->cellSize = cellSize;
+            uint64_t count = 1;
+            for(int k=0; k<3; k++)
+            {
+                origin[k] = min[k] - padding*cellSize;
+                dims[k] = static_cast<uint32_t>(std::ceil((max[k]-min[k])/cellSize)) + 2*padding + 1;
+                count *= dims[k];
+            }
+            if(count > kMaxValues)
+            {
+                return false;
+            }
+            values.assign(count, std::numeric_limits<float>::max());
+
+            std::vector<int8_t> signs(count, 1);
+            computeNarrowBand(vertices, indices, kBandCells, &signs);
+            propagate(&signs);
+            for(size_t i=0; i<values.size(); i++)
+            {
+                if(signs[i] < 0)
+                {
+                    values[i] = -values[i];
+                }
+            }
+            return true;
+        }
+
+        bool DistanceField::assign(const dReal *origin, dReal cellSize, const uint32_t *dims,
+                                   const float *values, uint64_t count)
+        {
+            if(static_cast<uint64_t>(dims[0])*dims[1]*dims[2] != count)
+            {
+                return false;
+            }
+            std::copy(origin, origin+3, this->origin);
+            std::copy(dims, dims+3, this->dims);
+            this->cellSize = cellSize;
+            this->values.assign(values, values+count);
+            return true;
+        }
+
+        /**
+         * \brief Exact distances within the band around the triangles, the sign
+         * is taken from the pseudo-normal of the closest feature.
+         */
+        void DistanceField::computeNarrowBand(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices,
+                                              unsigned int band, std::vector<int8_t> *signs)
+        {
+            const PseudoNormals normals(vertices, indices);
+            const dReal bandDistance = band*cellSize;
+            for(size_t t=0; t+2<indices.size(); t+=3)
+            {
+                const Vector a(&vertices[indices[t]*3]);
+                const Vector b(&vertices[indices[t+1]*3]);
+                const Vector c(&vertices[indices[t+2]*3]);
+                int64_t lo[3], hi[3];
+                for(int k=0; k<3; k++)
+                {
+                    const dReal tmin = std::min(a[k], std::min(b[k], c[k])) - bandDistance;
+                    const dReal tmax = std::max(a[k], std::max(b[k], c[k])) + bandDistance;
+                    lo[k] = std::max<int64_t>(0, std::ceil((tmin-origin[k])/cellSize));
+                    hi[k] = std::min<int64_t>(dims[k]-1, std::floor((tmax-origin[k])/cellSize));
+                }
+                for(int64_t z=lo[2]; z<=hi[2]; z++)
+                {
+                    for(int64_t y=lo[1]; y<=hi[1]; y++)
+                    {
+                        for(int64_t x=lo[0]; x<=hi[0]; x++)
+                        {
+                            const Vector p(origin[0]+x*cellSize, origin[1]+y*cellSize, origin[2]+z*cellSize);
+                            const size_t cell = index(x, y, z);
+                            Feature feature;
+                            const Vector closest = closestPointOnTriangle(p, a, b, c, &feature);
+                            const dReal d = (p - closest).norm();
+                            if(d < values[cell])
+                            {
+                                values[cell] = static_cast<float>(d);
+                                (*signs)[cell] = (p - closest).dot(normals.get(t/3, feature)) < 0.0 ? -1 : 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * \brief Two pass chamfer distance transform with the 26 neighborhood,
+         * run twice to reduce the error of single pass propagation. A cell
+         * takes the sign of the neighbor its distance is propagated from.
+         */
+        void DistanceField::propagate(std::vector<int8_t> *signs)
+        {
+            struct Neighbor
+            {
+                int dx, dy, dz;
+                float weight;
+            };
+            // neighbors preceding a cell in scan order
+            std::vector<Neighbor> neighbors;
+            for(int dz=-1; dz<=0; dz++)
+            {
+                for(int dy=-1; dy<=1; dy++)
+                {
+                    for(int dx=-1; dx<=1; dx++)
+                    {
+                        if(dz == 0 && (dy > 0 || (dy == 0 && dx >= 0)))
+                        {
+                            continue;
+                        }
+                        neighbors.push_back({dx, dy, dz, static_cast<float>(cellSize*std::sqrt(dx*dx + dy*dy + dz*dz))});
+                    }
+                }
+            }
+            const int nx = dims[0], ny = dims[1], nz = dims[2];
+            for(int round=0; round<2; round++)
+            {
+                for(int pass=0; pass<2; pass++)
+                {
+                    // the backward pass mirrors the neighbors
+                    const int sign = pass ? -1 : 1;
+                    for(int i=0; i<nz; i++)
+                    {
+                        const int z = pass ? nz-1-i : i;
+                        for(int j=0; j<ny; j++)
+                        {
+                            const int y = pass ? ny-1-j : j;
+                            for(int l=0; l<nx; l++)
+                            {
+                                const int x = pass ? nx-1-l : l;
+                                const size_t cell = index(x, y, z);
+                                for(const auto &n : neighbors)
+                                {
+                                    const int px = x + sign*n.dx, py = y + sign*n.dy, pz = z + sign*n.dz;
+                                    if(px < 0 || py < 0 || pz < 0 || px >= nx || py >= ny || pz >= nz)
+                                    {
+                                        continue;
+                                    }
+                                    const size_t neighbor = index(px, py, pz);
+                                    const float candidate = values[neighbor] + n.weight;
+                                    if(candidate < values[cell])
+                                    {
+                                        values[cell] = candidate;
+                                        (*signs)[cell] = (*signs)[neighbor];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        bool DistanceField::sample(const dReal *p, dReal *distance, dReal *gradient) const
+        {
+            dReal u[3];
+            uint32_t i[3];
+            for(int k=0; k<3; k++)
+            {
+                const dReal g = (p[k] - origin[k])/cellSize;
+                if(!(g >= 0.0) || g >= dims[k]-1)
+                {
+                    return false;
+                }
+                i[k] = static_cast<uint32_t>(g);
+                u[k] = g - i[k];
+            }
+            dReal c[2][2][2];
+            for(int z=0; z<2; z++)
+            {
+                for(int y=0; y<2; y++)
+                {
+                    for(int x=0; x<2; x++)
+                    {
+                        c[z][y][x] = values[index(i[0]+x, i[1]+y, i[2]+z)];
+                    }
+                }
+            }
+            const dReal x0 = 1.0-u[0], y0 = 1.0-u[1], z0 = 1.0-u[2];
+            *distance = z0*(y0*(x0*c[0][0][0] + u[0]*c[0][0][1]) + u[1]*(x0*c[0][1][0] + u[0]*c[0][1][1])) +
+                u[2]*(y0*(x0*c[1][0][0] + u[0]*c[1][0][1]) + u[1]*(x0*c[1][1][0] + u[0]*c[1][1][1]));
+            if(gradient)
+            {
+                gradient[0] = (z0*(y0*(c[0][0][1]-c[0][0][0]) + u[1]*(c[0][1][1]-c[0][1][0])) +
+                               u[2]*(y0*(c[1][0][1]-c[1][0][0]) + u[1]*(c[1][1][1]-c[1][1][0])))/cellSize;
+                gradient[1] = (z0*(x0*(c[0][1][0]-c[0][0][0]) + u[0]*(c[0][1][1]-c[0][0][1])) +
+                               u[2]*(x0*(c[1][1][0]-c[1][0][0]) + u[0]*(c[1][1][1]-c[1][0][1])))/cellSize;
+                gradient[2] = (y0*(x0*(c[1][0][0]-c[0][0][0]) + u[0]*(c[1][0][1]-c[0][0][1])) +
+                               u[1]*(x0*(c[1][1][0]-c[0][1][0]) + u[0]*(c[1][1][1]-c[0][1][1])))/cellSize;
+            }
+            return true;
+        }
+
+        void DistanceField::getBounds(dReal *aabb) const
+        {
+            for(int k=0; k<3; k++)
+            {
+                aabb[k*2] = origin[k];
+                aabb[k*2+1] = origin[k] + (dims[k]-1)*cellSize;
+            }
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
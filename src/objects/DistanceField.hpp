@@ -0,0 +1,69 @@
+ /**
+ * \file DistanceField.hpp
+ * \brief "DistanceField" computes a dense signed distance grid of a triangle
+ *        mesh and samples it by trilinear interpolation.
+ *
+ */
+
+#pragma once
+
+#include <ode/ode.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * Distances are exact within a narrow band around the triangles and
+         * propagated with a chamfer distance transform outside of it. In the
+         * band the sign is given by the angle weighted pseudo-normal of the
+         * closest triangle feature, outside of it the sign is propagated with
+         * the distances. The field is negative behind the triangles (counter
+         * clockwise seen from the positive side), thus the mesh does not have
+         * to be closed and inward facing meshes give the inverted field.
+         */
+        class DistanceField
+        {
+        public:
+            DistanceField();
+
+            bool build(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices,
+                       dReal cellSize, unsigned int padding);
+            // sets up the grid from cached data
+            bool assign(const dReal *origin, dReal cellSize, const uint32_t *dims,
+                        const float *values, uint64_t count);
+
+            /**
+             * Returns false if the point is outside of the grid. The gradient
+             * points away from the surface (outwards) and is not normalized.
+             */
+            bool sample(const dReal *p, dReal *distance, dReal *gradient) const;
+
+            // local bounding box of the grid in ode layout
+            void getBounds(dReal *aabb) const;
+            uint64_t numValues() const
+            {
+                return values.size();
+            }
+
+            dReal origin[3];
+            dReal cellSize;
+            uint32_t dims[3];
+            std::vector<float> values;
+
+        private:
+            size_t index(uint32_t x, uint32_t y, uint32_t z) const
+            {
+                return (static_cast<size_t>(z)*dims[1] + y)*dims[0] + x;
+            }
+            void computeNarrowBand(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices,
+                                   unsigned int band, std::vector<int8_t> *signs);
+            void propagate(std::vector<int8_t> *signs);
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
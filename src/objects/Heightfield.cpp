@@ -1,6 +1,8 @@
 #include "Heightfield.hpp"
 #include <mars_interfaces/terrainStruct.h>
 
+#include <algorithm>
+
 namespace mars
 {
     namespace ode_collision
@@ -13,7 +15,9 @@ namespace mars
         Heightfield::Heightfield(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap& config) : 
             Object(space, movable, config),
             height_data{nullptr},
-            terrain{nullptr}
+            terrain{nullptr},
+            heightMin{dInfinity},
+            heightMax{-dInfinity}
         {}
 
         Heightfield::~Heightfield(void)
@@ -96,9 +100,69 @@ namespace mars
             dGeomSetData(nGeom, this);
             objectCreated = true;
             name << config["name"];
+
+            heightMin = dInfinity;
+            heightMax = -dInfinity;
+            updateRange(0, 0, terrain->width-1, terrain->height-1);
+            return true;
+        }
+
+        bool Heightfield::updatePatch(int row, int column, int rows, int columns, const double *values)
+        {
+            if(!nGeom)
+            {
+                LOG_ERROR("ode_collision::Heightfield: updatePatch called before the geom of %s is created", name.c_str());
+                return false;
+            }
+            if(row < 0 || column < 0 || rows < 1 || columns < 1 ||
+               row+rows > terrain->height || column+columns > terrain->width)
+            {
+                LOG_ERROR("ode_collision::Heightfield: patch out of range for %s", name.c_str());
+                return false;
+            }
+            for(int r=0; r<rows; r++)
+            {
+                const int x = row + r;
+                for(int c=0; c<columns; c++)
+                {
+                    const int y = column + c;
+                    const double value = values[r*columns+c];
+                    terrain->pixelData[x*terrain->width+y] = value;
+                    // the rows of height_data are flipped, see createGeom
+                    height_data[(terrain->height-(x+1))*terrain->width+y] = static_cast<dReal>(value);
+                }
+            }
+            // heights are read through the callback, so only the bounds need an update
+            updateRange(column, terrain->height-(row+rows), column+columns-1, terrain->height-(row+1));
+            updateBounds();
             return true;
         }
 
+        void Heightfield::updateRange(int x0, int y0, int x1, int y1)
+        {
+            for(int y=y0; y<=y1; y++)
+            {
+                const dReal *line = height_data + y*terrain->width;
+                for(int x=x0; x<=x1; x++)
+                {
+                    heightMin = std::min(heightMin, line[x]);
+                    heightMax = std::max(heightMax, line[x]);
+                }
+            }
+        }
+
+        void Heightfield::updateBounds()
+        {
+            const dReal min = heightMin*terrain->scale;
+            const dReal max = heightMax*terrain->scale;
+            // keep the conservative bounds of createGeom and only grow them
+            dGeomHeightfieldDataSetBounds(dGeomHeightfieldGetHeightfieldData(nGeom),
+                                          std::min(REAL(-terrain->scale*2.0), min),
+                                          std::max(REAL(terrain->scale*2.0), max));
+            // setting the position again makes ode recompute the aabb
+            updateTransform();
+        }
+
         void Heightfield::updateTransform(void)
         {
             // local transform is relative to parent frame
@@ -23,13 +23,28 @@ namespace mars
             virtual bool createGeom() override;
             dReal heightCallback(int x, int y);
             void setTerrainStruct(interfaces::terrainStruct* t);
+            /**
+             * \brief Replaces a rectangular patch of the terrain in place.
+             *
+             * row and column address the pixelData of the terrainStruct, values
+             * holds rows*columns heights in the same row major layout and units.
+             * Only the patched heights are folded into the height range that
+             * bounds the geom. Must not be called while contacts are generated.
+             */
+            bool updatePatch(int row, int column, int rows, int columns, const double *values);
             virtual void updateTransform(void) override;
             //override due to orientation offset
             void getRotation(utils::Quaternion* q) const;
 
         protected:
+            // folds [x0, x1] x [y0, y1] of height_data into heightMin/heightMax
+            void updateRange(int x0, int y0, int x1, int y1);
+            void updateBounds();
+
             interfaces::terrainStruct* terrain;
             dReal* height_data;
+            // running range of all heights so far, lowered heights do not shrink it
+            dReal heightMin, heightMax;
       
         };
 
@@ -0,0 +1,290 @@
+#include "InstancedScatter.hpp"
+#include "../UserGeomClass.hpp"
+
+#include <fstream>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+        using namespace interfaces;
+        using namespace configmaps;
+
+        namespace
+        {
+            // x, y, z, qw, qx, qy, qz, scale
+            const size_t kValuesPerInstance = 8;
+        }
+
+        InstancedScatter::InstancedScatter(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config) :
+            Object(space, movable, config),
+            prototypeType{kBox},
+            prototypeSize{0.0, 0.0, 0.0},
+            prototype{nullptr},
+            globalPos{0.0, 0.0, 0.0},
+            globalQ{1.0, 0.0, 0.0, 0.0}
+        {
+            LOG_INFO("ode_collision: InstancedScatter constructor.\n");
+        }
+
+        InstancedScatter::~InstancedScatter(void)
+        {
+            if(prototype)
+            {
+                dGeomDestroy(prototype);
+            }
+        }
+
+        Object* InstancedScatter::instantiate(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config)
+        {
+            InstancedScatter *scatter = new InstancedScatter(space, movable, config);
+            scatter->createGeom();
+            return scatter;
+        }
+
+        /**
+         * \brief Registers the scatter geom class with ode on first use.
+         */
+        int InstancedScatter::getGeomClass()
+        {
+            static const int geomClass = UserGeomClass::create(sizeof(InstancedScatter*), &InstancedScatter::getCollider,
+                                                               &InstancedScatter::computeAabb);
+            return geomClass;
+        }
+
+        dColliderFn* InstancedScatter::getCollider(int geomClass)
+        {
+            return &InstancedScatter::collide;
+        }
+
+        bool InstancedScatter::createGeom()
+        {
+            name << config["name"];
+            if(config.hasKey("bitmask"))
+            {
+                c_params.coll_bitmask = config["bitmask"];
+            }
+            if(!createPrototype() || !loadInstances())
+            {
+                return false;
+            }
+
+            std::vector<AabbTree::Aabb> bounds(instances.size());
+            for(size_t i=0; i<instances.size(); i++)
+            {
+                placePrototype(instances[i], Vector::Zero(), Quaternion::Identity());
+                dGeomGetAABB(prototype, bounds[i].data());
+            }
+            tree.build(bounds);
+            LOG_INFO("ode_collision::InstancedScatter: %s with %lu instances",
+                     name.c_str(), static_cast<unsigned long>(instances.size()));
+
+            nGeom = dCreateGeom(getGeomClass());
+            *static_cast<InstancedScatter**>(dGeomGetClassData(nGeom)) = this;
+            dSpaceAdd(space->getSpace(), nGeom);
+            dGeomSetData(nGeom, this);
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        bool InstancedScatter::createPrototype()
+        {
+            ConfigMap &prototypeConfig = config["prototype"];
+            const std::string type = prototypeConfig["type"];
+            // same convention as the primitive objects: radius in x and length in y
+            ConfigMap &extend = prototypeConfig["extend"];
+            prototypeSize[0] = extend["x"];
+            prototypeSize[1] = extend.hasKey("y") ? static_cast<double>(extend["y"]) : 0.0;
+            prototypeSize[2] = extend.hasKey("z") ? static_cast<double>(extend["z"]) : 0.0;
+            // the prototype is not inserted into a space
+            if(type == "box")
+            {
+                prototypeType = kBox;
+                prototype = dCreateBox(0, prototypeSize[0], prototypeSize[1], prototypeSize[2]);
+            }
+            else if(type == "sphere")
+            {
+                prototypeType = kSphere;
+                prototype = dCreateSphere(0, prototypeSize[0]);
+            }
+            else if(type == "capsule")
+            {
+                prototypeType = kCapsule;
+                prototype = dCreateCapsule(0, prototypeSize[0], prototypeSize[1]);
+            }
+            else if(type == "cylinder")
+            {
+                prototypeType = kCylinder;
+                prototype = dCreateCylinder(0, prototypeSize[0], prototypeSize[1]);
+            }
+            else
+            {
+                LOG_ERROR("ode_collision::InstancedScatter: unsupported prototype type \"%s\" in %s", type.c_str(), name.c_str());
+                return false;
+            }
+            dGeomSetData(prototype, this);
+            return true;
+        }
+
+        bool InstancedScatter::loadInstances()
+        {
+            std::vector<double> values;
+            if(config.hasKey("instances_file"))
+            {
+                const std::string file = config["instances_file"];
+                std::ifstream stream(file);
+                if(!stream)
+                {
+                    LOG_ERROR("ode_collision::InstancedScatter: could not open %s", file.c_str());
+                    return false;
+                }
+                double value;
+                while(stream >> value)
+                {
+                    values.push_back(value);
+                }
+            }
+            if(config.hasKey("instances"))
+            {
+                ConfigVector &inlineValues = config["instances"];
+                values.reserve(values.size() + inlineValues.size());
+                for(auto &item : inlineValues)
+                {
+                    values.push_back(item);
+                }
+            }
+            if(values.size() % kValuesPerInstance)
+            {
+                LOG_WARN("ode_collision::InstancedScatter: %s: ignore incomplete instance at the end", name.c_str());
+            }
+
+            instances.resize(values.size()/kValuesPerInstance);
+            for(size_t i=0; i<instances.size(); i++)
+            {
+                const double *v = &values[i*kValuesPerInstance];
+                Instance &instance = instances[i];
+                // normalize in double precision before storing the compact instance
+                Quaternion q(v[3], v[4], v[5], v[6]);
+                q.normalize();
+                for(int k=0; k<3; k++)
+                {
+                    instance.pos[k] = v[k];
+                }
+                instance.q[0] = q.w();
+                instance.q[1] = q.x();
+                instance.q[2] = q.y();
+                instance.q[3] = q.z();
+                instance.scale = v[7];
+            }
+            if(instances.empty())
+            {
+                LOG_ERROR("ode_collision::InstancedScatter: %s has no instances", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void InstancedScatter::placePrototype(const Instance &instance, const Vector &framePos,
+                                              const Quaternion &frameQ)
+        {
+            const dReal s = instance.scale;
+            switch(prototypeType)
+            {
+            case kBox:
+                dGeomBoxSetLengths(prototype, prototypeSize[0]*s, prototypeSize[1]*s, prototypeSize[2]*s);
+                break;
+            case kSphere:
+                dGeomSphereSetRadius(prototype, prototypeSize[0]*s);
+                break;
+            case kCapsule:
+                dGeomCapsuleSetParams(prototype, prototypeSize[0]*s, prototypeSize[1]*s);
+                break;
+            case kCylinder:
+                dGeomCylinderSetParams(prototype, prototypeSize[0]*s, prototypeSize[1]*s);
+                break;
+            }
+            const Vector pos = framePos + frameQ*Vector(instance.pos[0], instance.pos[1], instance.pos[2]);
+            const Quaternion q = frameQ*Quaternion(instance.q[0], instance.q[1], instance.q[2], instance.q[3]);
+            dGeomSetPosition(prototype, pos.x(), pos.y(), pos.z());
+            dQuaternion dQ = {q.w(), q.x(), q.y(), q.z()};
+            dGeomSetQuaternion(prototype, dQ);
+        }
+
+        void InstancedScatter::updateTransform(void)
+        {
+            if(!nGeom)
+            {
+                return;
+            }
+            getGlobalTransform(&globalPos, &globalQ);
+            dGeomSetPosition(nGeom, globalPos.x(), globalPos.y(), globalPos.z());
+            dQuaternion dQ = {globalQ.w(), globalQ.x(), globalQ.y(), globalQ.z()};
+            dGeomSetQuaternion(nGeom, dQ);
+        }
+
+        void InstancedScatter::computeAabb(dGeomID geom, dReal aabb[6])
+        {
+            const InstancedScatter *scatter = *static_cast<InstancedScatter**>(dGeomGetClassData(geom));
+            const dReal *p = dGeomGetPosition(geom);
+            if(scatter->tree.empty())
+            {
+                aabb[0] = aabb[1] = p[0];
+                aabb[2] = aabb[3] = p[1];
+                aabb[4] = aabb[5] = p[2];
+                return;
+            }
+            AabbTree::transform(scatter->tree.getBounds().data(), Vector(p[0], p[1], p[2]),
+                                scatter->globalQ.toRotationMatrix(), aabb);
+        }
+
+        /**
+         * \brief Collider of the scatter class, o1 is always the scatter.
+         */
+        int InstancedScatter::collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip)
+        {
+            InstancedScatter *scatter = *static_cast<InstancedScatter**>(dGeomGetClassData(o1));
+            const int maxContacts = flags & UserGeomClass::kNumContactsMask;
+            if(maxContacts < 1)
+            {
+                return 0;
+            }
+
+            // bounding box of the other geom in scatter coordinates
+            dReal aabb[6], localAabb[6];
+            dGeomGetAABB(o2, aabb);
+            const Matrix inverse = scatter->globalQ.conjugate().toRotationMatrix();
+            AabbTree::transform(aabb, -(inverse*scatter->globalPos), inverse, localAabb);
+
+            int numContacts = 0;
+            scatter->tree.query(localAabb, [&](unsigned int index)
+            {
+                if(numContacts >= maxContacts || ((flags & CONTACTS_UNIMPORTANT) && numContacts))
+                {
+                    return;
+                }
+                scatter->placePrototype(scatter->instances[index], scatter->globalPos, scatter->globalQ);
+                dContactGeom *out = UserGeomClass::contactAt(contact, numContacts, skip);
+                const int n = dCollide(scatter->prototype, o2, (flags & ~UserGeomClass::kNumContactsMask) | (maxContacts-numContacts), out, skip);
+                for(int i=0; i<n; i++)
+                {
+                    UserGeomClass::contactAt(out, i, skip)->g1 = o1;
+                    // the instance index allows to identify the hit instance
+                    UserGeomClass::contactAt(out, i, skip)->side1 = index;
+                }
+                numContacts += n;
+            });
+            return numContacts;
+        }
+
+        ConfigMap InstancedScatter::getConfigMap() const
+        {
+            ConfigMap result = Object::getConfigMap();
+            result["instances"] = static_cast<int>(instances.size());
+            return result;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,76 @@
+ /**
+ * \file InstancedScatter.hpp
+ * \brief "InstancedScatter" places many static instances of one primitive
+ *        prototype behind a single geom.
+ *
+ */
+
+#pragma once
+
+#include "Object.hpp"
+#include "../AabbTree.hpp"
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The instances are given as compact array of transforms (x, y, z,
+         * qw, qx, qy, qz, scale) in object coordinates, either inline in
+         * "instances" or in the text file "instances_file". Only one geom of a
+         * user geom class is inserted into the space. Its collider looks up the
+         * instances overlapping the other geom in a static AabbTree and collides
+         * them one by one with a single prototype geom that is resized and
+         * positioned for each instance.
+         */
+        class InstancedScatter : public Object
+        {
+        public:
+            InstancedScatter(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual ~InstancedScatter(void);
+            static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual bool createGeom() override;
+            virtual void updateTransform(void) override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+
+        private:
+            struct Instance
+            {
+                float pos[3];
+                float q[4];
+                float scale;
+            };
+
+            static int getGeomClass();
+            static dColliderFn* getCollider(int geomClass);
+            static int collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip);
+            static void computeAabb(dGeomID geom, dReal aabb[6]);
+
+            bool createPrototype();
+            bool loadInstances();
+            // resizes the prototype geom and places it at the instance pose in the given frame
+            void placePrototype(const Instance &instance, const utils::Vector &framePos,
+                                const utils::Quaternion &frameQ);
+
+            enum PrototypeType
+            {
+                kBox,
+                kSphere,
+                kCapsule,
+                kCylinder,
+            };
+            PrototypeType prototypeType;
+            dReal prototypeSize[3];
+            dGeomID prototype;
+            std::vector<Instance> instances;
+            // instance bounds in scatter coordinates
+            AabbTree tree;
+            utils::Vector globalPos;
+            utils::Quaternion globalQ;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -1,5 +1,12 @@
 #include "Mesh.hpp"
+#include "MeshPreprocessor.hpp"
+#include "../Distance.hpp"
+#include "../WorkerPool.hpp"
 #include <mars_interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars_utils/mathUtils.h>
+
+#include <algorithm>
+#include <filesystem>
 
 namespace mars
 {
@@ -15,18 +22,42 @@ namespace mars
             myIndices{nullptr},
             myTriMeshData{nullptr},
             vertexcount{0},
-            indexcount{0}
+            indexcount{0},
+            meshKey{0},
+            buildFailed{false},
+            singlePrecision{false},
+            singlePrecisionTolerance{-1.0},
+            lastTransformValid{false},
+            currentLevel{0},
+            fullResolutionGeom{nullptr}
         {
             LOG_INFO("ode_collision: Mesh constructor.\n");
         }
 
         Mesh::~Mesh(void)
         {
+            if(buildResult.valid())
+            {
+                buildResult.wait();
+                space->removePendingObject(this);
+            }
+            if(fullResolutionGeom)
+            {
+                dGeomDestroy(fullResolutionGeom);
+            }
             freeMemory();
         }
 
         void Mesh::freeMemory()
         {
+            if(cacheEntry)
+            {
+                // vertices and indices are part of the mapped cache file
+                cacheEntry.reset();
+                myVertices = nullptr;
+                myIndices = nullptr;
+                vertexcount = indexcount = 0;
+            }
             if(myVertices)
             {
                 free(myVertices);
@@ -39,11 +70,28 @@ namespace mars
                 myIndices = nullptr;
                 indexcount = 0;
             }
+            if(!singleVertices.empty())
+            {
+                singleVertices.clear();
+                singleVertices.shrink_to_fit();
+                vertexcount = 0;
+            }
             if(myTriMeshData)
             {
+                Distance::releaseTriMeshData(myTriMeshData);
                 dGeomTriMeshDataDestroy(myTriMeshData);
                 myTriMeshData = nullptr;
             }
+            for(auto &level : lodLevels)
+            {
+                if(level.data)
+                {
+                    Distance::releaseTriMeshData(level.data);
+                    dGeomTriMeshDataDestroy(level.data);
+                }
+            }
+            lodLevels.clear();
+            currentLevel = 0;
         }
 
         Object* Mesh::instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, ConfigMap& config)
@@ -53,11 +101,11 @@ namespace mars
 
         void Mesh::setMeshData(snmesh &mesh)
         {
+            freeMemory();
+
             vertexcount = mesh.vertexcount;
             indexcount = mesh.indexcount;
 
-            freeMemory();
-
             myVertices = (dVector3*)calloc(vertexcount, sizeof(dVector3));
             myIndices = (dTriIndex*)calloc(indexcount, sizeof(dTriIndex));
 
@@ -74,6 +122,11 @@ namespace mars
             {
                 myIndices[i] = static_cast<dTriIndex>(mesh.indices[i]);
             }
+
+            const uint32_t layout[2] = {sizeof(dReal), sizeof(dTriIndex)};
+            meshKey = MeshCache::hash(layout, sizeof(layout));
+            meshKey = MeshCache::hash(myVertices, vertexcount*sizeof(dVector3), meshKey);
+            meshKey = MeshCache::hash(myIndices, indexcount*sizeof(dTriIndex), meshKey);
         }
 
         // todo: add proper error handling -> setMeshData have to be called before createGeom is called...
@@ -82,59 +135,696 @@ namespace mars
             assert(vertexcount > 0);
 
             name << config["name"];
-            // // build the ode representation
+            readBuildConfig();
+            if(config.hasKey("proxy_fit") && createProxyGeom())
+            {
+                return true;
+            }
+            if(config.hasKey("async_build") && static_cast<bool>(config["async_build"]))
+            {
+                // the geom is inserted into the space by CollisionSpace::completePendingObjects
+                // as soon as the trimesh data is ready
+                buildResult = space->getWorkerPool().submit([this]() { buildTriMeshData(); });
+                space->addPendingObject(this);
+                return true;
+            }
+            buildTriMeshData();
+            return completeGeom(true);
+        }
+
+        bool Mesh::completeGeom(bool wait)
+        {
+            if(objectCreated || buildFailed)
+            {
+                return true;
+            }
+            if(buildResult.valid())
+            {
+                if(!wait && buildResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    return false;
+                }
+                try
+                {
+                    buildResult.get();
+                }
+                catch(const std::exception &e)
+                {
+                    LOG_ERROR("ode_collision::Mesh: failed to build trimesh data of %s: %s", name.c_str(), e.what());
+                    buildFailed = true;
+                    return true;
+                }
+            }
+            nGeom = dCreateTriMesh(space->getSpace(), myTriMeshData, 0, 0, 0);
+            // we could need this in the collision callback
+            dGeomSetData(nGeom, this);
+            setupTemporalCoherence();
+            if(!lodLevels.empty() && !fullResolutionObjects.empty())
+            {
+                // not part of any space, only used in CollisionSpace::nearCallback
+                fullResolutionGeom = dCreateTriMesh(0, myTriMeshData, 0, 0, 0);
+                dGeomSetData(fullResolutionGeom, this);
+            }
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        /**
+         * \brief Copies the config values needed by buildTriMeshData.
+         *
+         * ConfigMap::operator[] inserts missing keys, reading the config from
+         * the worker would race with getConfigMap on the main thread.
+         */
+        void Mesh::readBuildConfig()
+        {
+            extend[0] = config["extend"]["x"];
+            extend[1] = config["extend"]["y"];
+            extend[2] = config["extend"]["z"];
+            preprocessParams = MeshPreprocessParams::fromConfig(config);
+            cachePath.clear();
+            if(config.hasKey("cache") && static_cast<bool>(config["cache"]))
+            {
+                cachePath = MeshCache::defaultCachePath();
+                if(config.hasKey("cache_path"))
+                {
+                    cachePath << config["cache_path"];
+                }
+            }
+            singlePrecision = config.hasKey("single_precision") && static_cast<bool>(config["single_precision"]);
+            singlePrecisionTolerance = -1.0;
+            if(config.hasKey("single_precision_tolerance"))
+            {
+                singlePrecisionTolerance = config["single_precision_tolerance"];
+            }
+
+            // the levels are decimated by the worker
+            lodLevels.clear();
+            fullResolutionObjects.clear();
+            if(!config.hasKey("lod"))
+            {
+                return;
+            }
+            ConfigMap &lod = config["lod"];
+            if(lod.hasKey("full_resolution"))
+            {
+                ConfigVector &names = lod["full_resolution"];
+                for(auto &item : names)
+                {
+                    fullResolutionObjects.insert(item.toString());
+                }
+            }
+            if(!lod.hasKey("levels"))
+            {
+                return;
+            }
+            ConfigVector &levels = lod["levels"];
+            for(auto &item : levels)
+            {
+                LevelOfDetail level;
+                level.distance = item["distance"];
+                level.maxTriangles = static_cast<int>(item["max_triangles"]);
+                level.data = nullptr;
+                lodLevels.push_back(std::move(level));
+            }
+            std::sort(lodLevels.begin(), lodLevels.end(),
+                      [](const LevelOfDetail &a, const LevelOfDetail &b) { return a.distance < b.distance; });
+        }
+
+        /**
+         * \brief Enables the trimesh temporal coherence caches per geom class.
+         *
+         * ode keeps the contact state of the last step for sphere, box and capsule
+         * collisions ("temporal_coherence" map, all disabled by default).
+         */
+        void Mesh::setupTemporalCoherence()
+        {
+            if(!config.hasKey("temporal_coherence"))
+            {
+                return;
+            }
+            ConfigMap &tc = config["temporal_coherence"];
+            const std::pair<const char*, int> classes[] = {{"sphere", dSphereClass},
+                                                           {"box", dBoxClass},
+                                                           {"capsule", dCapsuleClass}};
+            for(const auto &geomClass : classes)
+            {
+                if(tc.hasKey(geomClass.first))
+                {
+                    dGeomTriMeshEnableTC(nGeom, geomClass.second, static_cast<bool>(tc[geomClass.first]) ? 1 : 0);
+                }
+            }
+        }
+
+        /**
+         * \brief Replaces the trimesh by a box, sphere, capsule or cylinder if
+         * the scaled mesh is within the configured fit tolerance.
+         *
+         * The tolerance is relative to the largest extend of the mesh.
+         */
+        bool Mesh::createProxyGeom()
+        {
+            ConfigMap &fitConfig = config["proxy_fit"];
+            if(fitConfig.hasKey("enabled") && !static_cast<bool>(fitConfig["enabled"]))
+            {
+                return false;
+            }
+            const dReal tolerance = fitConfig.hasKey("tolerance") ? static_cast<double>(fitConfig["tolerance"]) : 0.02;
+
+            dReal scale[3], inputBounds[6];
+            computeScale(scale, inputBounds);
+            std::vector<dReal> vertices(vertexcount*3);
+            for(unsigned long i=0; i<vertexcount; i++)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    vertices[i*3+k] = myVertices[i][k]*scale[k];
+                }
+            }
+            const std::vector<dTriIndex> indices(myIndices, myIndices+indexcount);
+            const PrimitiveFit fit = PrimitiveFit::fit(vertices, indices);
+            if(fit.type == PrimitiveFit::kNone || fit.error > tolerance)
+            {
+                LOG_INFO("ode_collision::Mesh: no primitive proxy for %s (best: %s, error %g)",
+                         name.c_str(), PrimitiveFit::typeName(fit.type).c_str(), fit.error);
+                return false;
+            }
+
+            switch(fit.type)
+            {
+            case PrimitiveFit::kSphere:
+                nGeom = dCreateSphere(space->getSpace(), fit.params[0]);
+                break;
+            case PrimitiveFit::kCapsule:
+                nGeom = dCreateCapsule(space->getSpace(), fit.params[0], fit.params[1]);
+                break;
+            case PrimitiveFit::kBox:
+                nGeom = dCreateBox(space->getSpace(), fit.params[0], fit.params[1], fit.params[2]);
+                break;
+            case PrimitiveFit::kCylinder:
+                nGeom = dCreateCylinder(space->getSpace(), fit.params[0], fit.params[1]);
+                break;
+            default:
+                return false;
+            }
+            LOG_INFO("ode_collision::Mesh: replaced %s by a %s proxy (error %g)",
+                     name.c_str(), PrimitiveFit::typeName(fit.type).c_str(), fit.error);
+            proxy = fit;
+            // the mesh data is not needed anymore
+            freeMemory();
+            dGeomSetData(nGeom, this);
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        /**
+         * \brief Prepares the vertex data and builds the ode trimesh data.
+         *
+         * This method does not touch the space and can be called from a worker thread.
+         */
+        void Mesh::buildTriMeshData()
+        {
+            const uint64_t key = computeCacheKey();
+            const std::string cacheFile = getCacheFile("mesh", key);
+            if(cacheFile.empty() || !loadFromCache(cacheFile, key))
+            {
+                processMeshData();
+                if(!cacheFile.empty())
+                {
+                    storeInCache(cacheFile, key);
+                }
+            }
+
+            buildLevelsOfDetail();
+            // build the ode representation
             myTriMeshData = dGeomTriMeshDataCreate();
-            
-            dReal minx = std::numeric_limits<dReal>::max();
-            dReal miny = std::numeric_limits<dReal>::max();
-            dReal minz = std::numeric_limits<dReal>::max();
-            dReal maxx = std::numeric_limits<dReal>::min();
-            dReal maxy = std::numeric_limits<dReal>::min();
-            dReal maxz = std::numeric_limits<dReal>::min();
+            buildOdeData();
+        }
+
+        /**
+         * \brief Builds the decimated resolutions configured in "lod/levels".
+         *
+         * The levels are set up by readBuildConfig. Each level is decimated from the previous one, the levels are kept in
+         * double precision since they are small compared to the full mesh.
+         */
+        void Mesh::buildLevelsOfDetail()
+        {
+            if(lodLevels.empty())
+            {
+                return;
+            }
+            std::vector<dReal> vertices(vertexcount*3);
             for(unsigned long i=0; i<vertexcount; i++)
             {
-                minx = std::min(minx, myVertices[i][0]);
-                miny = std::min(miny, myVertices[i][1]);
-                minz = std::min(minz, myVertices[i][2]);
-                maxx = std::max(maxx, myVertices[i][0]);
-                maxy = std::max(maxy, myVertices[i][1]);
-                maxz = std::max(maxz, myVertices[i][2]);
+                std::copy(myVertices[i], myVertices[i]+3, &vertices[i*3]);
+            }
+            std::vector<dTriIndex> indices(myIndices, myIndices+indexcount);
+            for(auto &level : lodLevels)
+            {
+                MeshPreprocessor(vertices, indices).decimate(level.maxTriangles);
+                level.vertices.assign(vertices.size()/3*4, 0.0);
+                for(size_t i=0; i<vertices.size()/3; i++)
+                {
+                    std::copy(&vertices[i*3], &vertices[i*3]+3, &level.vertices[i*4]);
+                }
+                level.indices = indices;
+                level.data = dGeomTriMeshDataCreate();
+                dGeomTriMeshDataBuildSimple(level.data, level.vertices.data(), level.vertices.size()/4,
+                                            level.indices.data(), level.indices.size());
+                LOG_INFO("ode_collision::Mesh: %s level of detail at %g: %lu triangles",
+                         name.c_str(), level.distance, static_cast<unsigned long>(level.indices.size()/3));
+            }
+        }
+
+        bool Mesh::hasLevelOfDetail() const
+        {
+            return nGeom && !lodLevels.empty();
+        }
+
+        void Mesh::updateLevelOfDetail(dReal distance)
+        {
+            size_t level = 0;
+            for(size_t i=0; i<lodLevels.size(); i++)
+            {
+                if(distance >= lodLevels[i].distance)
+                {
+                    level = i+1;
+                }
+            }
+            if(level == currentLevel)
+            {
+                return;
             }
+            dGeomTriMeshSetData(nGeom, level ? lodLevels[level-1].data : myTriMeshData);
+            dGeomTriMeshClearTCCache(nGeom);
+            currentLevel = level;
+        }
+
+        dGeomID Mesh::selectPairGeom(dGeomID geom, const Object *other) const
+        {
+            if(fullResolutionGeom && currentLevel > 0 && fullResolutionObjects.count(other->getName()))
+            {
+                return fullResolutionGeom;
+            }
+            return geom;
+        }
+
+        dReal Mesh::convertToSinglePrecision(const dVector3 *vertices, unsigned long count, std::vector<float> *result)
+        {
+            dReal error = 0.0;
+            result->resize(count*3);
+            for(unsigned long i=0; i<count; i++)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    const float value = static_cast<float>(vertices[i][k]);
+                    (*result)[i*3+k] = value;
+                    error = std::max(error, std::fabs(vertices[i][k] - static_cast<dReal>(value)));
+                }
+            }
+            return error;
+        }
+
+        /**
+         * \brief (Re)builds the ode trimesh data from the current vertex data.
+         *
+         * With "single_precision" the vertices are handed to ode as packed float3
+         * array and the dVector3 copy is released. The largest rounding error is
+         * checked against "single_precision_tolerance" (if given); if the
+         * tolerance is exceeded the mesh is kept in double precision.
+         */
+        void Mesh::buildOdeData()
+        {
+            if(singlePrecision && singleVertices.empty())
+            {
+                const dReal error = convertToSinglePrecision(myVertices, vertexcount, &singleVertices);
+                LOG_INFO("ode_collision::Mesh: %s stored in single precision (max rounding error %g)",
+                         name.c_str(), error);
+                if(singlePrecisionTolerance >= 0.0 && error > singlePrecisionTolerance)
+                {
+                    LOG_WARN("ode_collision::Mesh: rounding error of %s exceeds single_precision_tolerance, keep double precision",
+                             name.c_str());
+                    singleVertices.clear();
+                    singleVertices.shrink_to_fit();
+                }
+                else if(!cacheEntry)
+                {
+                    // the mapped cache data is not resident unless touched, only free own memory
+                    free(myVertices);
+                    myVertices = nullptr;
+                }
+            }
+
+            if(!singleVertices.empty())
+            {
+                dGeomTriMeshDataBuildSingle(myTriMeshData, singleVertices.data(), 3*sizeof(float), vertexcount,
+                                            myIndices, indexcount, 3*sizeof(dTriIndex));
+            }
+            else
+            {
+                // TODO :what to do here. how can we calculate this??
+                dGeomTriMeshDataBuildSimple(myTriMeshData, reinterpret_cast<dReal*>(myVertices), vertexcount, myIndices, indexcount) ;
+            }
+        }
+
+        /**
+         * The cache is keyed by the input mesh and all parameters used to process it.
+         */
+        uint64_t Mesh::computeCacheKey()
+        {
+            const double extendKey[3] = {extend[0], extend[1], extend[2]};
+            uint64_t key = MeshCache::hash(extendKey, sizeof(extendKey), meshKey);
+            key = MeshCache::hash(&preprocessParams.weldTolerance, sizeof(preprocessParams.weldTolerance), key);
+            key = MeshCache::hash(&preprocessParams.removeDegenerate, sizeof(preprocessParams.removeDegenerate), key);
+            key = MeshCache::hash(&preprocessParams.maxTriangles, sizeof(preprocessParams.maxTriangles), key);
+            return key;
+        }
+
+        std::string Mesh::getCacheFile(const std::string &prefix, uint64_t key)
+        {
+            if(cachePath.empty())
+            {
+                return "";
+            }
+            return MeshCache::entryPath(cachePath, prefix, key);
+        }
+
+        /**
+         * \brief Rescales the input vertices to the extend given by the config
+         * and applies the optional preprocessing steps.
+         */
+        void Mesh::computeScale(dReal *scale, dReal *inputBounds)
+        {
+            dReal *min = inputBounds, *max = inputBounds+3;
+            for(int k=0; k<3; k++)
+            {
+                min[k] = std::numeric_limits<dReal>::max();
+                max[k] = std::numeric_limits<dReal>::lowest();
+            }
+            for(unsigned long i=0; i<vertexcount; i++)
+            {
+                for(int k=0; k<3; k++)
+                {
+                    min[k] = std::min(min[k], myVertices[i][k]);
+                    max[k] = std::max(max[k], myVertices[i][k]);
+                }
+            }
+            for(int k=0; k<3; k++)
+            {
+                scale[k] = extend[k]/(max[k]-min[k]);
+            }
+        }
+
+        void Mesh::processMeshData()
+        {
+            dReal scale[3], inputBounds[6];
+            computeScale(scale, inputBounds);
             // rescale
-            const dReal sx = static_cast<double>(config["extend"]["x"])/(maxx-minx);
-            const dReal sy = static_cast<double>(config["extend"]["y"])/(maxy-miny);
-            const dReal sz = static_cast<double>(config["extend"]["z"])/(maxz-minz);
             for(unsigned long i=0; i<vertexcount; i++)
             {
-                myVertices[i][0] *= sx;
-                myVertices[i][1] *= sy;
-                myVertices[i][2] *= sz;
+                myVertices[i][0] *= scale[0];
+                myVertices[i][1] *= scale[1];
+                myVertices[i][2] *= scale[2];
             }
 
-            // TODO :what to do here. how can we calculate this??
-            dGeomTriMeshDataBuildSimple(myTriMeshData, reinterpret_cast<dReal*>(myVertices), vertexcount, myIndices, indexcount) ;
+            if(preprocessParams.isEnabled())
+            {
+                // preprocessing is done in world units, after rescaling
+                std::vector<dReal> vertices(vertexcount*3);
+                for(unsigned long i=0; i<vertexcount; i++)
+                {
+                    std::copy(myVertices[i], myVertices[i]+3, &vertices[i*3]);
+                }
+                std::vector<dTriIndex> indices(myIndices, myIndices+indexcount);
+                MeshPreprocessor(vertices, indices).process(preprocessParams);
+                LOG_INFO("ode_collision::Mesh: preprocessed %s: %lu -> %lu vertices, %lu -> %lu triangles",
+                         name.c_str(), vertexcount, static_cast<unsigned long>(vertices.size()/3),
+                         indexcount/3, static_cast<unsigned long>(indices.size()/3));
+                if(indices.empty())
+                {
+                    // ode does not accept an empty trimesh
+                    LOG_ERROR("ode_collision::Mesh: preprocessing removed all triangles of %s, keep the input mesh",
+                              name.c_str());
+                }
+                else
+                {
+                    vertexcount = vertices.size()/3;
+                    indexcount = indices.size();
+                    myVertices = (dVector3*)realloc(myVertices, vertexcount*sizeof(dVector3));
+                    myIndices = (dTriIndex*)realloc(myIndices, indexcount*sizeof(dTriIndex));
+                    for(unsigned long i=0; i<vertexcount; i++)
+                    {
+                        std::copy(&vertices[i*3], &vertices[i*3]+3, myVertices[i]);
+                        myVertices[i][3] = 0.0;
+                    }
+                    std::copy(indices.begin(), indices.end(), myIndices);
+                }
+            }
+            for(int k=0; k<6; k++)
+            {
+                bounds[k] = inputBounds[k]*scale[k%3];
+            }
+        }
 
-            nGeom = dCreateTriMesh(space->getSpace(), myTriMeshData, 0, 0, 0);
-            // we could need this in the collision callback
-            dGeomSetData(nGeom, this);
-            objectCreated = true;
+        bool Mesh::loadFromCache(const std::string &file, uint64_t key)
+        {
+            auto entry = std::make_unique<MeshCache>();
+            if(!entry->open(file, key))
+            {
+                return false;
+            }
+            uint64_t numVertices = 0, numIndices = 0, numBounds = 0;
+            auto *vertices = entry->getSection<dVector3>(MeshCache::kVertices, &numVertices);
+            auto *indices = entry->getSection<dTriIndex>(MeshCache::kIndices, &numIndices);
+            const auto *cachedBounds = entry->getSection<dReal>(MeshCache::kBounds, &numBounds);
+            if(!vertices || !indices || !cachedBounds || numBounds != 6)
+            {
+                LOG_WARN("ode_collision::Mesh: ignore incomplete cache file %s", file.c_str());
+                return false;
+            }
+            freeMemory();
+            myVertices = vertices;
+            myIndices = indices;
+            vertexcount = numVertices;
+            indexcount = numIndices;
+            std::copy(cachedBounds, cachedBounds+6, bounds);
+            cacheEntry = std::move(entry);
             return true;
         }
 
+        void Mesh::storeInCache(const std::string &file, uint64_t key) const
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+            MeshCache::Writer writer;
+            writer.addSection(MeshCache::kVertices, myVertices, sizeof(dVector3), vertexcount);
+            writer.addSection(MeshCache::kIndices, myIndices, sizeof(dTriIndex), indexcount);
+            writer.addSection(MeshCache::kBounds, bounds, sizeof(dReal), 6);
+            writer.write(file, key);
+        }
+
+        void Mesh::updateTransform(void)
+        {
+            if(proxy.type == PrimitiveFit::kNone)
+            {
+                if(!nGeom)
+                {
+                    return;
+                }
+                // ode uses the last transform of moving trimeshes to estimate
+                // contact velocities in the trimesh-trimesh collider
+                const bool storeLast = movable && lastTransformValid;
+                if(storeLast)
+                {
+                    setTransformMatrix(lastTransform);
+                }
+                Object::updateTransform();
+                if(!storeLast)
+                {
+                    setTransformMatrix(lastTransform);
+                    lastTransformValid = true;
+                }
+                dGeomTriMeshSetLastTransform(nGeom, lastTransform);
+                if(fullResolutionGeom)
+                {
+                    const dReal *p = dGeomGetPosition(nGeom);
+                    dGeomSetPosition(fullResolutionGeom, p[0], p[1], p[2]);
+                    dGeomSetRotation(fullResolutionGeom, dGeomGetRotation(nGeom));
+                    dGeomTriMeshSetLastTransform(fullResolutionGeom, lastTransform);
+                }
+                return;
+            }
+            Vector globalPos;
+            Quaternion globalQ;
+            getGlobalTransform(&globalPos, &globalQ);
+            // the proxy is placed at its offset in the mesh frame
+            const Vector proxyPos = globalPos + globalQ*proxy.center;
+            const Quaternion proxyQ = globalQ*proxy.rotation;
+            dGeomSetPosition(nGeom, proxyPos.x(), proxyPos.y(), proxyPos.z());
+            dQuaternion dQ = {proxyQ.w(), proxyQ.x(), proxyQ.y(), proxyQ.z()};
+            dGeomSetQuaternion(nGeom, dQ);
+        }
+
+        /**
+         * \brief Writes the current pose of the trimesh geom in the layout
+         * expected by dGeomTriMeshSetLastTransform (transposed rotation,
+         * position in the last row).
+         */
+        void Mesh::setTransformMatrix(dMatrix4 m) const
+        {
+            const dReal *p = dGeomGetPosition(nGeom);
+            const dReal *r = dGeomGetRotation(nGeom);
+            m[0] = r[0]; m[1] = r[4]; m[2] = r[8]; m[3] = 0.0;
+            m[4] = r[1]; m[5] = r[5]; m[6] = r[9]; m[7] = 0.0;
+            m[8] = r[2]; m[9] = r[6]; m[10] = r[10]; m[11] = 0.0;
+            m[12] = p[0]; m[13] = p[1]; m[14] = p[2]; m[15] = 1.0;
+        }
+
+        void Mesh::getPosition(Vector *pos) const
+        {
+            if(proxy.type == PrimitiveFit::kNone)
+            {
+                Object::getPosition(pos);
+                return;
+            }
+            Quaternion globalQ;
+            getGlobalTransform(pos, &globalQ);
+        }
+
+        void Mesh::getRotation(Quaternion *q) const
+        {
+            if(proxy.type == PrimitiveFit::kNone)
+            {
+                Object::getRotation(q);
+                return;
+            }
+            Vector globalPos;
+            getGlobalTransform(&globalPos, q);
+        }
+
+        configmaps::ConfigMap Mesh::getConfigMap() const
+        {
+            ConfigMap result = Object::getConfigMap();
+            if(proxy.type != PrimitiveFit::kNone)
+            {
+                ConfigMap proxyMap;
+                proxyMap["type"] = PrimitiveFit::typeName(proxy.type);
+                proxyMap["error"] = proxy.error;
+                proxyMap["position (local)"] = vectorToConfigItem(proxy.center);
+                proxyMap["rotation (local)"] = quaternionToConfigItem(proxy.rotation);
+                result["proxy"] = proxyMap;
+            }
+            if(!lodLevels.empty())
+            {
+                result["lod_level"] = static_cast<int>(currentLevel);
+            }
+            return result;
+        }
+
+        /**
+         * \brief Scales the primitive proxy with the mesh.
+         *
+         * The scale is given in the mesh frame. Each local axis of the proxy
+         * is stretched by the length of its scaled direction; the radius uses
+         * the larger stretch of the radial axes so that the scaled mesh stays
+         * covered if the scale is not uniform.
+         */
+        void Mesh::scaleProxyGeom(const utils::Vector &scale)
+        {
+            proxy.center = proxy.center.cwiseProduct(scale);
+            const Matrix rotation = proxy.rotation.toRotationMatrix();
+            dReal stretch[3];
+            for(int k=0; k<3; k++)
+            {
+                stretch[k] = rotation.col(k).cwiseProduct(scale).norm();
+            }
+            const dReal radial = std::max(stretch[0], stretch[1]);
+            switch(proxy.type)
+            {
+            case PrimitiveFit::kSphere:
+                proxy.params[0] *= std::max(radial, stretch[2]);
+                dGeomSphereSetRadius(nGeom, proxy.params[0]);
+                break;
+            case PrimitiveFit::kCapsule:
+                proxy.params[0] *= radial;
+                proxy.params[1] *= stretch[2];
+                dGeomCapsuleSetParams(nGeom, proxy.params[0], proxy.params[1]);
+                break;
+            case PrimitiveFit::kBox:
+                for(int k=0; k<3; k++)
+                {
+                    proxy.params[k] *= stretch[k];
+                }
+                dGeomBoxSetLengths(nGeom, proxy.params[0], proxy.params[1], proxy.params[2]);
+                break;
+            case PrimitiveFit::kCylinder:
+                proxy.params[0] *= radial;
+                proxy.params[1] *= stretch[2];
+                dGeomCylinderSetParams(nGeom, proxy.params[0], proxy.params[1]);
+                break;
+            default:
+                return;
+            }
+            updateTransform();
+        }
+
         void Mesh::setSize(const utils::Vector &size)
         {
-            const dReal sx = size.x()/static_cast<double>(config["extend"]["x"]);
-            const dReal sy = size.y()/static_cast<double>(config["extend"]["y"]);
-            const dReal sz = size.z()/static_cast<double>(config["extend"]["z"]);
+            if(proxy.type == PrimitiveFit::kNone && (!completeGeom(true) || buildFailed))
+            {
+                return;
+            }
+            const dReal sx = size.x()/extend[0];
+            const dReal sy = size.y()/extend[1];
+            const dReal sz = size.z()/extend[2];
             //LOG_ERROR("%s (%lu): %g %g %g", name.c_str(), drawID, size.x(), size.y(), size.z());
+            if(proxy.type != PrimitiveFit::kNone)
+            {
+                scaleProxyGeom(Vector{sx, sy, sz});
+                if(graphics)
+                {
+                    graphics->lock();
+                    graphics->setDrawObjectScale(drawID, Vector{sx, sy, sz});
+                    graphics->unlock();
+                }
+                return;
+            }
 
-            for(unsigned long i=0; i<vertexcount; i++)
+            if(!singleVertices.empty())
+            {
+                for(unsigned long i=0; i<vertexcount; i++)
+                {
+                    singleVertices[i*3] *= sx;
+                    singleVertices[i*3+1] *= sy;
+                    singleVertices[i*3+2] *= sz;
+                }
+            }
+            else
+            {
+                for(unsigned long i=0; i<vertexcount; i++)
+                {
+                    myVertices[i][0] *= sx;
+                    myVertices[i][1] *= sy;
+                    myVertices[i][2] *= sz;
+                }
+            }
+            Distance::releaseTriMeshData(myTriMeshData);
+            buildOdeData();
+            for(auto &level : lodLevels)
             {
-                myVertices[i][0] *= sx;
-                myVertices[i][1] *= sy;
-                myVertices[i][2] *= sz;
+                Distance::releaseTriMeshData(level.data);
+                for(size_t i=0; i<level.vertices.size(); i+=4)
+                {
+                    level.vertices[i] *= sx;
+                    level.vertices[i+1] *= sy;
+                    level.vertices[i+2] *= sz;
+                }
+                dGeomTriMeshDataBuildSimple(level.data, level.vertices.data(), level.vertices.size()/4,
+                                            level.indices.data(), level.indices.size());
             }
-            dGeomTriMeshDataBuildSimple(myTriMeshData, reinterpret_cast<dReal*>(myVertices), vertexcount, myIndices, indexcount) ;
+            // cached contact state refers to the old triangles
+            dGeomTriMeshClearTCCache(nGeom);
             if(graphics)
             {
                 graphics->lock();
@@ -6,8 +6,16 @@
  */
 #pragma once
 #include "Object.hpp"
+#include "MeshCache.hpp"
+#include "MeshPreprocessor.hpp"
+#include "PrimitiveFit.hpp"
 #include <mars_interfaces/snmesh.h>
 
+#include <future>
+#include <memory>
+#include <set>
+#include <vector>
+
 namespace mars
 {
     namespace ode_collision
@@ -21,17 +29,95 @@ namespace mars
             static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap& config);
             void setMeshData(interfaces::snmesh& mesh);
             virtual bool createGeom() override;
-            virtual void setSize(const utils::Vector& size);
+            virtual bool completeGeom(bool wait) override;
+            virtual void setSize(const utils::Vector& size) override;
+            virtual void updateTransform(void) override;
+            virtual void getPosition(utils::Vector *pos) const override;
+            virtual void getRotation(utils::Quaternion *q) const override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+            virtual bool hasLevelOfDetail() const override;
+            virtual void updateLevelOfDetail(dReal distance) override;
+            virtual dGeomID selectPairGeom(dGeomID geom, const Object *other) const override;
+            // packs the vertices as float3 as expected by dGeomTriMeshDataBuildSingle,
+            // returns the largest rounding error
+            static dReal convertToSinglePrecision(const dVector3 *vertices, unsigned long count,
+                                                  std::vector<float> *result);
 
         protected:
+            void freeMemory();
+            void processMeshData();
+            // scale factors from the input mesh to the configured extend
+            void computeScale(dReal *scale, dReal *inputBounds);
+            // reads the config values used by computeCacheKey, getCacheFile and
+            // processMeshData, has to be called before them
+            void readBuildConfig();
+            uint64_t computeCacheKey();
+            // returns an empty string if caching is disabled
+            std::string getCacheFile(const std::string &prefix, uint64_t key);
+
             unsigned long vertexcount;
             unsigned long indexcount;
             dVector3* myVertices;
             dTriIndex* myIndices;
             dTriMeshDataID myTriMeshData;
-        
+            // local bounding box of the scaled mesh (min x, y, z, max x, y, z)
+            dReal bounds[6];
+            // content hash of the input mesh data and the parameters used
+            // to process it, used as key for the mesh cache
+            uint64_t meshKey;
+            // if loaded from cache myVertices and myIndices point into the mapped file
+            std::unique_ptr<MeshCache> cacheEntry;
+            // set while the trimesh data is prepared by the space's worker pool
+            std::future<void> buildResult;
+            // the worker threw, the object stays without geom
+            bool buildFailed;
+            // config values used while building the trimesh data, read in
+            // createGeom since the worker must not access the config map
+            dReal extend[3];
+            MeshPreprocessParams preprocessParams;
+            // empty if caching is disabled
+            std::string cachePath;
+            bool singlePrecision;
+            // negative if not configured
+            dReal singlePrecisionTolerance;
+            // primitive used instead of the trimesh if "proxy_fit" is enabled
+            // and the mesh is within the fit tolerance
+            PrimitiveFit proxy;
+            // packed float3 vertices if "single_precision" is set, myVertices is
+            // released after the conversion unless it points into the cache
+            std::vector<float> singleVertices;
+            // pose of the trimesh before the last updateTransform
+            dMatrix4 lastTransform;
+            bool lastTransformValid;
+
+            struct LevelOfDetail
+            {
+                // used if the closest movable object is farther away
+                dReal distance;
+                unsigned long maxTriangles;
+                // dVector3 layout
+                std::vector<dReal> vertices;
+                std::vector<dTriIndex> indices;
+                dTriMeshDataID data;
+            };
+            // decimated resolutions ordered by distance, the full resolution
+            // (myTriMeshData) is level 0
+            std::vector<LevelOfDetail> lodLevels;
+            size_t currentLevel;
+            // objects that always collide with the full resolution
+            std::set<std::string> fullResolutionObjects;
+            dGeomID fullResolutionGeom;
+
         private:
-            void freeMemory();
+            bool createProxyGeom();
+            void scaleProxyGeom(const utils::Vector &scale);
+            void buildTriMeshData();
+            void buildOdeData();
+            void buildLevelsOfDetail();
+            void setupTemporalCoherence();
+            void setTransformMatrix(dMatrix4 m) const;
+            bool loadFromCache(const std::string &file, uint64_t key);
+            void storeInCache(const std::string &file, uint64_t key) const;
         };
 
     } // end of namespace ode_collision
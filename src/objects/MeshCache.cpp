@@ -0,0 +1,234 @@
+#include "MeshCache.hpp"
+
+#include <mars_interfaces/Logging.hpp>
+#include <mars_utils/misc.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        namespace
+        {
+            const char kMagic[4] = {'M', 'O', 'C', 'C'};
+            const uint32_t kVersion = 1;
+            const uint64_t kAlignment = 16;
+
+            struct FileHeader
+            {
+                char magic[4];
+                uint32_t version;
+                uint64_t key;
+                uint32_t numSections;
+                uint32_t reserved;
+            };
+
+            struct SectionHeader
+            {
+                uint32_t id;
+                uint32_t elementSize;
+                uint64_t count;
+                uint64_t offset;
+            };
+
+            uint64_t align(uint64_t offset)
+            {
+                return (offset + kAlignment - 1) & ~(kAlignment - 1);
+            }
+        }
+
+        void MeshCache::Writer::addSection(uint32_t id, const void *data, uint32_t elementSize, uint64_t count)
+        {
+            sections.push_back(PendingSection{id, elementSize, count, data});
+        }
+
+        bool MeshCache::Writer::write(const std::string &file, uint64_t key) const
+        {
+            FileHeader header;
+            memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.key = key;
+            header.numSections = static_cast<uint32_t>(sections.size());
+            header.reserved = 0;
+
+            std::vector<SectionHeader> table;
+            uint64_t offset = align(sizeof(FileHeader) + sections.size()*sizeof(SectionHeader));
+            for(const auto &section : sections)
+            {
+                table.push_back(SectionHeader{section.id, section.elementSize, section.count, offset});
+                offset = align(offset + section.count*section.elementSize);
+            }
+
+            // write to a temporary file first and move it in place afterwards
+            // to never expose partially written entries to other processes
+            const std::string tmpFile = file + ".tmp" + std::to_string(getpid());
+            FILE *f = fopen(tmpFile.c_str(), "wb");
+            if(!f)
+            {
+                LOG_WARN("MeshCache: could not write cache file %s", tmpFile.c_str());
+                return false;
+            }
+            bool ok = fwrite(&header, sizeof(FileHeader), 1, f) == 1;
+            if(!table.empty())
+            {
+                ok &= fwrite(table.data(), sizeof(SectionHeader), table.size(), f) == table.size();
+            }
+            const char padding[kAlignment] = {0};
+            for(size_t i=0; ok && i<sections.size(); ++i)
+            {
+                const long pos = ftell(f);
+                ok &= fwrite(padding, 1, table[i].offset - pos, f) == table[i].offset - pos;
+                const uint64_t bytes = sections[i].count*sections[i].elementSize;
+                if(bytes > 0)
+                {
+                    ok &= fwrite(sections[i].data, 1, bytes, f) == bytes;
+                }
+            }
+            ok &= fclose(f) == 0;
+            if(!ok || rename(tmpFile.c_str(), file.c_str()) != 0)
+            {
+                LOG_WARN("MeshCache: failed to write cache file %s", file.c_str());
+                remove(tmpFile.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        MeshCache::MeshCache() : data{nullptr}, size{0}
+        {
+        }
+
+        MeshCache::~MeshCache()
+        {
+            close();
+        }
+
+        bool MeshCache::open(const std::string &file, uint64_t key)
+        {
+            close();
+            const int fd = ::open(file.c_str(), O_RDONLY);
+            if(fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader))
+            {
+                ::close(fd);
+                return false;
+            }
+            // private mapping: in place modifications are copy on write
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if(mapped == MAP_FAILED)
+            {
+                return false;
+            }
+            data = mapped;
+            size = st.st_size;
+
+            const auto *header = static_cast<const FileHeader*>(data);
+            if(memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+               header->version != kVersion || header->key != key ||
+               sizeof(FileHeader) + header->numSections*sizeof(SectionHeader) > size)
+            {
+                LOG_WARN("MeshCache: ignore invalid or outdated cache file %s", file.c_str());
+                close();
+                return false;
+            }
+            const auto *table = reinterpret_cast<const SectionHeader*>(header + 1);
+            for(uint32_t i=0; i<header->numSections; ++i)
+            {
+                if(table[i].offset + table[i].count*table[i].elementSize > size)
+                {
+                    LOG_WARN("MeshCache: ignore truncated cache file %s", file.c_str());
+                    close();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void MeshCache::close()
+        {
+            if(data)
+            {
+                munmap(data, size);
+                data = nullptr;
+                size = 0;
+            }
+        }
+
+        void* MeshCache::getSection(uint32_t id, uint32_t elementSize, uint64_t *count) const
+        {
+            if(!data)
+            {
+                return nullptr;
+            }
+            const auto *header = static_cast<const FileHeader*>(data);
+            const auto *table = reinterpret_cast<const SectionHeader*>(header + 1);
+            for(uint32_t i=0; i<header->numSections; ++i)
+            {
+                if(table[i].id == id)
+                {
+                    if(table[i].elementSize != elementSize)
+                    {
+                        return nullptr;
+                    }
+                    if(count)
+                    {
+                        *count = table[i].count;
+                    }
+                    return static_cast<char*>(data) + table[i].offset;
+                }
+            }
+            return nullptr;
+        }
+
+        uint64_t MeshCache::hash(const void *data, size_t size, uint64_t seed)
+        {
+            const auto *bytes = static_cast<const unsigned char*>(data);
+            uint64_t h = seed;
+            for(size_t i=0; i<size; ++i)
+            {
+                h ^= bytes[i];
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        std::string MeshCache::defaultCachePath()
+        {
+            const char *xdgCache = getenv("XDG_CACHE_HOME");
+            if(xdgCache && xdgCache[0])
+            {
+                return utils::pathJoin(xdgCache, "mars_ode_collision");
+            }
+            const char *home = getenv("HOME");
+            if(home && home[0])
+            {
+                return utils::pathJoin(home, ".cache/mars_ode_collision");
+            }
+            return "/tmp/mars_ode_collision";
+        }
+
+        std::string MeshCache::entryPath(const std::string &cachePath, const std::string &prefix, uint64_t key)
+        {
+            std::stringstream fileName;
+            fileName << prefix << "_" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+            return utils::pathJoin(cachePath, fileName.str());
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,94 @@
+ /**
+ * \file MeshCache.hpp
+ * \brief "MeshCache" implements a binary, memory mapped on-disk cache for
+ *        processed collision data (e.g. scaled trimesh vertices and indices).
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * A cache entry is a single file named by its content key. The file
+         * starts with a fixed header followed by a table of sections. Each
+         * section payload is 16 byte aligned so that it can be used directly
+         * from the mapped memory (e.g. as dVector3 array for ODE).
+         *
+         * The file is mapped private and writable, thus the data can be
+         * modified in place (e.g. by Mesh::setSize) without touching the
+         * file on disk.
+         */
+        class MeshCache
+        {
+        public:
+            enum SectionID : uint32_t
+            {
+                kVertices = 1,
+                kIndices = 2,
+                kBounds = 3,
+                // convex hulls: numPoints, numPlanes, numPolygonIndices per hull
+                kHullInfo = 4,
+                kHullPoints = 5,
+                kHullPlanes = 6,
+                kHullPolygons = 7,
+                // distance fields: origin x, y, z, cell size, dims x, y, z
+                kFieldInfo = 8,
+                kFieldValues = 9,
+            };
+
+            class Writer
+            {
+            public:
+                void addSection(uint32_t id, const void *data, uint32_t elementSize, uint64_t count);
+                bool write(const std::string &file, uint64_t key) const;
+
+            private:
+                struct PendingSection
+                {
+                    uint32_t id;
+                    uint32_t elementSize;
+                    uint64_t count;
+                    const void *data;
+                };
+                std::vector<PendingSection> sections;
+            };
+
+            MeshCache();
+            ~MeshCache();
+            MeshCache(const MeshCache&) = delete;
+            MeshCache& operator=(const MeshCache&) = delete;
+
+            bool open(const std::string &file, uint64_t key);
+            void close();
+            bool isOpen() const
+            {
+                return data != nullptr;
+            }
+
+            void* getSection(uint32_t id, uint32_t elementSize, uint64_t *count) const;
+            template<typename T> T* getSection(uint32_t id, uint64_t *count) const
+            {
+                return static_cast<T*>(getSection(id, sizeof(T), count));
+            }
+
+            // FNV-1a, can be chained by passing the last result as seed
+            static uint64_t hash(const void *data, size_t size, uint64_t seed=14695981039346656037ULL);
+            static std::string defaultCachePath();
+            static std::string entryPath(const std::string &cachePath, const std::string &prefix, uint64_t key);
+
+        private:
+            void *data;
+            size_t size;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,318 @@
+#include "MeshPreprocessor.hpp"
+
+#include <mars_interfaces/Logging.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        namespace
+        {
+            // relative to the squared bounding box diagonal
+            const dReal kDegenerateEpsilon = 1e-10;
+
+            typedef std::array<int64_t, 3> Cell;
+
+            struct CellHash
+            {
+                size_t operator()(const Cell &cell) const
+                {
+                    return (static_cast<uint64_t>(cell[0])*73856093ULL) ^
+                           (static_cast<uint64_t>(cell[1])*19349663ULL) ^
+                           (static_cast<uint64_t>(cell[2])*83492791ULL);
+                }
+            };
+
+            Cell cellOf(const dReal *p, dReal cellSize)
+            {
+                return Cell{static_cast<int64_t>(std::floor(p[0]/cellSize)),
+                            static_cast<int64_t>(std::floor(p[1]/cellSize)),
+                            static_cast<int64_t>(std::floor(p[2]/cellSize))};
+            }
+        }
+
+        MeshPreprocessParams MeshPreprocessParams::fromConfig(configmaps::ConfigMap &config)
+        {
+            MeshPreprocessParams params;
+            if(!config.hasKey("preprocess"))
+            {
+                return params;
+            }
+            configmaps::ConfigMap &preprocess = config["preprocess"];
+            if(preprocess.hasKey("weld_tolerance"))
+            {
+                params.weldTolerance = preprocess["weld_tolerance"];
+            }
+            if(preprocess.hasKey("remove_degenerate"))
+            {
+                params.removeDegenerate = preprocess["remove_degenerate"];
+            }
+            if(preprocess.hasKey("max_triangles"))
+            {
+                params.maxTriangles = static_cast<int>(preprocess["max_triangles"]);
+            }
+            return params;
+        }
+
+        MeshPreprocessor::MeshPreprocessor(std::vector<dReal> &vertices, std::vector<dTriIndex> &indices) :
+            vertices(vertices), indices(indices)
+        {
+        }
+
+        void MeshPreprocessor::process(const MeshPreprocessParams &params)
+        {
+            if(params.weldTolerance >= 0.0)
+            {
+                weldVertices(params.weldTolerance);
+            }
+            if(params.removeDegenerate || params.weldTolerance >= 0.0)
+            {
+                removeDegenerateTriangles();
+            }
+            if(params.maxTriangles > 0)
+            {
+                decimate(params.maxTriangles);
+            }
+            compactVertices();
+        }
+
+        void MeshPreprocessor::weldVertices(double tolerance)
+        {
+            const size_t numVertices = vertices.size()/3;
+            const dReal cellSize = tolerance > 0.0 ? tolerance : 1e-9;
+            const dReal tolerance2 = tolerance*tolerance;
+            std::unordered_map<Cell, std::vector<dTriIndex>, CellHash> grid;
+            std::vector<dTriIndex> remap(numVertices);
+            std::vector<dReal> welded;
+            welded.reserve(vertices.size());
+
+            for(size_t i=0; i<numVertices; ++i)
+            {
+                const dReal *p = &vertices[i*3];
+                const Cell cell = cellOf(p, cellSize);
+                bool found = false;
+                for(int64_t dx=-1; dx<=1 && !found; ++dx)
+                {
+                    for(int64_t dy=-1; dy<=1 && !found; ++dy)
+                    {
+                        for(int64_t dz=-1; dz<=1 && !found; ++dz)
+                        {
+                            const auto neighbour = grid.find(Cell{cell[0]+dx, cell[1]+dy, cell[2]+dz});
+                            if(neighbour == grid.end())
+                            {
+                                continue;
+                            }
+                            for(const auto &candidate : neighbour->second)
+                            {
+                                const dReal *q = &welded[candidate*3];
+                                const dReal d0 = p[0]-q[0], d1 = p[1]-q[1], d2 = p[2]-q[2];
+                                if(d0*d0 + d1*d1 + d2*d2 <= tolerance2)
+                                {
+                                    remap[i] = candidate;
+                                    found = true;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                }
+                if(!found)
+                {
+                    const dTriIndex newIndex = static_cast<dTriIndex>(welded.size()/3);
+                    welded.insert(welded.end(), p, p+3);
+                    grid[cell].push_back(newIndex);
+                    remap[i] = newIndex;
+                }
+            }
+            for(auto &index : indices)
+            {
+                index = remap[index];
+            }
+            vertices.swap(welded);
+        }
+
+        bool MeshPreprocessor::isDegenerate(size_t triangle, dReal minArea2) const
+        {
+            const dTriIndex a = indices[triangle*3];
+            const dTriIndex b = indices[triangle*3+1];
+            const dTriIndex c = indices[triangle*3+2];
+            if(a == b || b == c || a == c)
+            {
+                return true;
+            }
+            const dReal *pa = &vertices[a*3];
+            const dReal *pb = &vertices[b*3];
+            const dReal *pc = &vertices[c*3];
+            const dReal u[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]};
+            const dReal v[3] = {pc[0]-pa[0], pc[1]-pa[1], pc[2]-pa[2]};
+            const dReal n[3] = {u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0]};
+            return n[0]*n[0] + n[1]*n[1] + n[2]*n[2] <= minArea2;
+        }
+
+        void MeshPreprocessor::removeDegenerateTriangles()
+        {
+            dReal min[3] = {std::numeric_limits<dReal>::max(), std::numeric_limits<dReal>::max(), std::numeric_limits<dReal>::max()};
+            dReal max[3] = {std::numeric_limits<dReal>::lowest(), std::numeric_limits<dReal>::lowest(), std::numeric_limits<dReal>::lowest()};
+            for(size_t i=0; i<vertices.size(); ++i)
+            {
+                min[i%3] = std::min(min[i%3], vertices[i]);
+                max[i%3] = std::max(max[i%3], vertices[i]);
+            }
+            dReal diag2 = 0.0;
+            for(int k=0; k<3 && !vertices.empty(); ++k)
+            {
+                diag2 += (max[k]-min[k])*(max[k]-min[k]);
+            }
+            const dReal minArea2 = (kDegenerateEpsilon*diag2)*(kDegenerateEpsilon*diag2);
+
+            std::set<std::array<dTriIndex, 3>> unique;
+            size_t numTriangles = 0;
+            for(size_t t=0; t<indices.size()/3; ++t)
+            {
+                if(isDegenerate(t, minArea2))
+                {
+                    continue;
+                }
+                // drop duplicated triangles (independent of the winding)
+                std::array<dTriIndex, 3> key = {indices[t*3], indices[t*3+1], indices[t*3+2]};
+                std::sort(key.begin(), key.end());
+                if(!unique.insert(key).second)
+                {
+                    continue;
+                }
+                std::copy(indices.begin()+t*3, indices.begin()+t*3+3, indices.begin()+numTriangles*3);
+                ++numTriangles;
+            }
+            indices.resize(numTriangles*3);
+        }
+
+        void MeshPreprocessor::compactVertices()
+        {
+            const dTriIndex unused = std::numeric_limits<dTriIndex>::max();
+            std::vector<dTriIndex> remap(vertices.size()/3, unused);
+            std::vector<dReal> compacted;
+            compacted.reserve(vertices.size());
+            for(auto &index : indices)
+            {
+                if(remap[index] == unused)
+                {
+                    remap[index] = static_cast<dTriIndex>(compacted.size()/3);
+                    compacted.insert(compacted.end(), &vertices[index*3], &vertices[index*3]+3);
+                }
+                index = remap[index];
+            }
+            vertices.swap(compacted);
+        }
+
+        dReal MeshPreprocessor::surfaceArea() const
+        {
+            dReal area = 0.0;
+            for(size_t t=0; t<indices.size()/3; ++t)
+            {
+                const dReal *pa = &vertices[indices[t*3]*3];
+                const dReal *pb = &vertices[indices[t*3+1]*3];
+                const dReal *pc = &vertices[indices[t*3+2]*3];
+                const dReal u[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]};
+                const dReal v[3] = {pc[0]-pa[0], pc[1]-pa[1], pc[2]-pa[2]};
+                const dReal n[3] = {u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0]};
+                area += 0.5*std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            }
+            return area;
+        }
+
+        void MeshPreprocessor::clusterVertices(dReal cellSize, bool average)
+        {
+            const size_t numVertices = vertices.size()/3;
+            std::unordered_map<Cell, dTriIndex, CellHash> cells;
+            std::vector<dTriIndex> remap(numVertices);
+            std::vector<dReal> clustered;
+            std::vector<unsigned long> clusterSize;
+            for(size_t i=0; i<numVertices; ++i)
+            {
+                const dReal *p = &vertices[i*3];
+                const Cell key = cellOf(p, cellSize);
+                const auto it = cells.find(key);
+                if(it == cells.end())
+                {
+                    const dTriIndex newIndex = static_cast<dTriIndex>(clusterSize.size());
+                    cells[key] = newIndex;
+                    clustered.insert(clustered.end(), p, p+3);
+                    clusterSize.push_back(1);
+                    remap[i] = newIndex;
+                }
+                else
+                {
+                    remap[i] = it->second;
+                    if(average)
+                    {
+                        for(int k=0; k<3; ++k)
+                        {
+                            clustered[it->second*3+k] += p[k];
+                        }
+                        ++clusterSize[it->second];
+                    }
+                }
+            }
+            for(size_t c=0; c<clusterSize.size(); ++c)
+            {
+                for(int k=0; k<3; ++k)
+                {
+                    clustered[c*3+k] /= clusterSize[c];
+                }
+            }
+            for(auto &index : indices)
+            {
+                index = remap[index];
+            }
+            vertices.swap(clustered);
+        }
+
+        void MeshPreprocessor::decimate(unsigned long maxTriangles)
+        {
+            if(indices.size()/3 <= maxTriangles)
+            {
+                return;
+            }
+            const std::vector<dReal> originalVertices = vertices;
+            const std::vector<dTriIndex> originalIndices = indices;
+            const size_t numTrianglesIn = indices.size()/3;
+
+            // a uniformly clustered surface has about two triangles per cell face
+            dReal cellSize = std::sqrt(2.0*surfaceArea()/maxTriangles);
+            if(!(cellSize > 0.0))
+            {
+                return;
+            }
+            const int maxIterations = 32;
+            for(int iteration=0; iteration<maxIterations; ++iteration)
+            {
+                clusterVertices(cellSize, true);
+                removeDegenerateTriangles();
+                if(indices.size()/3 <= maxTriangles)
+                {
+                    LOG_INFO("ode_collision::MeshPreprocessor: decimated mesh from %lu to %lu triangles (cell size %g)",
+                             static_cast<unsigned long>(numTrianglesIn), static_cast<unsigned long>(indices.size()/3), cellSize);
+                    return;
+                }
+                if(iteration+1 < maxIterations)
+                {
+                    vertices = originalVertices;
+                    indices = originalIndices;
+                    cellSize *= 1.25;
+                }
+            }
+            // keep the coarsest clustering, it is the closest to the budget
+            LOG_WARN("ode_collision::MeshPreprocessor: missed the budget of %lu triangles, decimated mesh from %lu to %lu triangles (cell size %g)",
+                     maxTriangles, static_cast<unsigned long>(numTrianglesIn), static_cast<unsigned long>(indices.size()/3), cellSize);
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,65 @@
+ /**
+ * \file MeshPreprocessor.hpp
+ * \brief "MeshPreprocessor" prepares visual meshes for the use as collision
+ *        meshes (welding, degenerate triangle removal, compaction and decimation).
+ *
+ */
+
+#pragma once
+
+#include <ode/ode.h>
+#include <configmaps/ConfigMap.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        struct MeshPreprocessParams
+        {
+            // vertices closer than this distance are merged, negative disables welding
+            double weldTolerance = -1.0;
+            bool removeDegenerate = false;
+            // maximum number of triangles, 0 disables decimation
+            unsigned long maxTriangles = 0;
+
+            bool isEnabled() const
+            {
+                return weldTolerance >= 0.0 || removeDegenerate || maxTriangles > 0;
+            }
+            // reads the "preprocess" map of a mesh config
+            static MeshPreprocessParams fromConfig(configmaps::ConfigMap &config);
+        };
+
+        /**
+         * The mesh is given as flat vertex array (x, y, z per vertex) and
+         * triangle index array. All methods keep the arrays consistent.
+         */
+        class MeshPreprocessor
+        {
+        public:
+            MeshPreprocessor(std::vector<dReal> &vertices, std::vector<dTriIndex> &indices);
+
+            void process(const MeshPreprocessParams &params);
+            void weldVertices(double tolerance);
+            void removeDegenerateTriangles();
+            // removes unreferenced vertices and renumbers the indices
+            void compactVertices();
+            // vertex clustering on a uniform grid, the cell size is increased
+            // until the triangle budget is met
+            void decimate(unsigned long maxTriangles);
+
+        private:
+            void clusterVertices(dReal cellSize, bool average);
+            dReal surfaceArea() const;
+            bool isDegenerate(size_t triangle, dReal minArea2) const;
+
+            std::vector<dReal> &vertices;
+            std::vector<dTriIndex> &indices;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
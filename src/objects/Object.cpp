@@ -45,7 +45,12 @@ namespace mars
                                                         filter_depth{-1.0},
                                                         filter_angle{-1.0},
                                                         filter_radius{-1.0},
+                                                        contact_reduction{0},
+                                                        contact_priority{0},
                                                         filter_sphere{0.0, 0.0, 0.0},
+                                                        ccd{false},
+                                                        previousPoseValid{false},
+                                                        nGeom{nullptr},
                                                         config(config)
         {
             this->space = dynamic_cast<CollisionSpace*>(space);
@@ -69,6 +74,9 @@ namespace mars
             GET_VALUE("rolling_friction", c_params.rolling_friction, Double);
             GET_VALUE("rolling_friction2", c_params.rolling_friction2, Double);
             GET_VALUE("spinning_friction", c_params.spinning_friction, Double);
+            GET_VALUE("ccd", ccd, Bool);
+            GET_VALUE("contact_reduction", contact_reduction, Int);
+            GET_VALUE("contact_priority", contact_priority, Int);
 
             if((it = config.find("cfdir1")) != config.end())
             {
@@ -109,6 +117,11 @@ namespace mars
             // TODO: position is defined by frame position
             // local position and rotation should store offsets
             //MutexLocker locker(&(theWorld->iMutex));
+            if(!nGeom)
+            {
+                *pos = this->pos;
+                return;
+            }
             const dReal *dPos = dGeomGetPosition(nGeom);
             pos->x() = dPos[0];
             pos->y() = dPos[1];
@@ -158,6 +171,11 @@ namespace mars
         void Object::getRotation(Quaternion* q) const
         {
             // TODO: see above
+            if(!nGeom)
+            {
+                *q = this->q;
+                return;
+            }
             dQuaternion dQ;
             dGeomGetQuaternion(nGeom, dQ);
             q->w() = dQ[0];
@@ -179,37 +197,66 @@ namespace mars
             this->q = q;
         }
 
-        // TODO: change name to updateAbsTransform
-        void Object::updateTransform(void)
+        void Object::getGlobalTransform(Vector *globalPos, Quaternion *globalQ) const
         {
             // local transform is relative to parent frame
-            //fprintf(stderr, "update collision of ");
             if(auto dynamicObjectShared = dynamicObject.lock())
             {
-                //fprintf(stderr, "  %s\n", movable->getName().c_str());
                 Vector framePos;
                 Quaternion frameQ;
                 dynamicObjectShared->getPosition(&framePos);
                 dynamicObjectShared->getRotation(&frameQ);
-
-                framePos += frameQ*pos;
-                // TODO: dGeom set position
-                dGeomSetPosition(nGeom, (dReal)framePos.x(),
-                                 (dReal)framePos.y(), (dReal)framePos.z());
-                //fprintf(stderr, " %g %g %g - ", framePos.x(), framePos.y(), framePos.z());
-                frameQ = frameQ*q;
-                dQuaternion dQ = {frameQ.w(), frameQ.x(), frameQ.y(), frameQ.z()};
-                dGeomSetQuaternion(nGeom, dQ);
-                //fprintf(stderr, " %g %g %g %g\n", frameQ.w(), frameQ.x(), frameQ.y(), frameQ.z());
+                *globalPos = framePos + frameQ*pos;
+                *globalQ = frameQ*q;
             }
             else
             {
-                //fprintf(stderr, "static\n");
-                dGeomSetPosition(nGeom, (dReal)pos.x(),
-                                 (dReal)pos.y(), (dReal)pos.z());
-                dQuaternion dQ = {q.w(), q.x(), q.y(), q.z()};
-                dGeomSetQuaternion(nGeom, dQ);
+                *globalPos = pos;
+                *globalQ = q;
+            }
+        }
+
+        // TODO: change name to updateAbsTransform
+        void Object::updateTransform(void)
+        {
+            if(!nGeom)
+            {
+                // geom is not created yet
+                return;
+            }
+            Vector globalPos;
+            Quaternion globalQ;
+            getGlobalTransform(&globalPos, &globalQ);
+            dGeomSetPosition(nGeom, (dReal)globalPos.x(),
+                             (dReal)globalPos.y(), (dReal)globalPos.z());
+            dQuaternion dQ = {globalQ.w(), globalQ.x(), globalQ.y(), globalQ.z()};
+            dGeomSetQuaternion(nGeom, dQ);
+        }
+
+        void Object::storePreviousPose()
+        {
+            if(!nGeom || dGeomIsSpace(nGeom) || !dGeomIsEnabled(nGeom) || dGeomGetClass(nGeom) == dPlaneClass)
+            {
+                previousPoseValid = false;
+                return;
+            }
+            const dReal *dPos = dGeomGetPosition(nGeom);
+            previousPos = Vector(dPos[0], dPos[1], dPos[2]);
+            dQuaternion dQ;
+            dGeomGetQuaternion(nGeom, dQ);
+            previousQ = Quaternion(dQ[0], dQ[1], dQ[2], dQ[3]);
+            previousPoseValid = true;
+        }
+
+        bool Object::getPreviousPose(Vector *pos, Quaternion *q) const
+        {
+            if(!previousPoseValid)
+            {
+                return false;
             }
+            *pos = previousPos;
+            *q = previousQ;
+            return true;
         }
 
         interfaces::ContactMaterial Object::getMaterialAt(const utils::Vector& pos) const
@@ -240,6 +287,9 @@ namespace mars
             result["static"] = !movable;
             result["position (local)"] = utils::vectorToConfigItem(pos);
             result["rotation (local)"] = utils::quaternionToConfigItem(q);
+            result["ccd"] = ccd;
+            result["contact_reduction"] = contact_reduction;
+            result["contact_priority"] = contact_priority;
             {
                 configmaps::ConfigMap filterMap;
                 filterMap["depth"] = filter_depth;
@@ -34,25 +34,90 @@ namespace mars
                    configmaps::ConfigMap &config);
             virtual ~Object(void);
 
-            void getPosition(utils::Vector *pos) const;
+            virtual void getPosition(utils::Vector *pos) const;
             void setPosition(const utils::Vector &pos);
             virtual void getRotation(utils::Quaternion *q) const;
             void setRotation(const utils::Quaternion &q);
 
             virtual void setSize(const utils::Vector &size);
             virtual bool createGeom() = 0;
+            /**
+             * Objects that prepare their collision data in the background
+             * (see CollisionSpace::addPendingObject) insert their geom into the
+             * space in this method. Returns false if the data is not ready yet
+             * and wait is not set.
+             */
+            virtual bool completeGeom(bool wait)
+            {
+                return true;
+            }
             virtual void updateTransform(void);
+            /**
+             * Objects with several collision resolutions switch them based on the
+             * distance to the closest movable object (see CollisionSpace::updateTransforms).
+             */
+            virtual bool hasLevelOfDetail() const
+            {
+                return false;
+            }
+            virtual void updateLevelOfDetail(dReal distance)
+            {
+            }
+            /**
+             * Returns the geom that is used to collide with the other object.
+             * Objects can provide a different representation for specific
+             * pairs (e.g. the full resolution of a mesh with level of detail).
+             */
+            virtual dGeomID selectPairGeom(dGeomID geom, const Object *other) const
+            {
+                return geom;
+            }
+            /**
+             * Returns the hull points (local x, y, z triples) of a dConvex geom of
+             * this object, ode has no accessor for them. Used by the distance
+             * queries.
+             */
+            virtual const std::vector<dReal>* getConvexPoints(dGeomID geom) const
+            {
+                return nullptr;
+            }
             virtual interfaces::ContactMaterial getMaterialAt(const utils::Vector& pos) const;
 
+            /**
+             * Objects with continuous collision detection (config "ccd") are
+             * additionally swept from their pose of the previous step to the
+             * current one (see CollisionSpace::generateContacts). Only objects
+             * with a single placeable geom are swept.
+             */
+            bool hasContinuousCollision() const
+            {
+                return ccd;
+            }
+            // called before the transform of the step is applied
+            void storePreviousPose();
+            bool getPreviousPose(utils::Vector *pos, utils::Quaternion *q) const;
+
             bool isObjectCreated()
             {
                 return objectCreated;
             }
             std::shared_ptr<interfaces::DynamicObject> getMovable() const;
+            dGeomID getGeom() const
+            {
+                return nGeom;
+            }
             const std::string& getName() const;
+            CollisionSpace* getCollisionSpace() const
+            {
+                return space;
+            }
 
             interfaces::contact_params c_params;
             double filter_depth, filter_angle, filter_radius;
+            // maximum number of contacts kept per pair after reduction, <= 0 keeps all
+            int contact_reduction;
+            // pairs of objects with higher priority are collided first in budget mode
+            int contact_priority;
             utils::Vector filter_sphere;
             // TODO: find a clean solution for debug drawings
             unsigned long drawID;
@@ -64,12 +129,19 @@ namespace mars
             virtual void edit(const std::string& configPath, const std::string& value) override;
 
         protected:
+            // returns the global pose of the object (frame transformation applied)
+            void getGlobalTransform(utils::Vector *globalPos, utils::Quaternion *globalQ) const;
+
             // transform is always relative to frame transformation
             bool movable;
             std::weak_ptr<interfaces::DynamicObject> dynamicObject;
             utils::Vector pos;
             utils::Quaternion q;
             bool objectCreated;
+            bool ccd;
+            bool previousPoseValid;
+            utils::Vector previousPos;
+            utils::Quaternion previousQ;
             dGeomID nGeom;
             CollisionSpace *space;
             std::string name;
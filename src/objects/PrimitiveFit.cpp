@@ -0,0 +1,273 @@
+#include "PrimitiveFit.hpp"
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+
+        namespace
+        {
+            const dReal kPi = 3.14159265358979323846;
+
+            struct FitFrame
+            {
+                Matrix axes; // columns are the frame axes in mesh coordinates
+                Vector center;
+                Vector halfExtent;
+            };
+
+            dReal meshVolume(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices)
+            {
+                dReal volume = 0.0;
+                for(size_t t=0; t+2<indices.size(); t+=3)
+                {
+                    const Vector a(&vertices[indices[t]*3]);
+                    const Vector b(&vertices[indices[t+1]*3]);
+                    const Vector c(&vertices[indices[t+2]*3]);
+                    volume += a.dot(b.cross(c))/6.0;
+                }
+                return std::fabs(volume);
+            }
+
+            FitFrame makeFrame(const std::vector<Vector> &samples, const Matrix &axes)
+            {
+                FitFrame frame;
+                frame.axes = axes;
+                Vector min = Vector::Constant(std::numeric_limits<dReal>::max());
+                Vector max = Vector::Constant(std::numeric_limits<dReal>::lowest());
+                for(const auto &sample : samples)
+                {
+                    const Vector local = axes.transpose()*sample;
+                    min = min.cwiseMin(local);
+                    max = max.cwiseMax(local);
+                }
+                frame.center = axes*((min + max)*0.5);
+                frame.halfExtent = (max - min)*0.5;
+                return frame;
+            }
+
+            // distance of the sample to the surface of the primitive given in frame coordinates
+            dReal surfaceDistance(PrimitiveFit::Type type, const dReal *params, int axis, const Vector &local)
+            {
+                switch(type)
+                {
+                case PrimitiveFit::kSphere:
+                    return std::fabs(local.norm() - params[0]);
+                case PrimitiveFit::kBox:
+                {
+                    const Vector d = local.cwiseAbs() - Vector(params[0], params[1], params[2])*0.5;
+                    if(d.maxCoeff() <= 0.0)
+                    {
+                        return -d.maxCoeff();
+                    }
+                    return d.cwiseMax(0.0).norm();
+                }
+                case PrimitiveFit::kCylinder:
+                case PrimitiveFit::kCapsule:
+                {
+                    const dReal h = local[axis];
+                    Vector radial = local;
+                    radial[axis] = 0.0;
+                    if(type == PrimitiveFit::kCapsule)
+                    {
+                        const dReal clamped = std::max(-params[1]*0.5, std::min(params[1]*0.5, h));
+                        return std::fabs(std::sqrt(radial.squaredNorm() + (h-clamped)*(h-clamped)) - params[0]);
+                    }
+                    const dReal dr = radial.norm() - params[0];
+                    const dReal dh = std::fabs(h) - params[1]*0.5;
+                    if(dr <= 0.0 && dh <= 0.0)
+                    {
+                        return -std::max(dr, dh);
+                    }
+                    return std::sqrt(std::max(dr, 0.0)*std::max(dr, 0.0) + std::max(dh, 0.0)*std::max(dh, 0.0));
+                }
+                default:
+                    return std::numeric_limits<dReal>::max();
+                }
+            }
+
+            dReal primitiveVolume(PrimitiveFit::Type type, const dReal *params)
+            {
+                switch(type)
+                {
+                case PrimitiveFit::kSphere:
+                    return 4.0/3.0*kPi*params[0]*params[0]*params[0];
+                case PrimitiveFit::kBox:
+                    return params[0]*params[1]*params[2];
+                case PrimitiveFit::kCylinder:
+                    return kPi*params[0]*params[0]*params[1];
+                case PrimitiveFit::kCapsule:
+                    return kPi*params[0]*params[0]*params[1] + 4.0/3.0*kPi*params[0]*params[0]*params[0];
+                default:
+                    return 0.0;
+                }
+            }
+        }
+
+        std::string PrimitiveFit::typeName(Type type)
+        {
+            switch(type)
+            {
+            case kSphere:
+                return "sphere";
+            case kCapsule:
+                return "capsule";
+            case kBox:
+                return "box";
+            case kCylinder:
+                return "cylinder";
+            default:
+                return "none";
+            }
+        }
+
+        PrimitiveFit PrimitiveFit::fit(const std::vector<dReal> &vertices,
+                                       const std::vector<dTriIndex> &indices)
+        {
+            PrimitiveFit best;
+            best.error = std::numeric_limits<dReal>::max();
+            if(vertices.size() < 12 || indices.size() < 12)
+            {
+                return best;
+            }
+
+            // surface samples: vertices, edge centers and triangle centers
+            std::vector<Vector> samples;
+            samples.reserve(vertices.size()/3 + indices.size()*4/3);
+            for(size_t i=0; i<vertices.size(); i+=3)
+            {
+                samples.emplace_back(vertices[i], vertices[i+1], vertices[i+2]);
+            }
+            for(size_t t=0; t+2<indices.size(); t+=3)
+            {
+                const Vector a(&vertices[indices[t]*3]);
+                const Vector b(&vertices[indices[t+1]*3]);
+                const Vector c(&vertices[indices[t+2]*3]);
+                samples.push_back((a+b)*0.5);
+                samples.push_back((b+c)*0.5);
+                samples.push_back((c+a)*0.5);
+                samples.push_back((a+b+c)/3.0);
+            }
+
+            // candidate frames: the mesh axes (CAD exports) and the principal
+            // axes of the surface; the covariance is integrated over the
+            // triangles so that it does not depend on the triangulation
+            Vector mean = Vector::Zero();
+            Matrix covariance = Matrix::Zero();
+            dReal area = 0.0;
+            for(size_t t=0; t+2<indices.size(); t+=3)
+            {
+                const Vector a(&vertices[indices[t]*3]);
+                const Vector b(&vertices[indices[t+1]*3]);
+                const Vector c(&vertices[indices[t+2]*3]);
+                const dReal triangleArea = 0.5*(b-a).cross(c-a).norm();
+                const Vector centroid = (a+b+c)/3.0;
+                mean += triangleArea*centroid;
+                covariance += triangleArea/12.0*(9.0*centroid*centroid.transpose() + a*a.transpose() +
+                                                 b*b.transpose() + c*c.transpose());
+                area += triangleArea;
+            }
+            if(!(area > 0.0))
+            {
+                return best;
+            }
+            mean /= area;
+            covariance = covariance/area - mean*mean.transpose();
+            Eigen::SelfAdjointEigenSolver<Matrix> solver(covariance);
+            Matrix principal = solver.eigenvectors();
+            if(principal.determinant() < 0.0)
+            {
+                principal.col(2) *= -1.0;
+            }
+            const FitFrame frames[2] = {makeFrame(samples, Matrix::Identity()), makeFrame(samples, principal)};
+            const dReal size = frames[0].halfExtent.maxCoeff()*2.0;
+            if(!(size > 0.0))
+            {
+                return best;
+            }
+            const dReal volume = meshVolume(vertices, indices);
+
+            for(const auto &frame : frames)
+            {
+                for(int t=kSphere; t<=kCylinder; ++t)
+                {
+                    const Type type = static_cast<Type>(t);
+                    // cylinder and capsule are tested with each frame axis as main axis
+                    const int numAxes = (type == kCapsule || type == kCylinder) ? 3 : 1;
+                    for(int axis=0; axis<numAxes; ++axis)
+                    {
+                        PrimitiveFit candidate;
+                        candidate.type = type;
+                        const Vector &e = frame.halfExtent;
+                        const int u = (axis+1)%3, v = (axis+2)%3;
+                        switch(type)
+                        {
+                        case kSphere:
+                            candidate.params[0] = e.maxCoeff();
+                            break;
+                        case kBox:
+                            candidate.params[0] = e.x()*2.0;
+                            candidate.params[1] = e.y()*2.0;
+                            candidate.params[2] = e.z()*2.0;
+                            break;
+                        case kCapsule:
+                            candidate.params[0] = std::max(e[u], e[v]);
+                            candidate.params[1] = std::max(0.0, e[axis]*2.0 - candidate.params[0]*2.0);
+                            break;
+                        case kCylinder:
+                            candidate.params[0] = std::max(e[u], e[v]);
+                            candidate.params[1] = e[axis]*2.0;
+                            break;
+                        default:
+                            break;
+                        }
+
+                        dReal maxDistance = 0.0;
+                        for(const auto &sample : samples)
+                        {
+                            const Vector local = frame.axes.transpose()*(sample - frame.center);
+                            maxDistance = std::max(maxDistance, surfaceDistance(type, candidate.params, axis, local));
+                            if(maxDistance/size >= best.error)
+                            {
+                                break;
+                            }
+                        }
+                        candidate.error = maxDistance/size;
+                        // closed meshes also have to match the volume of the primitive
+                        const dReal primitive = primitiveVolume(type, candidate.params);
+                        if(volume > 0.0 && primitive > 0.0)
+                        {
+                            candidate.error = std::max(candidate.error, std::fabs(1.0 - volume/primitive));
+                        }
+                        if(candidate.error >= best.error)
+                        {
+                            continue;
+                        }
+
+                        // ode capsules and cylinders are aligned with the local z axis
+                        Matrix rotation = frame.axes;
+                        if(numAxes == 3)
+                        {
+                            rotation.col(0) = frame.axes.col(u);
+                            rotation.col(1) = frame.axes.col(v);
+                            rotation.col(2) = frame.axes.col(axis);
+                        }
+                        candidate.center = frame.center;
+                        candidate.rotation = Quaternion(rotation);
+                        best = candidate;
+                    }
+                }
+            }
+            return best;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
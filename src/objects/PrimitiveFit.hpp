@@ -0,0 +1,55 @@
+ /**
+ * \file PrimitiveFit.hpp
+ * \brief "PrimitiveFit" fits box, sphere, capsule and cylinder primitives to
+ *        triangle meshes.
+ *
+ */
+
+#pragma once
+
+#include <mars_utils/Vector.h>
+#include <ode/ode.h>
+
+#include <string>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        struct PrimitiveFit
+        {
+            enum Type
+            {
+                kNone,
+                kSphere,
+                kCapsule,
+                kBox,
+                kCylinder,
+            };
+
+            Type type = kNone;
+            // box: lengths x, y, z; sphere: radius;
+            // capsule and cylinder: radius, length (along local z)
+            dReal params[3] = {0.0, 0.0, 0.0};
+            // pose of the primitive in the mesh frame
+            utils::Vector center = utils::Vector::Zero();
+            utils::Quaternion rotation = utils::Quaternion::Identity();
+            // largest distance of the mesh surface to the primitive surface
+            // relative to the size of the mesh
+            dReal error = 0.0;
+
+            static std::string typeName(Type type);
+
+            /**
+             * Fits all primitive types to the mesh and returns the best fit.
+             * The mesh is sampled at its vertices, edge centers and triangle
+             * centers; for closed meshes the volumes have to match, too.
+             */
+            static PrimitiveFit fit(const std::vector<dReal> &vertices,
+                                    const std::vector<dTriIndex> &indices);
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
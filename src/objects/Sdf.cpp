@@ -0,0 +1,362 @@
+#include "Sdf.hpp"
+#include "../AabbTree.hpp"
+#include "../UserGeomClass.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+        using namespace utils;
+        using namespace interfaces;
+        using namespace configmaps;
+
+        namespace
+        {
+            // number of points on each rim of a cylinder
+            const int kRimPoints = 8;
+            // upper bound for the points along the axis of a capsule
+            const int kMaxAxisPoints = 16;
+            // part of the cache key, increase if the field computation changes
+            const uint32_t kFieldVersion = 2;
+
+            Matrix getRotationMatrix(dGeomID geom)
+            {
+                const dReal *r = dGeomGetRotation(geom);
+                Matrix rotation;
+                rotation << r[0], r[1], r[2],
+                            r[4], r[5], r[6],
+                            r[8], r[9], r[10];
+                return rotation;
+            }
+
+            struct Candidate
+            {
+                Vector pos;
+                Vector normal;
+                dReal depth;
+            };
+        }
+
+        Sdf::Sdf(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, ConfigMap& config) :
+            Mesh(space, movable, config)
+        {
+            LOG_INFO("ode_collision: Sdf constructor.\n");
+        }
+
+        Sdf::~Sdf(void)
+        {
+        }
+
+        Object* Sdf::instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, ConfigMap& config)
+        {
+            return new Sdf{space, movable, config};
+        }
+
+        /**
+         * \brief Registers the sdf geom class with ode on first use.
+         */
+        int Sdf::getGeomClass()
+        {
+            static const int geomClass = UserGeomClass::create(sizeof(Sdf*), &Sdf::getCollider,
+                                                               &Sdf::computeAabb);
+            return geomClass;
+        }
+
+        dColliderFn* Sdf::getCollider(int geomClass)
+        {
+            return &Sdf::collide;
+        }
+
+        bool Sdf::createGeom()
+        {
+            assert(vertexcount > 0);
+
+            name << config["name"];
+            dReal cellSize = 0.05;
+            unsigned int padding = 3;
+            if(config.hasKey("sdf"))
+            {
+                if(config["sdf"].hasKey("cell_size"))
+                {
+                    cellSize = config["sdf"]["cell_size"];
+                }
+                if(config["sdf"].hasKey("padding"))
+                {
+                    padding = static_cast<int>(config["sdf"]["padding"]);
+                }
+            }
+            if(cellSize <= 0.0)
+            {
+                LOG_ERROR("ode_collision::Sdf: invalid cell size for %s", name.c_str());
+                return false;
+            }
+            readBuildConfig();
+            uint64_t key = computeCacheKey();
+            // fields of older versions used a different sign computation
+            key = MeshCache::hash(&kFieldVersion, sizeof(kFieldVersion), key);
+            key = MeshCache::hash(&cellSize, sizeof(cellSize), key);
+            key = MeshCache::hash(&padding, sizeof(padding), key);
+            const std::string cacheFile = getCacheFile("sdf", key);
+
+            if(cacheFile.empty() || !loadField(cacheFile, key))
+            {
+                processMeshData();
+                std::vector<dReal> vertices(vertexcount*3);
+                for(unsigned long i=0; i<vertexcount; i++)
+                {
+                    std::copy(myVertices[i], myVertices[i]+3, &vertices[i*3]);
+                }
+                const std::vector<dTriIndex> indices(myIndices, myIndices+indexcount);
+                if(!field.build(vertices, indices, cellSize, padding))
+                {
+                    LOG_ERROR("ode_collision::Sdf: could not compute the distance field for %s", name.c_str());
+                    return false;
+                }
+                if(!cacheFile.empty())
+                {
+                    storeField(cacheFile, key);
+                }
+            }
+            // the field is all we need from the mesh data
+            freeMemory();
+
+            nGeom = dCreateGeom(getGeomClass());
+            *static_cast<Sdf**>(dGeomGetClassData(nGeom)) = this;
+            dSpaceAdd(space->getSpace(), nGeom);
+            dGeomSetData(nGeom, this);
+            LOG_INFO("ode_collision::Sdf: created %s with %u x %u x %u cells", name.c_str(),
+                     field.dims[0], field.dims[1], field.dims[2]);
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        void Sdf::updateTransform(void)
+        {
+            // there is no trimesh geom to update
+            Object::updateTransform();
+        }
+
+        void Sdf::setSize(const utils::Vector &size)
+        {
+            // the mesh data is released after the field is computed, thus it
+            // can not be rebuilt at another scale
+            LOG_WARN("ode_collision::Sdf: %s can not be resized, it keeps colliding at its original size",
+                     name.c_str());
+        }
+
+        void Sdf::computeAabb(dGeomID geom, dReal aabb[6])
+        {
+            const Sdf *sdf = *static_cast<Sdf**>(dGeomGetClassData(geom));
+            const dReal *p = dGeomGetPosition(geom);
+            dReal bounds[6];
+            sdf->field.getBounds(bounds);
+            AabbTree::transform(bounds, Vector(p[0], p[1], p[2]), getRotationMatrix(geom), aabb);
+        }
+
+        /**
+         * \brief Generates the sample points of the supported primitives.
+         *
+         * A point with radius r is in contact if the distance of the field at
+         * the point is below r, thus spheres and capsules are exact up to the
+         * interpolation error while boxes and cylinders are approximated by
+         * their corners, edges and faces.
+         */
+        bool Sdf::getSamplePoints(dGeomID geom, dReal cellSize, std::vector<SamplePoint> *points)
+        {
+            points->clear();
+            switch(dGeomGetClass(geom))
+            {
+            case dSphereClass:
+                points->push_back({{0.0, 0.0, 0.0}, dGeomSphereGetRadius(geom)});
+                return true;
+            case dCapsuleClass:
+            {
+                dReal radius, length;
+                dGeomCapsuleGetParams(geom, &radius, &length);
+                // spheres along the axis, spaced by at most one cell
+                const int n = std::min(kMaxAxisPoints, std::max(1, static_cast<int>(std::ceil(length/cellSize))));
+                for(int i=0; i<=n; i++)
+                {
+                    points->push_back({{0.0, 0.0, length*(static_cast<dReal>(i)/n - 0.5)}, radius});
+                }
+                return true;
+            }
+            case dBoxClass:
+            {
+                dVector3 lengths;
+                dGeomBoxGetLengths(geom, lengths);
+                // corners, edge centers and face centers
+                for(int x=-1; x<=1; x++)
+                {
+                    for(int y=-1; y<=1; y++)
+                    {
+                        for(int z=-1; z<=1; z++)
+                        {
+                            if(x || y || z)
+                            {
+                                points->push_back({{0.5*x*lengths[0], 0.5*y*lengths[1], 0.5*z*lengths[2]}, 0.0});
+                            }
+                        }
+                    }
+                }
+                return true;
+            }
+            case dCylinderClass:
+            {
+                dReal radius, length;
+                dGeomCylinderGetParams(geom, &radius, &length);
+                for(int side=-1; side<=1; side+=2)
+                {
+                    const dReal z = 0.5*side*length;
+                    points->push_back({{0.0, 0.0, z}, 0.0});
+                    for(int i=0; i<kRimPoints; i++)
+                    {
+                        const dReal angle = 2.0*M_PI*i/kRimPoints;
+                        points->push_back({{radius*std::cos(angle), radius*std::sin(angle), z}, 0.0});
+                    }
+                }
+                for(int i=0; i<kRimPoints; i++)
+                {
+                    const dReal angle = 2.0*M_PI*i/kRimPoints;
+                    points->push_back({{radius*std::cos(angle), radius*std::sin(angle), 0.0}, 0.0});
+                }
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * \brief Collider of the sdf class, o1 is always the sdf.
+         */
+        int Sdf::collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip)
+        {
+            const Sdf *sdf = *static_cast<Sdf**>(dGeomGetClassData(o1));
+            const int maxContacts = flags & UserGeomClass::kNumContactsMask;
+            if(maxContacts < 1)
+            {
+                return 0;
+            }
+            // reused buffers, collisions may be checked from worker threads
+            thread_local std::vector<SamplePoint> points;
+            thread_local std::vector<Candidate> candidates;
+            if(!getSamplePoints(o2, sdf->field.cellSize, &points))
+            {
+                static std::atomic<bool> warned{false};
+                if(!warned.exchange(true))
+                {
+                    LOG_WARN("ode_collision::Sdf: %s does not collide with geoms of class %d, only spheres, capsules, boxes and cylinders are supported",
+                             sdf->name.c_str(), dGeomGetClass(o2));
+                }
+                return 0;
+            }
+
+            const dReal *p1 = dGeomGetPosition(o1);
+            const dReal *p2 = dGeomGetPosition(o2);
+            const Vector pos1(p1[0], p1[1], p1[2]), pos2(p2[0], p2[1], p2[2]);
+            const Matrix rotation1 = getRotationMatrix(o1);
+            // maps points of the other geom into the field coordinates
+            const Matrix rotation = rotation1.transpose()*getRotationMatrix(o2);
+            const Vector offset = rotation1.transpose()*(pos2 - pos1);
+
+            candidates.clear();
+            for(const auto &point : points)
+            {
+                const Vector local = rotation*Vector(point.pos[0], point.pos[1], point.pos[2]) + offset;
+                dReal distance, gradient[3];
+                if(!sdf->field.sample(local.data(), &distance, gradient))
+                {
+                    continue;
+                }
+                const dReal depth = point.radius - distance;
+                Vector normal(gradient[0], gradient[1], gradient[2]);
+                const dReal length = normal.norm();
+                if(depth <= 0.0 || length <= 0.0)
+                {
+                    continue;
+                }
+                normal /= length;
+                // the contact is placed on the surface of the field
+                const Vector surface = local - normal*distance;
+                // moving the field against its outward normal separates the geoms
+                candidates.push_back({rotation1*surface + pos1, -(rotation1*normal), depth});
+                if(flags & CONTACTS_UNIMPORTANT)
+                {
+                    break;
+                }
+            }
+
+            const int numContacts = std::min(maxContacts, static_cast<int>(candidates.size()));
+            std::partial_sort(candidates.begin(), candidates.begin()+numContacts, candidates.end(),
+                              [](const Candidate &a, const Candidate &b) {return a.depth > b.depth;});
+            for(int i=0; i<numContacts; i++)
+            {
+                dContactGeom *out = UserGeomClass::contactAt(contact, i, skip);
+                for(int k=0; k<3; k++)
+                {
+                    out->pos[k] = candidates[i].pos[k];
+                    out->normal[k] = candidates[i].normal[k];
+                }
+                out->depth = candidates[i].depth;
+                out->g1 = o1;
+                out->g2 = o2;
+                out->side1 = -1;
+                out->side2 = -1;
+            }
+            return numContacts;
+        }
+
+        bool Sdf::loadField(const std::string &file, uint64_t key)
+        {
+            MeshCache entry;
+            if(!entry.open(file, key))
+            {
+                return false;
+            }
+            uint64_t numInfo = 0, numValues = 0;
+            const auto *info = entry.getSection<dReal>(MeshCache::kFieldInfo, &numInfo);
+            const auto *values = entry.getSection<float>(MeshCache::kFieldValues, &numValues);
+            if(!info || !values || numInfo != 7)
+            {
+                LOG_WARN("ode_collision::Sdf: ignore incomplete cache file %s", file.c_str());
+                return false;
+            }
+            const uint32_t dims[3] = {static_cast<uint32_t>(info[4]), static_cast<uint32_t>(info[5]),
+                                      static_cast<uint32_t>(info[6])};
+            if(!field.assign(info, info[3], dims, values, numValues))
+            {
+                LOG_WARN("ode_collision::Sdf: ignore inconsistent cache file %s", file.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void Sdf::storeField(const std::string &file, uint64_t key) const
+        {
+            const dReal info[7] = {field.origin[0], field.origin[1], field.origin[2], field.cellSize,
+                                   static_cast<dReal>(field.dims[0]), static_cast<dReal>(field.dims[1]),
+                                   static_cast<dReal>(field.dims[2])};
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+            MeshCache::Writer writer;
+            writer.addSection(MeshCache::kFieldInfo, info, sizeof(dReal), 7);
+            writer.addSection(MeshCache::kFieldValues, field.values.data(), sizeof(float), field.values.size());
+            writer.write(file, key);
+        }
+
+        configmaps::ConfigMap Sdf::getConfigMap() const
+        {
+            configmaps::ConfigMap result = Object::getConfigMap();
+            result["cells"] = static_cast<int>(field.numValues());
+            return result;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,65 @@
+ /**
+ * \file Sdf.hpp
+ * \brief "Sdf" implements a static collision object represented by a signed
+ *        distance grid computed from mesh data.
+ *
+ */
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "DistanceField.hpp"
+
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The mesh data is set with setMeshData and processed like the data of a
+         * Mesh. On createGeom a dense distance grid is computed (or loaded from
+         * the mesh cache) and the mesh data is released. Only one geom of a user
+         * geom class is inserted into the space; its collider samples the grid
+         * at a fixed set of points of the other geom, which makes the contact
+         * generation independent of the triangle count. Spheres, capsules,
+         * boxes and cylinders are supported, other geoms (trimeshes, convex and
+         * user classes) do not collide with the field; this is logged once.
+         * The field is negative behind the triangles (see DistanceField). The
+         * object can not be resized since the mesh data is released.
+         */
+        class Sdf : public Mesh
+        {
+        public:
+            Sdf(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap& config);
+            virtual ~Sdf(void);
+            static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap& config);
+            virtual bool createGeom() override;
+            virtual void setSize(const utils::Vector& size) override;
+            virtual void updateTransform(void) override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+
+        private:
+            // sample point in local coordinates of the other geom
+            struct SamplePoint
+            {
+                dReal pos[3];
+                dReal radius;
+            };
+
+            static int getGeomClass();
+            static dColliderFn* getCollider(int geomClass);
+            static int collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip);
+            static void computeAabb(dGeomID geom, dReal aabb[6]);
+            // returns false for unsupported geom classes
+            static bool getSamplePoints(dGeomID geom, dReal cellSize, std::vector<SamplePoint> *points);
+
+            bool loadField(const std::string &file, uint64_t key);
+            void storeField(const std::string &file, uint64_t key) const;
+
+            DistanceField field;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,508 @@
+#include "VoxelGrid.hpp"
+#include "../AabbTree.hpp"
+#include "../UserGeomClass.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        using namespace utils;
+        using namespace interfaces;
+        using namespace configmaps;
+
+        namespace
+        {
+            // leaves hold 4x4x4 voxels
+            const uint32_t kLeafSize = 4;
+            // keeps the voxel coordinates within 32 bit
+            const unsigned int kMaxDepth = 14;
+        }
+
+        VoxelGrid::VoxelGrid(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config) :
+            Object(space, movable, config),
+            resolution{0.05},
+            depth{8},
+            size{kLeafSize << 8},
+            numOccupied{0},
+            boundsLo{1, 1, 1},
+            boundsHi{0, 0, 0},
+            prototype{nullptr},
+            globalPos{0.0, 0.0, 0.0},
+            globalQ{1.0, 0.0, 0.0, 0.0}
+        {
+            LOG_INFO("ode_collision: VoxelGrid constructor.\n");
+        }
+
+        VoxelGrid::~VoxelGrid(void)
+        {
+            if(prototype)
+            {
+                dGeomDestroy(prototype);
+            }
+        }
+
+        Object* VoxelGrid::instantiate(CollisionInterface* space, std::shared_ptr<DynamicObject> movable, ConfigMap &config)
+        {
+            VoxelGrid *grid = new VoxelGrid(space, movable, config);
+            grid->createGeom();
+            return grid;
+        }
+
+        /**
+         * \brief Registers the voxel grid geom class with ode on first use.
+         */
+        int VoxelGrid::getGeomClass()
+        {
+            static const int geomClass = UserGeomClass::create(sizeof(VoxelGrid*), &VoxelGrid::getCollider,
+                                                               &VoxelGrid::computeAabb);
+            return geomClass;
+        }
+
+        dColliderFn* VoxelGrid::getCollider(int geomClass)
+        {
+            return &VoxelGrid::collide;
+        }
+
+        bool VoxelGrid::createGeom()
+        {
+            name << config["name"];
+            if(config.hasKey("bitmask"))
+            {
+                c_params.coll_bitmask = config["bitmask"];
+            }
+            if(config.hasKey("resolution"))
+            {
+                resolution = config["resolution"];
+            }
+            if(config.hasKey("depth"))
+            {
+                depth = static_cast<int>(config["depth"]);
+            }
+            if(resolution <= 0.0 || depth < 1 || depth > kMaxDepth)
+            {
+                LOG_ERROR("ode_collision::VoxelGrid: invalid resolution or depth for %s", name.c_str());
+                return false;
+            }
+            size = kLeafSize << depth;
+            clear();
+
+            // the prototype is not inserted into a space
+            prototype = dCreateBox(0, resolution, resolution, resolution);
+            dGeomSetData(prototype, this);
+            if(!loadVoxels())
+            {
+                return false;
+            }
+            LOG_INFO("ode_collision::VoxelGrid: %s with %lu occupied voxels", name.c_str(),
+                     static_cast<unsigned long>(numOccupied));
+
+            nGeom = dCreateGeom(getGeomClass());
+            *static_cast<VoxelGrid**>(dGeomGetClassData(nGeom)) = this;
+            dSpaceAdd(space->getSpace(), nGeom);
+            dGeomSetData(nGeom, this);
+            objectCreated = true;
+            updateTransform();
+            return true;
+        }
+
+        bool VoxelGrid::loadVoxels()
+        {
+            std::vector<Vector> occupied;
+            if(config.hasKey("voxels_file"))
+            {
+                const std::string file = config["voxels_file"];
+                std::ifstream stream(file);
+                if(!stream)
+                {
+                    LOG_ERROR("ode_collision::VoxelGrid: could not open %s", file.c_str());
+                    return false;
+                }
+                Vector pos;
+                while(stream >> pos.x() >> pos.y() >> pos.z())
+                {
+                    occupied.push_back(pos);
+                }
+            }
+            if(config.hasKey("voxels"))
+            {
+                // voxel centers as x, y, z triples
+                ConfigVector &values = config["voxels"];
+                if(values.size() % 3)
+                {
+                    LOG_WARN("ode_collision::VoxelGrid: %s: ignore incomplete voxel at the end", name.c_str());
+                }
+                for(size_t i=0; i+2<values.size(); i+=3)
+                {
+                    occupied.emplace_back(static_cast<double>(values[i]), static_cast<double>(values[i+1]),
+                                          static_cast<double>(values[i+2]));
+                }
+            }
+            updateVoxels(occupied, {});
+            return true;
+        }
+
+        bool VoxelGrid::toVoxel(const Vector &pos, uint32_t *voxel) const
+        {
+            for(int k=0; k<3; k++)
+            {
+                const dReal v = pos[k]/resolution + 0.5*size;
+                if(!(v >= 0.0 && v < size))
+                {
+                    return false;
+                }
+                voxel[k] = static_cast<uint32_t>(v);
+            }
+            return true;
+        }
+
+        uint32_t VoxelGrid::allocateNode()
+        {
+            if(!freeNodes.empty())
+            {
+                const uint32_t node = freeNodes.back();
+                freeNodes.pop_back();
+                std::fill(nodes[node].children, nodes[node].children+8, 0);
+                return node;
+            }
+            nodes.push_back(Node{});
+            return nodes.size()-1;
+        }
+
+        uint32_t VoxelGrid::allocateLeaf()
+        {
+            if(!freeLeaves.empty())
+            {
+                const uint32_t leaf = freeLeaves.back();
+                freeLeaves.pop_back();
+                leaves[leaf] = 0;
+                return leaf;
+            }
+            leaves.push_back(0);
+            return leaves.size()-1;
+        }
+
+        /**
+         * \brief Sets the state of one voxel, returns true if it changed.
+         *
+         * Missing nodes are allocated on the way down; emptied leaves and
+         * nodes are released on the way back up.
+         */
+        bool VoxelGrid::changeVoxel(const uint32_t *voxel, bool occupied)
+        {
+            uint32_t pathNode[kMaxDepth], pathOctant[kMaxDepth];
+            uint32_t node = 0;
+            for(unsigned int level=0; level<depth; level++)
+            {
+                // side length of the child cubes is 2^shift
+                const unsigned int shift = depth - level + 1;
+                const uint32_t octant = ((voxel[0] >> shift) & 1) | (((voxel[1] >> shift) & 1) << 1) |
+                                        (((voxel[2] >> shift) & 1) << 2);
+                pathNode[level] = node;
+                pathOctant[level] = octant;
+                uint32_t child = nodes[node].children[octant];
+                if(!child)
+                {
+                    if(!occupied)
+                    {
+                        return false;
+                    }
+                    child = (level+1 == depth) ? allocateLeaf() : allocateNode();
+                    nodes[node].children[octant] = child;
+                }
+                node = child;
+            }
+
+            const uint64_t bit = 1ULL << ((voxel[0] & 3) | ((voxel[1] & 3) << 2) | ((voxel[2] & 3) << 4));
+            uint64_t &mask = leaves[node];
+            if(((mask & bit) != 0) == occupied)
+            {
+                return false;
+            }
+            if(occupied)
+            {
+                mask |= bit;
+                numOccupied++;
+                return true;
+            }
+            mask &= ~bit;
+            numOccupied--;
+            if(mask)
+            {
+                return true;
+            }
+            freeLeaves.push_back(node);
+            for(int level=depth-1; level>=0; level--)
+            {
+                Node &parent = nodes[pathNode[level]];
+                parent.children[pathOctant[level]] = 0;
+                if(level == 0 || std::any_of(parent.children, parent.children+8, [](uint32_t c) {return c != 0;}))
+                {
+                    break;
+                }
+                freeNodes.push_back(pathNode[level]);
+            }
+            return true;
+        }
+
+        bool VoxelGrid::setVoxel(const Vector &pos, bool occupied)
+        {
+            uint32_t voxel[3];
+            if(!toVoxel(pos, voxel))
+            {
+                return false;
+            }
+            if(changeVoxel(voxel, occupied))
+            {
+                updateBounds();
+            }
+            return true;
+        }
+
+        void VoxelGrid::updateVoxels(const std::vector<Vector> &occupied, const std::vector<Vector> &free)
+        {
+            bool changed = false;
+            uint32_t voxel[3];
+            for(const auto &pos : free)
+            {
+                if(toVoxel(pos, voxel))
+                {
+                    changed |= changeVoxel(voxel, false);
+                }
+            }
+            for(const auto &pos : occupied)
+            {
+                if(toVoxel(pos, voxel))
+                {
+                    changed |= changeVoxel(voxel, true);
+                }
+            }
+            if(changed)
+            {
+                updateBounds();
+            }
+        }
+
+        void VoxelGrid::clear()
+        {
+            // index 0 is the root node and an unused leaf, thus 0 marks empty children
+            nodes.assign(1, Node{});
+            leaves.assign(1, 0);
+            freeNodes.clear();
+            freeLeaves.clear();
+            numOccupied = 0;
+            updateBounds();
+        }
+
+        bool VoxelGrid::isOccupied(const Vector &pos) const
+        {
+            uint32_t voxel[3];
+            if(!toVoxel(pos, voxel))
+            {
+                return false;
+            }
+            bool occupied = false;
+            auto callback = [&](const uint32_t*) {occupied = true; return false;};
+            const uint32_t base[3] = {0, 0, 0};
+            queryNode(0, 0, base, voxel, voxel, callback);
+            return occupied;
+        }
+
+        void VoxelGrid::updateBounds()
+        {
+            for(int k=0; k<3; k++)
+            {
+                boundsLo[k] = size;
+                boundsHi[k] = 0;
+            }
+            if(numOccupied)
+            {
+                const uint32_t base[3] = {0, 0, 0};
+                updateNodeBounds(0, 0, base);
+            }
+            if(nGeom)
+            {
+                // setting the position again makes ode recompute the aabb
+                const dReal *p = dGeomGetPosition(nGeom);
+                dGeomSetPosition(nGeom, p[0], p[1], p[2]);
+            }
+        }
+
+        void VoxelGrid::updateNodeBounds(uint32_t node, unsigned int level, const uint32_t *base)
+        {
+            const uint32_t childSize = size >> (level+1);
+            for(uint32_t octant=0; octant<8; octant++)
+            {
+                const uint32_t child = nodes[node].children[octant];
+                if(!child)
+                {
+                    continue;
+                }
+                const uint32_t childBase[3] = {base[0] + (octant & 1)*childSize,
+                                               base[1] + ((octant >> 1) & 1)*childSize,
+                                               base[2] + ((octant >> 2) & 1)*childSize};
+                if(level+1 < depth)
+                {
+                    updateNodeBounds(child, level+1, childBase);
+                    continue;
+                }
+                // the bounds are kept on leaf granularity
+                for(int k=0; k<3; k++)
+                {
+                    boundsLo[k] = std::min(boundsLo[k], childBase[k]);
+                    boundsHi[k] = std::max(boundsHi[k], childBase[k]+kLeafSize-1);
+                }
+            }
+        }
+
+        template<typename Callback>
+        bool VoxelGrid::queryNode(uint32_t node, unsigned int level, const uint32_t *base,
+                                  const uint32_t *lo, const uint32_t *hi, Callback &callback) const
+        {
+            const uint32_t childSize = size >> (level+1);
+            for(uint32_t octant=0; octant<8; octant++)
+            {
+                const uint32_t child = nodes[node].children[octant];
+                if(!child)
+                {
+                    continue;
+                }
+                const uint32_t childBase[3] = {base[0] + (octant & 1)*childSize,
+                                               base[1] + ((octant >> 1) & 1)*childSize,
+                                               base[2] + ((octant >> 2) & 1)*childSize};
+                bool overlaps = true;
+                for(int k=0; k<3; k++)
+                {
+                    overlaps &= childBase[k] <= hi[k] && childBase[k]+childSize-1 >= lo[k];
+                }
+                if(!overlaps)
+                {
+                    continue;
+                }
+                if(level+1 < depth)
+                {
+                    if(!queryNode(child, level+1, childBase, lo, hi, callback))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                for(uint64_t mask=leaves[child]; mask; mask&=mask-1)
+                {
+                    const unsigned int bit = __builtin_ctzll(mask);
+                    const uint32_t voxel[3] = {childBase[0] + (bit & 3), childBase[1] + ((bit >> 2) & 3),
+                                               childBase[2] + (bit >> 4)};
+                    if(voxel[0] < lo[0] || voxel[0] > hi[0] || voxel[1] < lo[1] || voxel[1] > hi[1] ||
+                       voxel[2] < lo[2] || voxel[2] > hi[2])
+                    {
+                        continue;
+                    }
+                    if(!callback(voxel))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void VoxelGrid::updateTransform(void)
+        {
+            if(!nGeom)
+            {
+                return;
+            }
+            getGlobalTransform(&globalPos, &globalQ);
+            dGeomSetPosition(nGeom, globalPos.x(), globalPos.y(), globalPos.z());
+            dQuaternion dQ = {globalQ.w(), globalQ.x(), globalQ.y(), globalQ.z()};
+            dGeomSetQuaternion(nGeom, dQ);
+        }
+
+        void VoxelGrid::computeAabb(dGeomID geom, dReal aabb[6])
+        {
+            const VoxelGrid *grid = *static_cast<VoxelGrid**>(dGeomGetClassData(geom));
+            const dReal *p = dGeomGetPosition(geom);
+            if(grid->boundsLo[0] > grid->boundsHi[0])
+            {
+                aabb[0] = aabb[1] = p[0];
+                aabb[2] = aabb[3] = p[1];
+                aabb[4] = aabb[5] = p[2];
+                return;
+            }
+            dReal bounds[6];
+            for(int k=0; k<3; k++)
+            {
+                bounds[k*2] = (grid->boundsLo[k] - 0.5*grid->size)*grid->resolution;
+                bounds[k*2+1] = (grid->boundsHi[k] + 1 - 0.5*grid->size)*grid->resolution;
+            }
+            AabbTree::transform(bounds, Vector(p[0], p[1], p[2]), grid->globalQ.toRotationMatrix(), aabb);
+        }
+
+        /**
+         * \brief Collider of the voxel grid class, o1 is always the grid.
+         */
+        int VoxelGrid::collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip)
+        {
+            VoxelGrid *grid = *static_cast<VoxelGrid**>(dGeomGetClassData(o1));
+            const int maxContacts = flags & UserGeomClass::kNumContactsMask;
+            if(maxContacts < 1 || !grid->numOccupied)
+            {
+                return 0;
+            }
+
+            // voxel range overlapping the bounding box of the other geom
+            dReal aabb[6], localAabb[6];
+            dGeomGetAABB(o2, aabb);
+            const Matrix inverse = grid->globalQ.conjugate().toRotationMatrix();
+            AabbTree::transform(aabb, -(inverse*grid->globalPos), inverse, localAabb);
+            uint32_t lo[3], hi[3];
+            for(int k=0; k<3; k++)
+            {
+                const dReal min = localAabb[k*2]/grid->resolution + 0.5*grid->size;
+                const dReal max = localAabb[k*2+1]/grid->resolution + 0.5*grid->size;
+                if(max < 0.0 || min >= grid->size)
+                {
+                    return 0;
+                }
+                lo[k] = static_cast<uint32_t>(std::max(min, 0.0));
+                hi[k] = static_cast<uint32_t>(std::min(max, grid->size - 1.0));
+            }
+
+            dQuaternion dQ = {grid->globalQ.w(), grid->globalQ.x(), grid->globalQ.y(), grid->globalQ.z()};
+            dGeomSetQuaternion(grid->prototype, dQ);
+            int numContacts = 0;
+            auto callback = [&](const uint32_t *voxel)
+            {
+                const Vector center((voxel[0] + 0.5 - 0.5*grid->size)*grid->resolution,
+                                    (voxel[1] + 0.5 - 0.5*grid->size)*grid->resolution,
+                                    (voxel[2] + 0.5 - 0.5*grid->size)*grid->resolution);
+                const Vector pos = grid->globalPos + grid->globalQ*center;
+                dGeomSetPosition(grid->prototype, pos.x(), pos.y(), pos.z());
+                dContactGeom *out = UserGeomClass::contactAt(contact, numContacts, skip);
+                const int n = dCollide(grid->prototype, o2, (flags & ~UserGeomClass::kNumContactsMask) | (maxContacts-numContacts), out, skip);
+                for(int i=0; i<n; i++)
+                {
+                    UserGeomClass::contactAt(out, i, skip)->g1 = o1;
+                }
+                numContacts += n;
+                return numContacts < maxContacts && !((flags & CONTACTS_UNIMPORTANT) && numContacts);
+            };
+            const uint32_t base[3] = {0, 0, 0};
+            grid->queryNode(0, 0, base, lo, hi, callback);
+            return numContacts;
+        }
+
+        ConfigMap VoxelGrid::getConfigMap() const
+        {
+            ConfigMap result = Object::getConfigMap();
+            result["occupied"] = static_cast<int>(numOccupied);
+            result["nodes"] = static_cast<int>(nodes.size() - freeNodes.size());
+            return result;
+        }
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,99 @@
+ /**
+ * \file VoxelGrid.hpp
+ * \brief "VoxelGrid" implements a static occupancy grid stored in a sparse
+ *        octree that can be updated incrementally.
+ *
+ */
+
+#pragma once
+
+#include "Object.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+
+        /**
+         * The grid is a cube of 4*2^depth voxels per side centered at the object
+         * origin. Only the inner nodes of occupied regions are allocated; the
+         * leaves of the octree hold the occupancy of 4x4x4 voxels as bit mask.
+         * Like the InstancedScatter, one geom of a user geom class is inserted
+         * into the space and its collider collides a single box prototype, placed
+         * at each occupied voxel overlapping the other geom, with that geom.
+         *
+         * The occupancy can be changed with setVoxel and updateVoxels at any time
+         * between two calls of CollisionSpace::generateContacts, only the touched
+         * octree nodes are modified.
+         */
+        class VoxelGrid : public Object
+        {
+        public:
+            VoxelGrid(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual ~VoxelGrid(void);
+            static Object* instantiate(interfaces::CollisionInterface* space, std::shared_ptr<interfaces::DynamicObject> movable, configmaps::ConfigMap &config);
+            virtual bool createGeom() override;
+            virtual void updateTransform(void) override;
+            virtual configmaps::ConfigMap getConfigMap() const override;
+
+            /**
+             * \brief Sets the voxel containing pos (in object coordinates).
+             *
+             * Returns false if pos is outside of the grid.
+             */
+            bool setVoxel(const utils::Vector &pos, bool occupied);
+            // applies a batch of changes, e.g. from one sensor update
+            void updateVoxels(const std::vector<utils::Vector> &occupied,
+                              const std::vector<utils::Vector> &free);
+            void clear();
+            bool isOccupied(const utils::Vector &pos) const;
+            uint64_t getNumOccupied() const
+            {
+                return numOccupied;
+            }
+
+        private:
+            struct Node
+            {
+                // index of the child nodes, or leaves on the last level, 0 if empty
+                uint32_t children[8];
+            };
+
+            static int getGeomClass();
+            static dColliderFn* getCollider(int geomClass);
+            static int collide(dGeomID o1, dGeomID o2, int flags, dContactGeom *contact, int skip);
+            static void computeAabb(dGeomID geom, dReal aabb[6]);
+
+            bool loadVoxels();
+            bool toVoxel(const utils::Vector &pos, uint32_t *voxel) const;
+            bool changeVoxel(const uint32_t *voxel, bool occupied);
+            uint32_t allocateNode();
+            uint32_t allocateLeaf();
+            // bounds of the occupied leaves, marks the geom as moved to update the aabb
+            void updateBounds();
+            void updateNodeBounds(uint32_t node, unsigned int level, const uint32_t *base);
+            // calls callback(voxel) for the occupied voxels in [lo, hi] until it returns false
+            template<typename Callback>
+            bool queryNode(uint32_t node, unsigned int level, const uint32_t *base,
+                           const uint32_t *lo, const uint32_t *hi, Callback &callback) const;
+
+            dReal resolution;
+            unsigned int depth;
+            // voxels per side
+            uint32_t size;
+            std::vector<Node> nodes;
+            std::vector<uint64_t> leaves;
+            std::vector<uint32_t> freeNodes, freeLeaves;
+            uint64_t numOccupied;
+            // voxel range of the occupied leaves, lo > hi if empty
+            uint32_t boundsLo[3], boundsHi[3];
+            dGeomID prototype;
+            utils::Vector globalPos;
+            utils::Quaternion globalQ;
+        };
+
+    } // end of namespace ode_collision
+} // end of namespace mars
@@ -0,0 +1,39 @@
+/**
+ * \file TestHelpers.hpp
+ * \brief Minimal check macros for the unit tests, a test executable returns
+ *        a non zero exit code if any check failed.
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+namespace mars
+{
+    namespace ode_collision
+    {
+        namespace test
+        {
+            inline int failures = 0;
+        }
+    }
+}
+
+#define CHECK(condition)                                                \
+    if(!(condition))                                                    \
+    {                                                                   \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        mars::ode_collision::test::failures++;                          \
+    }
+
+#define CHECK_NEAR(value, expected, tolerance)                          \
+    if(!(std::fabs((double)(value) - (double)(expected)) <= (tolerance))) \
+    {                                                                   \
+        fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g\n", __FILE__, __LINE__, \
+                #value, (double)(value), (double)(expected));           \
+        mars::ode_collision::test::failures++;                          \
+    }
+
+#define TEST_RESULT() (mars::ode_collision::test::failures ? 1 : 0)
@@ -0,0 +1,155 @@
+#include "TestHelpers.hpp"
+
+#include <AabbTree.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace mars::ode_collision;
+using mars::utils::Vector;
+
+namespace
+{
+    dReal randomValue(dReal min, dReal max)
+    {
+        return min + (max-min)*rand()/(dReal)RAND_MAX;
+    }
+
+    AabbTree::Aabb randomBox(dReal range, dReal maxSize)
+    {
+        AabbTree::Aabb box;
+        for(int k=0; k<3; k++)
+        {
+            box[k*2] = randomValue(-range, range);
+            box[k*2+1] = box[k*2] + randomValue(0.0, maxSize);
+        }
+        return box;
+    }
+
+    std::vector<unsigned int> query(const AabbTree &tree, const AabbTree::Aabb &box)
+    {
+        std::vector<unsigned int> result;
+        tree.query(box.data(), [&](unsigned int item) {result.push_back(item);});
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<unsigned int> bruteForce(const std::vector<AabbTree::Aabb> &bounds, const AabbTree::Aabb &box)
+    {
+        std::vector<unsigned int> result;
+        for(unsigned int i=0; i<bounds.size(); i++)
+        {
+            if(AabbTree::overlaps(bounds[i].data(), box.data()))
+            {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+}
+
+int main()
+{
+    srand(3);
+    AabbTree tree;
+    CHECK(tree.empty());
+    const AabbTree::Aabb everything = {-1e9, 1e9, -1e9, 1e9, -1e9, 1e9};
+    CHECK(query(tree, everything).empty());
+
+    // touching boxes overlap
+    const AabbTree::Aabb a = {0.0, 1.0, 0.0, 1.0, 0.0, 1.0};
+    const AabbTree::Aabb b = {1.0, 2.0, 0.5, 1.5, 0.0, 1.0};
+    const AabbTree::Aabb c = {1.1, 2.0, 0.0, 1.0, 0.0, 1.0};
+    CHECK(AabbTree::overlaps(a.data(), b.data()));
+    CHECK(!AabbTree::overlaps(a.data(), c.data()));
+
+    // queries match a brute force test, including duplicated boxes
+    std::vector<AabbTree::Aabb> bounds;
+    for(int i=0; i<500; i++)
+    {
+        bounds.push_back(randomBox(10.0, 2.0));
+    }
+    bounds.push_back(bounds[0]);
+    bounds.push_back(bounds[0]);
+    tree.build(bounds);
+    CHECK(!tree.empty());
+    CHECK(query(tree, everything).size() == bounds.size());
+    for(int i=0; i<200; i++)
+    {
+        const AabbTree::Aabb box = randomBox(10.0, 4.0);
+        CHECK(query(tree, box) == bruteForce(bounds, box));
+    }
+    // the root box covers all items
+    for(const auto &item : bounds)
+    {
+        for(int k=0; k<3; k++)
+        {
+            CHECK(tree.getBounds()[k*2] <= item[k*2] && item[k*2+1] <= tree.getBounds()[k*2+1]);
+        }
+    }
+
+    // refit keeps the queries correct after the items moved
+    for(auto &item : bounds)
+    {
+        const dReal shift = randomValue(-3.0, 3.0);
+        item[0] += shift;
+        item[1] += shift;
+    }
+    tree.refit(bounds);
+    for(int i=0; i<200; i++)
+    {
+        const AabbTree::Aabb box = randomBox(10.0, 4.0);
+        CHECK(query(tree, box) == bruteForce(bounds, box));
+    }
+    // a different item count rebuilds the tree
+    bounds.resize(10);
+    tree.refit(bounds);
+    CHECK(query(tree, everything).size() == 10);
+    tree.clear();
+    CHECK(tree.empty());
+
+    // the transformed box contains the transformed corners
+    const mars::utils::Quaternion q(Eigen::AngleAxisd(0.7, Vector(1.0, 2.0, 3.0).normalized()));
+    const Vector pos(1.0, -2.0, 3.0);
+    const AabbTree::Aabb box = {-1.0, 2.0, 0.0, 0.5, -3.0, -1.0};
+    dReal out[6];
+    AabbTree::transform(box.data(), pos, q.toRotationMatrix(), out);
+    for(int i=0; i<8; i++)
+    {
+        const Vector corner = q*Vector(box[i & 1], box[2 + ((i >> 1) & 1)], box[4 + ((i >> 2) & 1)]) + pos;
+        for(int k=0; k<3; k++)
+        {
+            CHECK(out[k*2] <= corner[k]+1e-12 && corner[k] <= out[k*2+1]+1e-12);
+        }
+    }
+    // and is exact without rotation
+    AabbTree::transform(box.data(), pos, mars::utils::Matrix::Identity(), out);
+    for(int k=0; k<3; k++)
+    {
+        CHECK_NEAR(out[k*2], box[k*2] + pos[k], 1e-12);
+        CHECK_NEAR(out[k*2+1], box[k*2+1] + pos[k], 1e-12);
+    }
+
+    // an infinite box (e.g. of a plane) overlaps every item after the transform
+    const dReal infinity = std::numeric_limits<dReal>::infinity();
+    const dReal plane[6] = {-infinity, infinity, -infinity, infinity, -infinity, 0.0};
+    AabbTree::transform(plane, pos, q.toRotationMatrix(), out);
+    for(int k=0; k<6; k++)
+    {
+        CHECK(!std::isnan(out[k]));
+    }
+    bounds.clear();
+    for(int i=0; i<50; i++)
+    {
+        bounds.push_back(randomBox(10.0, 2.0));
+    }
+    tree.build(bounds);
+    AabbTree::Aabb transformed;
+    std::copy(out, out+6, transformed.begin());
+    CHECK(query(tree, transformed).size() == bounds.size());
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,78 @@
+#include "TestHelpers.hpp"
+
+#include <CollisionSpace.hpp>
+#include <objects/Compound.hpp>
+#include <objects/Plane.hpp>
+
+#include <configmaps/ConfigMap.hpp>
+#include <ode/ode.h>
+
+#include <cmath>
+
+using namespace mars::ode_collision;
+using configmaps::ConfigMap;
+
+/**
+ * Regression test: the box of a plane is infinite, the compound collider
+ * has to collide all children with it instead of querying its child tree
+ * with a nan box.
+ */
+int main()
+{
+    CollisionSpace space(nullptr);
+    space.initSpace();
+
+    ConfigMap compoundConfig = ConfigMap::fromYamlString(
+        "name: compound\n"
+        "type: compound\n"
+        "children:\n"
+        "  - type: sphere\n"
+        "    extend: {x: 0.5}\n"
+        "    position: {x: 0.0, y: 0.0, z: 0.4}\n"
+        "  - type: box\n"
+        "    extend: {x: 1.0, y: 1.0, z: 1.0}\n"
+        "    position: {x: 3.0, y: 0.0, z: 2.0}\n");
+    ConfigMap planeConfig = ConfigMap::fromYamlString(
+        "name: plane\n"
+        "type: plane\n"
+        "position: {z: 0.0}\n");
+    Object *compound = Compound::instantiate(&space, nullptr, compoundConfig);
+    Object *plane = Plane::instantiate(&space, nullptr, planeConfig);
+    CHECK(compound && compound->getGeom());
+    CHECK(plane && plane->getGeom());
+
+    dContactGeom contacts[4];
+    // the sphere child rests 0.1 in the plane, the box child is above it
+    int n = dCollide(compound->getGeom(), plane->getGeom(), 4, contacts, sizeof(dContactGeom));
+    CHECK(n >= 1);
+    for(int i=0; i<n; i++)
+    {
+        CHECK(contacts[i].g1 == compound->getGeom());
+        CHECK_NEAR(contacts[i].depth, 0.1, 1e-9);
+        CHECK_NEAR(std::fabs(contacts[i].normal[2]), 1.0, 1e-9);
+    }
+    // the collider is symmetric
+    n = dCollide(plane->getGeom(), compound->getGeom(), 4, contacts, sizeof(dContactGeom));
+    CHECK(n >= 1);
+
+    // lifted above the plane
+    compound->setPosition(mars::utils::Vector(0.0, 0.0, 1.0));
+    compound->updateTransform();
+    n = dCollide(compound->getGeom(), plane->getGeom(), 4, contacts, sizeof(dContactGeom));
+    CHECK(n == 0);
+
+    // lowered until the box child touches, too
+    compound->setPosition(mars::utils::Vector(0.0, 0.0, -1.6));
+    compound->updateTransform();
+    n = dCollide(compound->getGeom(), plane->getGeom(), 4, contacts, sizeof(dContactGeom));
+    bool boxContact = false;
+    for(int i=0; i<n; i++)
+    {
+        boxContact |= contacts[i].pos[0] > 2.0;
+    }
+    CHECK(boxContact);
+
+    delete compound;
+    delete plane;
+    return TEST_RESULT();
+}
@@ -0,0 +1,140 @@
+#include "TestHelpers.hpp"
+
+#include <objects/ConvexHull.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace mars::ode_collision;
+
+namespace
+{
+    dReal randomValue(dReal min, dReal max)
+    {
+        return min + (max-min)*rand()/(dReal)RAND_MAX;
+    }
+
+    // box mesh with 12 triangles, counter clockwise seen from outside
+    void addBox(const dReal *min, const dReal *max, std::vector<dReal> *vertices, std::vector<dTriIndex> *indices)
+    {
+        const dTriIndex base = vertices->size()/3;
+        for(int i=0; i<8; i++)
+        {
+            vertices->push_back(i & 1 ? max[0] : min[0]);
+            vertices->push_back(i & 2 ? max[1] : min[1]);
+            vertices->push_back(i & 4 ? max[2] : min[2]);
+        }
+        const dTriIndex faces[36] = {0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+                                     0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+                                     0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+        for(int i=0; i<36; i++)
+        {
+            indices->push_back(base+faces[i]);
+        }
+    }
+
+    // checks the plane and polygon layout expected by dCreateConvex
+    void checkHull(const ConvexHull &hull)
+    {
+        unsigned int offset = 0, edges = 0;
+        for(unsigned int f=0; f<hull.numPlanes(); f++)
+        {
+            const dReal *plane = &hull.planes[f*4];
+            CHECK_NEAR(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2], 1.0, 1e-9);
+            CHECK(offset < hull.polygons.size());
+            const unsigned int count = hull.polygons[offset];
+            CHECK(count >= 3);
+            for(unsigned int k=0; k<count; k++)
+            {
+                const unsigned int index = hull.polygons[offset+1+k];
+                CHECK(index < hull.numPoints());
+                const dReal *p = &hull.points[index*3];
+                CHECK_NEAR(plane[0]*p[0] + plane[1]*p[1] + plane[2]*p[2], plane[3], 1e-9);
+            }
+            edges += count;
+            offset += count+1;
+        }
+        CHECK(offset == hull.polygons.size());
+        // euler characteristic of a closed polyhedron, every edge is shared by two faces
+        CHECK((int)hull.numPoints() - (int)edges/2 + (int)hull.numPlanes() == 2);
+    }
+}
+
+int main()
+{
+    srand(7);
+    ConvexHull hull;
+
+    // cube corners with points inside and on the faces
+    std::vector<dReal> points;
+    for(int i=0; i<8; i++)
+    {
+        points.insert(points.end(), {i & 1 ? 1.0 : -1.0, i & 2 ? 1.0 : -1.0, i & 4 ? 1.0 : -1.0});
+    }
+    for(int i=0; i<200; i++)
+    {
+        points.insert(points.end(), {randomValue(-0.9, 0.9), randomValue(-0.9, 0.9), randomValue(-0.9, 0.9)});
+        points.insert(points.end(), {1.0, randomValue(-0.9, 0.9), randomValue(-0.9, 0.9)});
+    }
+    CHECK(hull.compute(points));
+    CHECK(hull.numPoints() == 8);
+    checkHull(hull);
+    for(size_t i=0; i<points.size()/3; i++)
+    {
+        CHECK(hull.depthInside(&points[i*3]) >= -1e-9);
+    }
+    const dReal center[3] = {0.0, 0.0, 0.0};
+    CHECK_NEAR(hull.depthInside(center), 1.0, 1e-9);
+    const dReal outside[3] = {3.0, 0.0, 0.0};
+    CHECK_NEAR(hull.depthInside(outside), -2.0, 1e-9);
+
+    // random points on a sphere are all part of the hull
+    points.clear();
+    for(int i=0; i<100; i++)
+    {
+        dReal p[3] = {randomValue(-1.0, 1.0), randomValue(-1.0, 1.0), randomValue(-1.0, 1.0)};
+        const dReal length = std::sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+        points.insert(points.end(), {p[0]/length, p[1]/length, p[2]/length});
+    }
+    CHECK(hull.compute(points));
+    CHECK(hull.numPoints() == 100);
+    checkHull(hull);
+
+    // flat input has no volume
+    points = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0};
+    CHECK(!hull.compute(points));
+
+    // an L shape is split into parts that each cover one leg
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+    const dReal min1[3] = {0.0, 0.0, 0.0}, max1[3] = {4.0, 1.0, 1.0};
+    const dReal min2[3] = {0.0, 1.0, 0.0}, max2[3] = {1.0, 4.0, 1.0};
+    addBox(min1, max1, &vertices, &indices);
+    addBox(min2, max2, &vertices, &indices);
+    const std::vector<ConvexHull> parts = ConvexHull::decompose(vertices, indices, 8, 0.05);
+    CHECK(parts.size() >= 2 && parts.size() <= 8);
+    for(const auto &part : parts)
+    {
+        checkHull(part);
+    }
+    // the inner corner of the L is not covered by any hull
+    const dReal corner[3] = {2.5, 2.5, 0.5};
+    for(const auto &part : parts)
+    {
+        CHECK(part.depthInside(corner) < 0.0);
+    }
+    // both legs are covered
+    const dReal leg1[3] = {3.5, 0.5, 0.5}, leg2[3] = {0.5, 3.5, 0.5};
+    bool covered1 = false, covered2 = false;
+    for(const auto &part : parts)
+    {
+        covered1 |= part.depthInside(leg1) > 0.0;
+        covered2 |= part.depthInside(leg2) > 0.0;
+    }
+    CHECK(covered1 && covered2);
+    // a single hull is allowed to cover the concavity
+    CHECK(ConvexHull::decompose(vertices, indices, 1, 0.05).size() == 1);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,144 @@
+#include "TestHelpers.hpp"
+
+#include <Distance.hpp>
+
+#include <ode/ode.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace mars::ode_collision;
+using mars::utils::Vector;
+
+namespace
+{
+    // unit cube mesh, vertices padded to dVector3 for dGeomTriMeshDataBuildSimple
+    void createCube(std::vector<dReal> *vertices, std::vector<dTriIndex> *indices)
+    {
+        vertices->clear();
+        for(int i=0; i<8; i++)
+        {
+            vertices->insert(vertices->end(), {i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 0.5 : -0.5, 0.0});
+        }
+        *indices = {0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+                    0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+                    0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+    }
+
+    // distance of the result points matches the reported distance
+    bool consistent(const DistanceResult &result)
+    {
+        return std::fabs((result.point2 - result.point1).norm() - std::fabs(result.distance)) < 1e-6;
+    }
+}
+
+int main()
+{
+    dInitODE();
+    DistanceResult result;
+
+    // spheres
+    dGeomID sphere1 = dCreateSphere(0, 0.5);
+    dGeomID sphere2 = dCreateSphere(0, 0.25);
+    dGeomSetPosition(sphere2, 2.0, 0.0, 0.0);
+    CHECK(Distance::compute(sphere1, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, 1.25, 1e-9);
+    CHECK((result.point1 - Vector(0.5, 0.0, 0.0)).norm() < 1e-9);
+    CHECK((result.point2 - Vector(1.75, 0.0, 0.0)).norm() < 1e-9);
+    // further apart than the bound
+    CHECK(!Distance::compute(sphere1, sphere2, 1.0, &result));
+    // overlapping geoms report the negative depth
+    dGeomSetPosition(sphere2, 0.6, 0.0, 0.0);
+    CHECK(Distance::compute(sphere1, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, -0.15, 1e-9);
+
+    // rotated box and capsule
+    dGeomID box = dCreateBox(0, 2.0, 1.0, 1.0);
+    dMatrix3 rotation;
+    dRFromAxisAndAngle(rotation, 0.0, 0.0, 1.0, M_PI/2);
+    dGeomSetRotation(box, rotation);
+    dGeomSetPosition(sphere2, 0.0, 2.0, 0.0);
+    CHECK(Distance::compute(box, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, 0.75, 1e-9);
+    CHECK(consistent(result));
+    dGeomID capsule = dCreateCapsule(0, 0.1, 1.0);
+    dGeomSetPosition(capsule, 1.0, 0.0, 0.0);
+    CHECK(Distance::compute(box, capsule, dInfinity, &result));
+    CHECK_NEAR(result.distance, 0.4, 1e-9);
+    CHECK_NEAR(result.point1.x(), 0.5, 1e-9);
+    CHECK_NEAR(result.point2.x(), 0.9, 1e-9);
+    // the order of the geoms swaps the points
+    CHECK(Distance::compute(capsule, box, dInfinity, &result));
+    CHECK_NEAR(result.point1.x(), 0.9, 1e-9);
+
+    // cylinder edge to sphere
+    dGeomID cylinder = dCreateCylinder(0, 0.5, 1.0);
+    dGeomSetPosition(sphere2, 1.5, 0.0, 1.5);
+    CHECK(Distance::compute(cylinder, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, std::sqrt(2.0) - 0.25, 1e-6);
+
+    // plane
+    dGeomID plane = dCreatePlane(0, 0.0, 0.0, 1.0, -1.0);
+    CHECK(Distance::compute(plane, sphere1, dInfinity, &result));
+    CHECK_NEAR(result.distance, 0.5, 1e-9);
+    CHECK_NEAR(result.point1.z(), -1.0, 1e-9);
+    dGeomID ray = dCreateRay(0, 1.0);
+    CHECK(!Distance::isSupported(ray));
+    dGeomDestroy(ray);
+
+    // trimesh cube, moved and rotated to use the cached tree in mesh coordinates
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+    createCube(&vertices, &indices);
+    dTriMeshDataID data = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildSimple(data, vertices.data(), vertices.size()/4, indices.data(), indices.size());
+    dGeomID mesh = dCreateTriMesh(0, data, 0, 0, 0);
+    dGeomSetPosition(mesh, 3.0, 0.0, 0.0);
+    dGeomSetRotation(mesh, rotation);
+    dGeomSetPosition(sphere2, 3.0, 0.0, 1.0);
+    CHECK(Distance::compute(mesh, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, 0.25, 1e-6);
+    CHECK(consistent(result));
+    // corner region
+    dGeomSetPosition(sphere2, 4.5, 1.5, 1.5);
+    CHECK(Distance::compute(sphere2, mesh, dInfinity, &result));
+    CHECK_NEAR(result.distance, std::sqrt(3.0) - 0.25, 1e-6);
+    CHECK((result.point2 - Vector(3.5, 0.5, 0.5)).norm() < 1e-6);
+    // the bound applies to meshes, too
+    CHECK(!Distance::compute(mesh, sphere2, 1.0, &result));
+    // a second geom of the same data at another pose shares the tree
+    dGeomID mesh2 = dCreateTriMesh(0, data, 0, 0, 0);
+    dGeomSetPosition(mesh2, 3.0, 0.0, 3.0);
+    CHECK(Distance::compute(mesh, mesh2, dInfinity, &result));
+    CHECK_NEAR(result.distance, 2.0, 1e-6);
+    CHECK(Distance::compute(mesh2, plane, dInfinity, &result));
+    CHECK_NEAR(result.distance, 3.5, 1e-6);
+    // touching meshes
+    dGeomSetPosition(mesh2, 3.0, 0.0, 0.9);
+    CHECK(Distance::compute(mesh, mesh2, dInfinity, &result));
+    CHECK(result.distance <= 0.0);
+
+    // rebuilt data with scaled vertices after dropping the tree
+    for(size_t i=0; i<vertices.size(); i++)
+    {
+        vertices[i] *= 2.0;
+    }
+    Distance::releaseTriMeshData(data);
+    dGeomTriMeshDataBuildSimple(data, vertices.data(), vertices.size()/4, indices.data(), indices.size());
+    dGeomSetPosition(sphere2, 3.0, 0.0, 2.0);
+    CHECK(Distance::compute(mesh, sphere2, dInfinity, &result));
+    CHECK_NEAR(result.distance, 0.75, 1e-6);
+
+    Distance::releaseTriMeshData(data);
+    dGeomDestroy(mesh2);
+    dGeomDestroy(mesh);
+    dGeomTriMeshDataDestroy(data);
+    dGeomDestroy(plane);
+    dGeomDestroy(cylinder);
+    dGeomDestroy(capsule);
+    dGeomDestroy(box);
+    dGeomDestroy(sphere2);
+    dGeomDestroy(sphere1);
+    dCloseODE();
+    return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+#include "TestHelpers.hpp"
+
+#include <objects/DistanceField.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace mars::ode_collision;
+
+namespace
+{
+    // unit box centered at the origin, counter clockwise seen from outside;
+    // every face has its own vertices like in exported meshes
+    void createBox(bool inwards, std::vector<dReal> *vertices, std::vector<dTriIndex> *indices)
+    {
+        const int corners[8][3] = {{-1, -1, -1}, {1, -1, -1}, {-1, 1, -1}, {1, 1, -1},
+                                   {-1, -1, 1}, {1, -1, 1}, {-1, 1, 1}, {1, 1, 1}};
+        const int faces[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+                                 {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+        vertices->clear();
+        indices->clear();
+        for(const auto &face : faces)
+        {
+            const dTriIndex base = vertices->size()/3;
+            for(int k=0; k<4; k++)
+            {
+                for(int i=0; i<3; i++)
+                {
+                    vertices->push_back(0.5*corners[face[k]][i]);
+                }
+            }
+            if(inwards)
+            {
+                indices->insert(indices->end(), {base, base+2, base+1, base, base+3, base+2});
+            }
+            else
+            {
+                indices->insert(indices->end(), {base, base+1, base+2, base, base+2, base+3});
+            }
+        }
+    }
+
+    // distance to the surface of the unit box, negative inside
+    dReal boxDistance(const dReal *p)
+    {
+        dReal outside = 0.0, inside = -1e9;
+        for(int k=0; k<3; k++)
+        {
+            const dReal d = std::fabs(p[k]) - 0.5;
+            outside += std::max(d, 0.0)*std::max(d, 0.0);
+            inside = std::max(inside, d);
+        }
+        return inside > 0.0 ? std::sqrt(outside) : inside;
+    }
+}
+
+int main()
+{
+    const dReal cellSize = 0.05;
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+    DistanceField field;
+    dReal distance, gradient[3];
+
+    // closed box seen from outside: negative inside, positive outside
+    createBox(false, &vertices, &indices);
+    CHECK(field.build(vertices, indices, cellSize, 8));
+    const dReal center[3] = {0.0, 0.0, 0.0};
+    CHECK(field.sample(center, &distance, gradient));
+    CHECK_NEAR(distance, -0.5, 0.01);
+    // the points beyond the band are within the chamfer error
+    const dReal points[][3] = {{0.3, 0.1, -0.2}, {0.45, 0.0, 0.0}, {0.55, 0.0, 0.0}, {0.7, 0.6, 0.0},
+                               {0.0, -0.8, 0.0}, {0.6, 0.6, 0.6}, {-0.2, 0.49, 0.3}, {0.0, 0.0, -0.75}};
+    for(const auto &p : points)
+    {
+        CHECK(field.sample(p, &distance, nullptr));
+        CHECK_NEAR(distance, boxDistance(p), 0.02);
+    }
+    // the gradient points outwards
+    const dReal side[3] = {0.7, 0.0, 0.0};
+    CHECK(field.sample(side, &distance, gradient));
+    CHECK(gradient[0] > 0.5 && std::fabs(gradient[1]) < 0.1 && std::fabs(gradient[2]) < 0.1);
+    const dReal outsideGrid[3] = {5.0, 0.0, 0.0};
+    CHECK(!field.sample(outsideGrid, &distance, nullptr));
+    int negative = 0;
+    for(const auto &value : field.values)
+    {
+        negative += value < 0.0f;
+    }
+    CHECK(negative > 0);
+
+    // the same box seen from inside (e.g. a room): the field is inverted
+    createBox(true, &vertices, &indices);
+    CHECK(field.build(vertices, indices, cellSize, 8));
+    CHECK(field.sample(center, &distance, nullptr));
+    CHECK_NEAR(distance, 0.5, 0.01);
+    for(const auto &p : points)
+    {
+        CHECK(field.sample(p, &distance, nullptr));
+        CHECK_NEAR(distance, -boxDistance(p), 0.02);
+    }
+
+    // an open box (no top face) keeps the sign of its walls
+    createBox(false, &vertices, &indices);
+    indices.erase(indices.begin()+6, indices.begin()+12);
+    CHECK(field.build(vertices, indices, cellSize, 8));
+    CHECK(field.sample(center, &distance, nullptr));
+    CHECK(distance < 0.0);
+    const dReal below[3] = {0.0, 0.0, -0.7};
+    CHECK(field.sample(below, &distance, nullptr));
+    CHECK_NEAR(distance, 0.2, 0.01);
+
+    // a single quad is positive on the side of its normal
+    vertices = {-0.5, -0.5, 0.0, 0.5, -0.5, 0.0, 0.5, 0.5, 0.0, -0.5, 0.5, 0.0};
+    indices = {0, 1, 2, 0, 2, 3};
+    CHECK(field.build(vertices, indices, cellSize, 8));
+    const dReal above[3] = {0.1, 0.1, 0.2}, under[3] = {0.1, 0.1, -0.2};
+    CHECK(field.sample(above, &distance, nullptr));
+    CHECK_NEAR(distance, 0.2, 0.01);
+    CHECK(field.sample(under, &distance, nullptr));
+    CHECK_NEAR(distance, -0.2, 0.01);
+
+    // invalid input
+    CHECK(!field.build(vertices, indices, 0.0, 2));
+    CHECK(!field.build(std::vector<dReal>(), indices, cellSize, 2));
+
+    return TEST_RESULT();
+}
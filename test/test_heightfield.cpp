@@ -0,0 +1,127 @@
+#include "TestHelpers.hpp"
+
+#include <CollisionSpace.hpp>
+#include <objects/Heightfield.hpp>
+
+#include <configmaps/ConfigMap.hpp>
+#include <mars_interfaces/terrainStruct.h>
+#include <ode/ode.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace mars::ode_collision;
+using configmaps::ConfigMap;
+using mars::interfaces::terrainStruct;
+
+namespace
+{
+    // more than one 16 sample block in both directions, with partial ones at the end
+    const int kWidth = 40;
+    const int kHeight = 33;
+    const dReal kScale = 0.5;
+
+    // height of the pixel (row, column) as ode reads it, the rows are flipped
+    dReal heightAt(Heightfield *heightfield, int row, int column)
+    {
+        return heightfield->heightCallback(column, kHeight-1-row);
+    }
+
+    dReal aabbTop(Heightfield *heightfield)
+    {
+        dReal aabb[6];
+        dGeomGetAABB(heightfield->getGeom(), aabb);
+        return aabb[5];
+    }
+
+    dReal aabbBottom(Heightfield *heightfield)
+    {
+        dReal aabb[6];
+        dGeomGetAABB(heightfield->getGeom(), aabb);
+        return aabb[4];
+    }
+}
+
+int main()
+{
+    CollisionSpace space(nullptr);
+    space.initSpace();
+
+    ConfigMap config = ConfigMap::fromYamlString("name: terrain\n");
+    Heightfield *heightfield = static_cast<Heightfield*>(Heightfield::instantiate(&space, nullptr, config));
+    // patches need the geom
+    const double value = 1.0;
+    CHECK(!heightfield->updatePatch(0, 0, 1, 1, &value));
+
+    // the heightfield takes ownership of the terrain
+    terrainStruct *terrain = new terrainStruct();
+    terrain->name = "terrain";
+    terrain->width = kWidth;
+    terrain->height = kHeight;
+    terrain->targetWidth = kWidth-1;
+    terrain->targetHeight = kHeight-1;
+    terrain->scale = kScale;
+    terrain->pixelData = static_cast<double*>(calloc(kWidth*kHeight, sizeof(double)));
+    // a sloped row to tell the row order apart
+    for(int column=0; column<kWidth; column++)
+    {
+        terrain->pixelData[column] = 0.01*column;
+    }
+    heightfield->setTerrainStruct(terrain);
+    CHECK(heightfield->createGeom());
+    CHECK_NEAR(heightAt(heightfield, 0, 7), 0.07*kScale, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 1, 7), 0.0, 1e-9);
+    // initial conservative bounds
+    CHECK_NEAR(aabbTop(heightfield), 2.0*kScale, 1e-6);
+
+    // corner block inside the initial bounds
+    std::vector<double> corner = {1.0, 1.1, 1.2,
+                                  1.3, 1.4, 1.5};
+    CHECK(heightfield->updatePatch(0, 0, 2, 3, corner.data()));
+    for(int row=0; row<2; row++)
+    {
+        for(int column=0; column<3; column++)
+        {
+            CHECK_NEAR(heightAt(heightfield, row, column), corner[row*3+column]*kScale, 1e-9);
+            CHECK(terrain->pixelData[row*kWidth+column] == corner[row*3+column]);
+        }
+    }
+    // neighbours are untouched
+    CHECK_NEAR(heightAt(heightfield, 0, 3), 0.03*kScale, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 2, 0), 0.0, 1e-9);
+    CHECK_NEAR(aabbTop(heightfield), 2.0*kScale, 1e-6);
+
+    // interior block across a block border grows the bounds
+    std::vector<double> interior(4*5, 0.5);
+    interior[2*5+4] = 3.0;
+    CHECK(heightfield->updatePatch(14, 13, 4, 5, interior.data()));
+    CHECK_NEAR(heightAt(heightfield, 16, 17), 3.0*kScale, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 14, 13), 0.5*kScale, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 13, 13), 0.0, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 14, 18), 0.0, 1e-9);
+    CHECK_NEAR(heightAt(heightfield, 18, 17), 0.0, 1e-9);
+    CHECK_NEAR(aabbTop(heightfield), 3.0*kScale, 1e-6);
+
+    // the bounds do not shrink again but grow downwards, too
+    const dReal bottom = aabbBottom(heightfield);
+    std::vector<double> low(4*5, -6.0);
+    CHECK(heightfield->updatePatch(14, 13, 4, 5, low.data()));
+    CHECK_NEAR(heightAt(heightfield, 16, 17), -6.0*kScale, 1e-9);
+    CHECK_NEAR(aabbTop(heightfield), 3.0*kScale, 1e-6);
+    CHECK(aabbBottom(heightfield) <= bottom - 4.0*kScale + 1e-6);
+
+    // last row and column
+    CHECK(heightfield->updatePatch(kHeight-1, kWidth-1, 1, 1, &value));
+    CHECK_NEAR(heightAt(heightfield, kHeight-1, kWidth-1), value*kScale, 1e-9);
+    CHECK_NEAR(heightfield->heightCallback(kWidth-1, 0), value*kScale, 1e-9);
+
+    // out of range patches are rejected and change nothing
+    CHECK(!heightfield->updatePatch(kHeight-1, 0, 2, 1, corner.data()));
+    CHECK(!heightfield->updatePatch(0, kWidth-2, 1, 3, corner.data()));
+    CHECK(!heightfield->updatePatch(-1, 0, 1, 1, &value));
+    CHECK(!heightfield->updatePatch(0, 0, 0, 1, &value));
+    CHECK_NEAR(heightAt(heightfield, kHeight-1, 0), 0.0, 1e-9);
+
+    delete heightfield;
+    return TEST_RESULT();
+}
@@ -0,0 +1,72 @@
+#include "TestHelpers.hpp"
+
+#include <objects/MeshCache.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+using namespace mars::ode_collision;
+
+int main()
+{
+    const std::string file = "/tmp/test_mesh_cache_" + std::to_string(getpid()) + ".bin";
+    const uint64_t key = MeshCache::hash("mesh", 4);
+
+    const double vertices[9] = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    const uint32_t indices[3] = {0, 1, 2};
+    // odd size to check the alignment of the following section
+    const char tag[3] = {'a', 'b', 'c'};
+    {
+        MeshCache::Writer writer;
+        writer.addSection(MeshCache::kVertices, vertices, sizeof(double), 9);
+        writer.addSection(100, tag, 1, 3);
+        writer.addSection(MeshCache::kIndices, indices, sizeof(uint32_t), 3);
+        CHECK(writer.write(file, key));
+    }
+
+    {
+        MeshCache cache;
+        CHECK(cache.open(file, key));
+        uint64_t count = 0;
+        const double *v = cache.getSection<double>(MeshCache::kVertices, &count);
+        CHECK(v && count == 9);
+        for(int i=0; v && i<9; i++)
+        {
+            CHECK(v[i] == vertices[i]);
+        }
+        const uint32_t *t = cache.getSection<uint32_t>(MeshCache::kIndices, &count);
+        CHECK(t && count == 3 && t[0] == 0 && t[1] == 1 && t[2] == 2);
+        CHECK(reinterpret_cast<uintptr_t>(t) % 16 == 0);
+        // wrong element size and missing sections
+        CHECK(!cache.getSection<float>(MeshCache::kVertices, &count));
+        CHECK(!cache.getSection<double>(MeshCache::kBounds, &count));
+
+        // in place modifications do not change the file
+        const_cast<double*>(v)[0] = 5.0;
+    }
+    {
+        MeshCache cache;
+        CHECK(cache.open(file, key));
+        uint64_t count = 0;
+        const double *v = cache.getSection<double>(MeshCache::kVertices, &count);
+        CHECK(v && v[0] == 0.0);
+    }
+
+    // outdated key and missing file
+    {
+        MeshCache cache;
+        CHECK(!cache.open(file, key+1));
+        CHECK(!cache.isOpen());
+        CHECK(!cache.open(file + ".missing", key));
+    }
+
+    // chained hashes equal the hash of the concatenation
+    CHECK(MeshCache::hash("bc", 2, MeshCache::hash("a", 1)) == MeshCache::hash("abc", 3));
+    CHECK(MeshCache::hash("abc", 3) != MeshCache::hash("abd", 3));
+    CHECK(MeshCache::entryPath("/cache", "mesh", 0xabc) == "/cache/mesh_0000000000000abc.bin");
+
+    remove(file.c_str());
+    return TEST_RESULT();
+}
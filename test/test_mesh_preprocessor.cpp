@@ -0,0 +1,114 @@
+#include "TestHelpers.hpp"
+
+#include <objects/MeshPreprocessor.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace mars::ode_collision;
+
+namespace
+{
+    bool validIndices(const std::vector<dReal> &vertices, const std::vector<dTriIndex> &indices)
+    {
+        for(const auto &index : indices)
+        {
+            if(index >= vertices.size()/3)
+            {
+                return false;
+            }
+        }
+        return indices.size()%3 == 0;
+    }
+
+    // unit square in the xy plane made of n x n quads, every quad has its own vertices
+    void createPlane(int n, std::vector<dReal> *vertices, std::vector<dTriIndex> *indices)
+    {
+        vertices->clear();
+        indices->clear();
+        for(int i=0; i<n; i++)
+        {
+            for(int j=0; j<n; j++)
+            {
+                const dReal x0 = (dReal)i/n, x1 = (dReal)(i+1)/n;
+                const dReal y0 = (dReal)j/n, y1 = (dReal)(j+1)/n;
+                const dTriIndex base = vertices->size()/3;
+                vertices->insert(vertices->end(), {x0, y0, 0.0, x1, y0, 0.0, x1, y1, 0.0, x0, y1, 0.0});
+                indices->insert(indices->end(), {base, base+1, base+2, base, base+2, base+3});
+            }
+        }
+    }
+}
+
+int main()
+{
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+
+    // welding merges the shared corners of the quads
+    createPlane(4, &vertices, &indices);
+    MeshPreprocessor(vertices, indices).weldVertices(1e-6);
+    CHECK(vertices.size()/3 == 25);
+    CHECK(indices.size() == 4*4*6);
+    CHECK(validIndices(vertices, indices));
+
+    // degenerate and duplicated triangles (also with flipped winding) are removed
+    vertices = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 2.0, 0.0, 0.0};
+    indices = {0, 1, 2,
+               0, 0, 1,
+               0, 1, 3,
+               2, 1, 0};
+    MeshPreprocessor(vertices, indices).removeDegenerateTriangles();
+    CHECK(indices.size() == 3);
+    CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+
+    // unreferenced vertices are dropped and the indices renumbered
+    vertices = {5.0, 5.0, 5.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    indices = {1, 2, 3};
+    MeshPreprocessor(vertices, indices).compactVertices();
+    CHECK(vertices.size() == 9);
+    CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+    CHECK(vertices[0] == 0.0 && vertices[3] == 1.0 && vertices[7] == 1.0);
+
+    // decimation meets the budget and keeps the mesh inside its bounds
+    createPlane(20, &vertices, &indices);
+    {
+        MeshPreprocessor preprocessor(vertices, indices);
+        preprocessor.weldVertices(1e-6);
+        preprocessor.decimate(100);
+        preprocessor.compactVertices();
+    }
+    CHECK(indices.size()/3 <= 100);
+    CHECK(indices.size()/3 > 0);
+    CHECK(validIndices(vertices, indices));
+    for(const auto &value : vertices)
+    {
+        CHECK(value >= -1e-9 && value <= 1.0+1e-9);
+    }
+
+    // a mesh within the budget is not touched
+    createPlane(2, &vertices, &indices);
+    const std::vector<dReal> original = vertices;
+    MeshPreprocessor(vertices, indices).decimate(8);
+    CHECK(vertices == original);
+    CHECK(indices.size() == 24);
+
+    // the full pipeline
+    createPlane(10, &vertices, &indices);
+    MeshPreprocessParams params;
+    CHECK(!params.isEnabled());
+    params.weldTolerance = 1e-6;
+    params.maxTriangles = 50;
+    CHECK(params.isEnabled());
+    MeshPreprocessor(vertices, indices).process(params);
+    CHECK(indices.size()/3 <= 50 && !indices.empty());
+    CHECK(validIndices(vertices, indices));
+    std::vector<bool> used(vertices.size()/3, false);
+    for(const auto &index : indices)
+    {
+        used[index] = true;
+    }
+    CHECK(std::all_of(used.begin(), used.end(), [](bool u) {return u;}));
+
+    return TEST_RESULT();
+}
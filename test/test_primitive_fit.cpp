@@ -0,0 +1,160 @@
+#include "TestHelpers.hpp"
+
+#include <objects/PrimitiveFit.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace mars::ode_collision;
+using mars::utils::Vector;
+
+namespace
+{
+    // box mesh with 12 triangles, counter clockwise seen from outside
+    void createBox(const Vector &size, std::vector<dReal> *vertices, std::vector<dTriIndex> *indices)
+    {
+        vertices->clear();
+        indices->clear();
+        for(int i=0; i<8; i++)
+        {
+            vertices->push_back((i & 1 ? 0.5 : -0.5)*size.x());
+            vertices->push_back((i & 2 ? 0.5 : -0.5)*size.y());
+            vertices->push_back((i & 4 ? 0.5 : -0.5)*size.z());
+        }
+        *indices = {0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+                    0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+                    0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+    }
+
+    // closed mesh of a cylinder along z with the given number of sides
+    void createCylinder(dReal radius, dReal length, int sides, std::vector<dReal> *vertices,
+                        std::vector<dTriIndex> *indices)
+    {
+        vertices->clear();
+        indices->clear();
+        for(int i=0; i<sides; i++)
+        {
+            const dReal angle = 2.0*M_PI*i/sides;
+            for(int k=0; k<2; k++)
+            {
+                vertices->insert(vertices->end(), {radius*std::cos(angle), radius*std::sin(angle), (k-0.5)*length});
+            }
+        }
+        const dTriIndex bottom = vertices->size()/3, top = bottom+1;
+        vertices->insert(vertices->end(), {0.0, 0.0, -0.5*length, 0.0, 0.0, 0.5*length});
+        for(int i=0; i<sides; i++)
+        {
+            const dTriIndex a = i*2, b = ((i+1)%sides)*2;
+            indices->insert(indices->end(), {a, b, b+1, a, b+1, a+1, bottom, b, a, top, a+1, b+1});
+        }
+    }
+
+    // uv sphere
+    void createSphere(dReal radius, int rings, int sectors, std::vector<dReal> *vertices,
+                      std::vector<dTriIndex> *indices)
+    {
+        vertices->clear();
+        indices->clear();
+        for(int r=0; r<=rings; r++)
+        {
+            const dReal theta = M_PI*r/rings;
+            for(int s=0; s<sectors; s++)
+            {
+                const dReal phi = 2.0*M_PI*s/sectors;
+                vertices->insert(vertices->end(), {radius*std::sin(theta)*std::cos(phi),
+                                                   radius*std::sin(theta)*std::sin(phi),
+                                                   radius*std::cos(theta)});
+            }
+        }
+        for(int r=0; r<rings; r++)
+        {
+            for(int s=0; s<sectors; s++)
+            {
+                const dTriIndex a = r*sectors+s, b = r*sectors+(s+1)%sectors;
+                const dTriIndex c = a+sectors, d = b+sectors;
+                indices->insert(indices->end(), {a, c, d, a, d, b});
+            }
+        }
+    }
+
+    void transform(const Vector &offset, const mars::utils::Quaternion &q, std::vector<dReal> *vertices)
+    {
+        for(size_t i=0; i<vertices->size(); i+=3)
+        {
+            const Vector p = q*Vector((*vertices)[i], (*vertices)[i+1], (*vertices)[i+2]) + offset;
+            std::copy(p.data(), p.data()+3, &(*vertices)[i]);
+        }
+    }
+}
+
+int main()
+{
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+
+    // axis aligned box with an offset
+    createBox(Vector(2.0, 1.0, 0.5), &vertices, &indices);
+    transform(Vector(1.0, 2.0, 3.0), mars::utils::Quaternion::Identity(), &vertices);
+    PrimitiveFit fit = PrimitiveFit::fit(vertices, indices);
+    CHECK(fit.type == PrimitiveFit::kBox);
+    CHECK_NEAR(fit.error, 0.0, 1e-9);
+    CHECK_NEAR(fit.params[0], 2.0, 1e-9);
+    CHECK_NEAR(fit.params[1], 1.0, 1e-9);
+    CHECK_NEAR(fit.params[2], 0.5, 1e-9);
+    CHECK((fit.center - Vector(1.0, 2.0, 3.0)).norm() < 1e-9);
+
+    // a rotated box is found in its principal frame
+    createBox(Vector(2.0, 1.0, 0.5), &vertices, &indices);
+    const mars::utils::Quaternion q(Eigen::AngleAxisd(0.6, Vector(1.0, 1.0, 0.0).normalized()));
+    transform(Vector::Zero(), q, &vertices);
+    fit = PrimitiveFit::fit(vertices, indices);
+    CHECK(fit.type == PrimitiveFit::kBox);
+    CHECK(fit.error < 1e-6);
+    std::vector<dReal> lengths(fit.params, fit.params+3);
+    std::sort(lengths.begin(), lengths.end());
+    CHECK_NEAR(lengths[0], 0.5, 1e-6);
+    CHECK_NEAR(lengths[1], 1.0, 1e-6);
+    CHECK_NEAR(lengths[2], 2.0, 1e-6);
+    // the box corners are reproduced by the fitted pose
+    for(int i=0; i<8; i++)
+    {
+        const Vector corner = fit.center + fit.rotation*Vector((i & 1 ? 0.5 : -0.5)*fit.params[0],
+                                                                 (i & 2 ? 0.5 : -0.5)*fit.params[1],
+                                                                 (i & 4 ? 0.5 : -0.5)*fit.params[2]);
+        dReal closest = 1e9;
+        for(size_t k=0; k<vertices.size(); k+=3)
+        {
+            closest = std::min(closest, (corner - Vector(vertices[k], vertices[k+1], vertices[k+2])).norm());
+        }
+        CHECK(closest < 1e-6);
+    }
+
+    // finely tessellated sphere
+    createSphere(0.5, 32, 64, &vertices, &indices);
+    fit = PrimitiveFit::fit(vertices, indices);
+    // a capsule of zero length is the same surface
+    CHECK(fit.type == PrimitiveFit::kSphere || (fit.type == PrimitiveFit::kCapsule && fit.params[1] < 1e-6));
+    CHECK(fit.error < 0.02);
+    CHECK_NEAR(fit.params[0], 0.5, 0.01);
+    CHECK(fit.center.norm() < 0.01);
+
+    // cylinder along x, ode cylinders are aligned with the local z axis
+    createCylinder(0.3, 2.0, 64, &vertices, &indices);
+    transform(Vector::Zero(), mars::utils::Quaternion(Eigen::AngleAxisd(M_PI/2, Vector::UnitY())), &vertices);
+    fit = PrimitiveFit::fit(vertices, indices);
+    CHECK(fit.type == PrimitiveFit::kCylinder);
+    CHECK(fit.error < 0.02);
+    CHECK_NEAR(fit.params[0], 0.3, 0.01);
+    CHECK_NEAR(fit.params[1], 2.0, 1e-6);
+    CHECK_NEAR(std::fabs((fit.rotation*Vector::UnitZ()).x()), 1.0, 1e-6);
+
+    // a single triangle has no fit
+    vertices = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    indices = {0, 1, 2};
+    fit = PrimitiveFit::fit(vertices, indices);
+    CHECK(fit.type == PrimitiveFit::kNone);
+    CHECK(PrimitiveFit::typeName(PrimitiveFit::kBox) != PrimitiveFit::typeName(PrimitiveFit::kSphere));
+
+    return TEST_RESULT();
+}
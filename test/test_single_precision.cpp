@@ -0,0 +1,128 @@
+#include "TestHelpers.hpp"
+
+#include <objects/Mesh.hpp>
+
+#include <ode/ode.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace mars::ode_collision;
+
+namespace
+{
+    const int kGridSize = 20;
+    const int kMaxContacts = 16;
+
+    struct Deepest
+    {
+        int count;
+        dReal depth;
+        dReal pos[3];
+        dReal normal[3];
+    };
+
+    Deepest collide(dGeomID sphere, dGeomID mesh)
+    {
+        dContactGeom contacts[kMaxContacts];
+        Deepest result{0, -1.0, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+        result.count = dCollide(sphere, mesh, kMaxContacts, contacts, sizeof(dContactGeom));
+        for(int i=0; i<result.count; i++)
+        {
+            if(contacts[i].depth > result.depth)
+            {
+                result.depth = contacts[i].depth;
+                std::copy(contacts[i].pos, contacts[i].pos+3, result.pos);
+                std::copy(contacts[i].normal, contacts[i].normal+3, result.normal);
+            }
+        }
+        return result;
+    }
+}
+
+/**
+ * Collides spheres with the same trimesh built from double and from single
+ * precision vertices. The mesh is placed away from the origin where the
+ * rounding of the float vertices is noticeable; the contacts have to agree
+ * within a small multiple of the rounding error.
+ */
+int main()
+{
+    dInitODE();
+
+    const dReal offset[3] = {100.0, -50.0, 20.0};
+    std::vector<dReal> vertices;
+    std::vector<dTriIndex> indices;
+    for(int i=0; i<=kGridSize; i++)
+    {
+        for(int j=0; j<=kGridSize; j++)
+        {
+            const dReal x = -1.0 + 2.0*i/kGridSize, y = -1.0 + 2.0*j/kGridSize;
+            vertices.insert(vertices.end(), {offset[0]+x, offset[1]+y,
+                                             offset[2]+0.1*std::sin(3.0*x)*std::cos(2.0*y), 0.0});
+        }
+    }
+    for(int i=0; i<kGridSize; i++)
+    {
+        for(int j=0; j<kGridSize; j++)
+        {
+            const dTriIndex a = i*(kGridSize+1)+j, b = a+1, c = a+kGridSize+1, d = c+1;
+            indices.insert(indices.end(), {a, c, d, a, d, b});
+        }
+    }
+    const unsigned long numVertices = vertices.size()/4;
+
+    std::vector<float> singleVertices;
+    const dReal error = Mesh::convertToSinglePrecision(reinterpret_cast<const dVector3*>(vertices.data()),
+                                                       numVertices, &singleVertices);
+    CHECK(singleVertices.size() == numVertices*3);
+    // at most half a float ulp at the largest coordinate
+    CHECK(error > 0.0 && error <= 101.0*std::ldexp(1.0, -24));
+    CHECK(singleVertices[3] == static_cast<float>(vertices[4]));
+
+    dTriMeshDataID doubleData = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildSimple(doubleData, vertices.data(), numVertices, indices.data(), indices.size());
+    dTriMeshDataID singleData = dGeomTriMeshDataCreate();
+    dGeomTriMeshDataBuildSingle(singleData, singleVertices.data(), 3*sizeof(float), numVertices,
+                                indices.data(), indices.size(), 3*sizeof(dTriIndex));
+    dGeomID doubleMesh = dCreateTriMesh(0, doubleData, 0, 0, 0);
+    dGeomID singleMesh = dCreateTriMesh(0, singleData, 0, 0, 0);
+    dGeomID sphere = dCreateSphere(0, 0.1);
+
+    const dReal tolerance = 10.0*error;
+    int numContacts = 0;
+    for(int i=0; i<15; i++)
+    {
+        for(int j=0; j<15; j++)
+        {
+            const dReal x = -0.9 + 1.8*i/14, y = -0.9 + 1.8*j/14;
+            const dReal surface = 0.1*std::sin(3.0*x)*std::cos(2.0*y);
+            dGeomSetPosition(sphere, offset[0]+x, offset[1]+y, offset[2]+surface+0.08);
+            const Deepest d = collide(sphere, doubleMesh);
+            const Deepest s = collide(sphere, singleMesh);
+            CHECK((d.count > 0) == (s.count > 0));
+            if(d.count == 0 || s.count == 0)
+            {
+                continue;
+            }
+            numContacts++;
+            CHECK_NEAR(s.depth, d.depth, tolerance);
+            for(int k=0; k<3; k++)
+            {
+                CHECK_NEAR(s.pos[k], d.pos[k], tolerance);
+                CHECK_NEAR(s.normal[k], d.normal[k], 1e-3);
+            }
+        }
+    }
+    // every sphere penetrates the surface
+    CHECK(numContacts == 15*15);
+
+    dGeomDestroy(sphere);
+    dGeomDestroy(singleMesh);
+    dGeomDestroy(doubleMesh);
+    dGeomTriMeshDataDestroy(singleData);
+    dGeomTriMeshDataDestroy(doubleData);
+    dCloseODE();
+    return TEST_RESULT();
+}
@@ -0,0 +1,169 @@
+#include "TestHelpers.hpp"
+
+#include <SweepAndPrune.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace mars::ode_collision;
+
+namespace
+{
+    typedef std::set<std::pair<unsigned int, unsigned int>> PairSet;
+
+    dReal randomValue(dReal min, dReal max)
+    {
+        return min + (max-min)*rand()/(dReal)RAND_MAX;
+    }
+
+    // coordinates on a quarter grid, thus many boxes share endpoint values
+    dReal quantized(dReal value)
+    {
+        return std::round(value*4.0)/4.0;
+    }
+
+    AabbTree::Aabb randomBox()
+    {
+        AabbTree::Aabb box;
+        for(int k=0; k<3; k++)
+        {
+            const dReal center = quantized(randomValue(0.0, 20.0));
+            const dReal extent = quantized(randomValue(0.0, 2.0));
+            box[k*2] = center - extent;
+            box[k*2+1] = center + extent;
+        }
+        // like the box of a plane
+        if(rand()%50 == 0)
+        {
+            box[0] = -dInfinity;
+            box[1] = dInfinity;
+        }
+        return box;
+    }
+
+    PairSet bruteForce(const std::vector<AabbTree::Aabb> &boxes, const std::vector<bool> &alive)
+    {
+        PairSet result;
+        for(unsigned int i=0; i<boxes.size(); i++)
+        {
+            for(unsigned int j=i+1; j<boxes.size(); j++)
+            {
+                if(alive[i] && alive[j] && AabbTree::overlaps(boxes[i].data(), boxes[j].data()))
+                {
+                    result.emplace(i, j);
+                }
+            }
+        }
+        return result;
+    }
+
+    // the pairs as ordered set, false if a pair is reported twice
+    bool getPairs(const SweepAndPrune &sap, PairSet *result)
+    {
+        result->clear();
+        for(const auto &pair : sap.getPairs())
+        {
+            result->emplace(std::min(pair.box1, pair.box2), std::max(pair.box1, pair.box2));
+        }
+        return result->size() == sap.getPairs().size();
+    }
+}
+
+int main()
+{
+    srand(5);
+    SweepAndPrune sap;
+    PairSet pairs;
+    CHECK(getPairs(sap, &pairs) && pairs.empty());
+
+    // touching boxes overlap
+    const dReal a[6] = {0.0, 1.0, 0.0, 1.0, 0.0, 1.0};
+    const dReal b[6] = {1.0, 2.0, 0.0, 1.0, 0.0, 1.0};
+    const unsigned int handleA = sap.add(a);
+    const unsigned int handleB = sap.add(b);
+    CHECK(getPairs(sap, &pairs) && pairs.size() == 1);
+    CHECK(sap.getBounds(handleB)[0] == 1.0);
+    // separated and joined again by updates
+    const dReal c[6] = {1.1, 2.0, 0.0, 1.0, 0.0, 1.0};
+    sap.update(handleB, c);
+    CHECK(getPairs(sap, &pairs) && pairs.empty());
+    sap.update(handleB, b);
+    CHECK(getPairs(sap, &pairs) && pairs.size() == 1);
+    // removed handles are reused
+    sap.remove(handleA);
+    CHECK(getPairs(sap, &pairs) && pairs.empty());
+    CHECK(sap.add(a) == handleA);
+    CHECK(getPairs(sap, &pairs) && pairs.size() == 1);
+    sap.clear();
+    CHECK(getPairs(sap, &pairs) && pairs.empty());
+
+    // random adds, removes, small moves and jumps match a brute force test
+    std::vector<AabbTree::Aabb> boxes;
+    std::vector<bool> alive;
+    int numLive = 0;
+    for(int step=0; step<3000; step++)
+    {
+        const dReal action = randomValue(0.0, 1.0);
+        if(action < 0.1 || numLive == 0)
+        {
+            const AabbTree::Aabb box = randomBox();
+            const unsigned int handle = sap.add(box.data());
+            if(handle >= boxes.size())
+            {
+                boxes.resize(handle+1);
+                alive.resize(handle+1, false);
+            }
+            CHECK(!alive[handle]);
+            boxes[handle] = box;
+            alive[handle] = true;
+            numLive++;
+        }
+        else if(action < 0.15)
+        {
+            const unsigned int handle = rand()%boxes.size();
+            if(alive[handle])
+            {
+                sap.remove(handle);
+                alive[handle] = false;
+                numLive--;
+            }
+        }
+        else
+        {
+            for(int i=0; i<5; i++)
+            {
+                const unsigned int handle = rand()%boxes.size();
+                if(!alive[handle])
+                {
+                    continue;
+                }
+                AabbTree::Aabb &box = boxes[handle];
+                if(rand()%2)
+                {
+                    box = randomBox();
+                }
+                else
+                {
+                    for(int k=0; k<3; k++)
+                    {
+                        const dReal delta = quantized(randomValue(-1.0, 1.0));
+                        box[k*2] += delta;
+                        box[k*2+1] += delta;
+                    }
+                }
+                sap.update(handle, box.data());
+            }
+        }
+        CHECK(getPairs(sap, &pairs));
+        CHECK(pairs == bruteForce(boxes, alive));
+    }
+    CHECK(numLive > 10);
+
+    sap.clear();
+    CHECK(getPairs(sap, &pairs) && pairs.empty());
+    return TEST_RESULT();
+}
@@ -0,0 +1,186 @@
+#include "TestHelpers.hpp"
+
+#include <CollisionSpace.hpp>
+#include <objects/VoxelGrid.hpp>
+
+#include <configmaps/ConfigMap.hpp>
+#include <ode/ode.h>
+
+#include <cstdlib>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace mars::ode_collision;
+using configmaps::ConfigMap;
+using mars::utils::Vector;
+
+namespace
+{
+    const dReal kResolution = 0.1;
+    // depth 3 gives 32 voxels per side
+    const int kSize = 32;
+
+    typedef std::tuple<int, int, int> Voxel;
+
+    Vector center(const Voxel &voxel)
+    {
+        return Vector((std::get<0>(voxel) + 0.5 - 0.5*kSize)*kResolution,
+                      (std::get<1>(voxel) + 0.5 - 0.5*kSize)*kResolution,
+                      (std::get<2>(voxel) + 0.5 - 0.5*kSize)*kResolution);
+    }
+
+    Voxel randomVoxel(int range)
+    {
+        // clustered around the grid center to reuse inner nodes
+        return Voxel(kSize/2 - range + rand()%(2*range), kSize/2 - range + rand()%(2*range),
+                     kSize/2 - range + rand()%(2*range));
+    }
+
+    int numNodes(const VoxelGrid *grid)
+    {
+        return grid->getConfigMap()["nodes"];
+    }
+
+    // compares every voxel of the grid with the reference set
+    bool matches(const VoxelGrid *grid, const std::set<Voxel> &reference)
+    {
+        if(grid->getNumOccupied() != reference.size())
+        {
+            return false;
+        }
+        for(int x=0; x<kSize; x++)
+        {
+            for(int y=0; y<kSize; y++)
+            {
+                for(int z=0; z<kSize; z++)
+                {
+                    const Voxel voxel(x, y, z);
+                    if(grid->isOccupied(center(voxel)) != (reference.count(voxel) > 0))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    srand(5);
+    CollisionSpace space(nullptr);
+    space.initSpace();
+
+    ConfigMap config = ConfigMap::fromYamlString(
+        "name: grid\n"
+        "type: voxelgrid\n"
+        "resolution: 0.1\n"
+        "depth: 3\n"
+        "voxels: [0.05, 0.05, 0.05, -1.55, 1.55, 0.05]\n");
+    VoxelGrid *grid = dynamic_cast<VoxelGrid*>(VoxelGrid::instantiate(&space, nullptr, config));
+    CHECK(grid && grid->getGeom());
+    std::set<Voxel> reference = {Voxel(16, 16, 16), Voxel(0, 31, 16)};
+    CHECK(matches(grid, reference));
+
+    // positions are mapped to the voxel containing them
+    CHECK(grid->isOccupied(Vector(0.01, 0.09, 0.099)));
+    CHECK(!grid->isOccupied(Vector(-0.01, 0.05, 0.05)));
+    // setting a voxel twice counts it once
+    CHECK(grid->setVoxel(Vector(0.05, 0.05, 0.05), true));
+    CHECK(grid->getNumOccupied() == 2);
+    // outside of the grid
+    CHECK(!grid->setVoxel(Vector(1.65, 0.0, 0.0), true));
+    CHECK(!grid->setVoxel(Vector(0.0, -1.61, 0.0), true));
+    CHECK(!grid->isOccupied(Vector(0.0, 0.0, 5.0)));
+    CHECK(grid->getNumOccupied() == 2);
+
+    // random single changes and batches match a reference set
+    for(int i=0; i<3000; i++)
+    {
+        const Voxel voxel = randomVoxel(6);
+        const bool occupied = rand()%3 != 0;
+        CHECK(grid->setVoxel(center(voxel), occupied));
+        if(occupied)
+        {
+            reference.insert(voxel);
+        }
+        else
+        {
+            reference.erase(voxel);
+        }
+    }
+    CHECK(matches(grid, reference));
+    for(int batch=0; batch<20; batch++)
+    {
+        std::vector<Vector> occupied, free;
+        std::set<Voxel> freed;
+        for(int i=0; i<100; i++)
+        {
+            const Voxel voxel = randomVoxel(10);
+            free.push_back(center(voxel));
+            freed.insert(voxel);
+        }
+        for(int i=0; i<100; i++)
+        {
+            occupied.push_back(center(randomVoxel(10)));
+        }
+        // out of range entries are skipped
+        occupied.push_back(Vector(10.0, 0.0, 0.0));
+        grid->updateVoxels(occupied, free);
+        // the free voxels are applied first
+        for(const auto &voxel : freed)
+        {
+            reference.erase(voxel);
+        }
+        for(size_t i=0; i+1<occupied.size(); i++)
+        {
+            const Vector &p = occupied[i];
+            reference.insert(Voxel(static_cast<int>(p.x()/kResolution + 0.5*kSize),
+                                   static_cast<int>(p.y()/kResolution + 0.5*kSize),
+                                   static_cast<int>(p.z()/kResolution + 0.5*kSize)));
+        }
+    }
+    CHECK(matches(grid, reference));
+
+    // emptied leaves and nodes are released
+    for(const auto &voxel : reference)
+    {
+        CHECK(grid->setVoxel(center(voxel), false));
+    }
+    reference.clear();
+    CHECK(matches(grid, reference));
+    CHECK(numNodes(grid) == 1);
+
+    // a sphere collides with the occupied voxels only
+    const Voxel occupiedVoxel(20, 12, 16);
+    CHECK(grid->setVoxel(center(occupiedVoxel), true));
+    dGeomID sphere = dCreateSphere(0, 0.06);
+    dContactGeom contacts[8];
+    Vector p = center(occupiedVoxel) + Vector(0.0, 0.0, 0.1);
+    dGeomSetPosition(sphere, p.x(), p.y(), p.z());
+    int n = dCollide(grid->getGeom(), sphere, 8, contacts, sizeof(dContactGeom));
+    CHECK(n >= 1);
+    for(int i=0; i<n; i++)
+    {
+        CHECK(contacts[i].g1 == grid->getGeom());
+        CHECK_NEAR(contacts[i].depth, 0.01, 1e-9);
+    }
+    p = center(Voxel(12, 12, 16));
+    dGeomSetPosition(sphere, p.x(), p.y(), p.z());
+    CHECK(dCollide(grid->getGeom(), sphere, 8, contacts, sizeof(dContactGeom)) == 0);
+
+    // clear drops every voxel
+    grid->clear();
+    CHECK(grid->getNumOccupied() == 0);
+    CHECK(!grid->isOccupied(center(occupiedVoxel)));
+    CHECK(numNodes(grid) == 1);
+    p = center(occupiedVoxel);
+    dGeomSetPosition(sphere, p.x(), p.y(), p.z());
+    CHECK(dCollide(grid->getGeom(), sphere, 8, contacts, sizeof(dContactGeom)) == 0);
+
+    dGeomDestroy(sphere);
+    delete grid;
+    return TEST_RESULT();
+}